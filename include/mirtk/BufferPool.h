@@ -0,0 +1,89 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _BUFFERPOOL_H
+#define _BUFFERPOOL_H
+
+#include <cstddef>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+
+
+/**
+ * Pool of numbered memory buffers whose capacity is reused
+ *
+ * A buffer is only reallocated when more memory is requested than it
+ * currently holds. When it has to grow, its capacity is increased by at
+ * least half, such that a sequence of slightly larger requests, e.g., while
+ * the viewer window is resized, results in few allocations. Requests for
+ * the same or a smaller size return the existing memory, whose contents
+ * are left unchanged.
+ */
+class MIRTK_Viewer_EXPORT BufferPool
+{
+
+  /// Start of each buffer, NULL if not yet allocated
+  std::vector<char *> _Data;
+
+  /// Size of each buffer in bytes
+  std::vector<size_t> _Capacity;
+
+  /// Number of allocations made so far
+  long _NumberOfAllocations;
+
+public:
+
+  /// Constructor
+  BufferPool();
+
+  /// Destructor
+  virtual ~BufferPool();
+
+  /// Get buffer with given index of at least the given number of bytes
+  ///
+  /// Pointers previously returned for this buffer are invalid when the
+  /// buffer had to grow.
+  void *Get(int, size_t);
+
+  /// Get buffer with given index for at least the given number of elements
+  template <class T> T *Get(int, size_t);
+
+  /// Release memory of all buffers
+  void Clear();
+
+  /// Total size of all buffers in bytes
+  size_t MemorySize() const;
+
+  /// Number of allocations made so far
+  long NumberOfAllocations() const;
+
+};
+
+template <class T>
+inline T *BufferPool::Get(int i, size_t n)
+{
+  return static_cast<T *>(this->Get(i, n * sizeof(T)));
+}
+
+inline long BufferPool::NumberOfAllocations() const
+{
+  return _NumberOfAllocations;
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _IMAGEPYRAMID_H
+#define _IMAGEPYRAMID_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Image.h>
+
+
+/**
+ * Mip-map style pyramid of an image for zoomed out display
+ *
+ * Level 0 is the image itself. The voxels of each following level are at
+ * most twice as large as the smallest voxel dimension of the previous one,
+ * and the voxels of the previous level are merged only along the axes
+ * whose voxel size is at most half of this, e.g., the slices of an image
+ * with thick slices are kept until the in-plane voxels are equally large.
+ * Blocks of voxels are averaged, or replaced by their most frequent value
+ * for label images such as segmentations. Levels are computed on first
+ * request only, one after the other by a worker thread, such that the
+ * caller can display a finer level until the requested one is ready.
+ * Computed levels are kept until the pyramid is re-initialized.
+ */
+class MIRTK_Viewer_EXPORT ImagePyramid
+{
+
+  /// Full resolution image (not owned)
+  mirtk::Image *_Image;
+
+  /// Downsampled images, NULL if not yet computed
+  std::vector<mirtk::Image *> _Level;
+
+  /// Whether image is a label image
+  bool _Labels;
+
+  /// Smallest voxel dimension of full resolution image
+  double _VoxelSize;
+
+  /// Number of leading levels which have been computed
+  int _Computed;
+
+  /// Coarsest level requested so far
+  int _Requested;
+
+  /// Worker thread computing the requested levels
+  std::thread _Worker;
+
+  /// Whether worker thread is running
+  bool _Running;
+
+  /// Whether worker thread should terminate
+  std::atomic<bool> _Stop;
+
+  /// Mutex guarding the levels and the state of the worker thread
+  mutable std::mutex _Mutex;
+
+  /// Signals that a level has been computed or the worker terminated
+  std::condition_variable _Condition;
+
+  /// Compute level from the previous one for given maximum voxel size,
+  /// returns NULL if the worker thread was stopped meanwhile
+  mirtk::Image *Downsample(mirtk::Image *, double);
+
+  /// Worker thread main loop
+  void Run();
+
+  /// Start worker thread for levels up to the given one (mutex must be held)
+  void Start(int);
+
+public:
+
+  /// Constructor
+  ImagePyramid();
+
+  /// Destructor
+  virtual ~ImagePyramid();
+
+  /// Initialize pyramid for given image, discards existing levels. Voxels
+  /// of label images are not averaged, but replaced by the most frequent one.
+  void Initialize(mirtk::Image *, bool = false);
+
+  /// Stop worker thread and discard all levels
+  void Clear();
+
+  /// Number of levels, including the full resolution image
+  int NumberOfLevels() const;
+
+  /// Coarsest level whose voxels are not larger than a display pixel
+  int SelectLevel(double) const;
+
+  /// Compute levels up to the given one in the background, returns the
+  /// coarsest level not coarser than it which is available right away
+  int Request(int);
+
+  /// Whether given level has been computed
+  bool IsReady(int) const;
+
+  /// Wait until given level has been computed or the worker was stopped
+  void Wait(int);
+
+  /// Get image of given level, or of the coarsest computed level which
+  /// is finer if it is not ready yet (cf. Request)
+  mirtk::Image *GetLevel(int);
+
+};
+
+inline int ImagePyramid::NumberOfLevels() const
+{
+  return static_cast<int>(_Level.size()) + 1;
+}
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _IMAGESEQUENCELOADER_H
+#define _IMAGESEQUENCELOADER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Image.h>
+
+
+/**
+ * Reads the remaining frames of an image sequence in the background
+ *
+ * The caller reads the first frame, allocates the 4D image and displays it
+ * right away. Worker threads then read the following frames directly into
+ * the 4D image. Frames are made available in order, i.e., the first
+ * NumberOfLoadedFrames() frames of the image can be displayed while the
+ * others are still being read.
+ */
+class MIRTK_Viewer_EXPORT ImageSequenceLoader
+{
+
+  /// File names of frames
+  std::vector<std::string> _FileName;
+
+  /// Image sequence the frames are read into (not owned)
+  mirtk::Image *_Image;
+
+  /// Geometry each frame must have
+  mirtk::ImageAttributes _Attributes;
+
+  /// Whether frame has been read
+  std::vector<bool> _Done;
+
+  /// Next frame to be read by a worker thread
+  int _Next;
+
+  /// Number of leading frames which have been read
+  std::atomic<int> _Loaded;
+
+  /// Frame whose geometry does not match the first one (0 if none)
+  int _Failed;
+
+  /// Number of worker threads
+  int _NumberOfThreads;
+
+  /// Worker threads
+  std::vector<std::thread> _Worker;
+
+  /// Whether worker threads should terminate
+  bool _Stop;
+
+  /// Mutex guarding all of the above
+  std::mutex _Mutex;
+
+  /// Worker thread main loop
+  void Run();
+
+public:
+
+  /// Constructor
+  ImageSequenceLoader(int = 2);
+
+  /// Destructor
+  virtual ~ImageSequenceLoader();
+
+  /// Start reading frames 1..n-1 of the given files into the image,
+  /// whose first frame has been read already
+  void Start(mirtk::Image *, int, char **);
+
+  /// Stop reading frames and wait for worker threads to terminate
+  void Stop();
+
+  /// Whether frames are being read, true until Finish() has been called
+  bool IsLoading() const;
+
+  /// Whether all frames have been read (or reading failed)
+  bool IsDone();
+
+  /// Wait for worker threads, returns index of frame with mismatching
+  /// geometry or 0 if all frames were read
+  int Finish();
+
+  /// Total number of frames of the image sequence
+  int NumberOfFrames() const;
+
+  /// Number of leading frames which can be displayed
+  int NumberOfLoadedFrames() const;
+
+  /// File name of i-th frame
+  const char *FileName(int) const;
+
+};
+
+inline bool ImageSequenceLoader::IsLoading() const
+{
+  return !_Worker.empty();
+}
+
+inline int ImageSequenceLoader::NumberOfFrames() const
+{
+  return static_cast<int>(_FileName.size());
+}
+
+inline int ImageSequenceLoader::NumberOfLoadedFrames() const
+{
+  return _Loaded;
+}
+
+inline const char *ImageSequenceLoader::FileName(int i) const
+{
+  return _FileName[i].c_str();
+}
+
+#endif
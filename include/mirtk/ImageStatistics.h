@@ -0,0 +1,132 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _IMAGESTATISTICS_H
+#define _IMAGESTATISTICS_H
+
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Image.h>
+
+// Number of histogram bins used for percentiles
+#define STATISTICS_BINS 4096
+
+
+/**
+ * Intensity statistics of an image computed in parallel at load time
+ *
+ * Minimum, maximum and a fine histogram of all voxels are computed by two
+ * parallel passes over the voxel data. Robust percentiles for the default
+ * display window as well as the histogram shown by the histogram window are
+ * derived from these without another scan of the image.
+ */
+class MIRTK_Viewer_EXPORT ImageStatistics
+{
+
+  /// Whether statistics have been computed for the current image
+  bool _Valid;
+
+  /// Minimum intensity
+  double _Min;
+
+  /// Maximum intensity
+  double _Max;
+
+  /// Number of voxels in each histogram bin between min and max
+  std::vector<long> _Histogram;
+
+  /// Total number of voxels in histogram, i.e., of finite voxels
+  long _Count;
+
+  /// Number of voxels with intensity zero
+  long _Zeros;
+
+public:
+
+  /// Constructor
+  ImageStatistics();
+
+  /// Compute statistics of given image
+  void Compute(const mirtk::Image *);
+
+  /// Discard statistics, e.g., when image was replaced
+  void Invalidate();
+
+  /// Whether statistics have been computed
+  bool IsValid() const;
+
+  /// Minimum intensity
+  double Min() const;
+
+  /// Maximum intensity
+  double Max() const;
+
+  /// Intensity below which the given percentage of voxels lies
+  double Percentile(double) const;
+
+  /// Number of histogram bins
+  int NumberOfBins() const;
+
+  /// Intensity at center of histogram bin
+  double BinCenter(int) const;
+
+  /// Number of voxels in histogram bin
+  long Count(int) const;
+
+  /// Number of voxels with intensity zero
+  long NumberOfZeros() const;
+
+};
+
+inline bool ImageStatistics::IsValid() const
+{
+  return _Valid;
+}
+
+inline double ImageStatistics::Min() const
+{
+  return _Min;
+}
+
+inline double ImageStatistics::Max() const
+{
+  return _Max;
+}
+
+inline int ImageStatistics::NumberOfBins() const
+{
+  return static_cast<int>(_Histogram.size());
+}
+
+inline double ImageStatistics::BinCenter(int b) const
+{
+  return _Min + (b + 0.5) * (_Max - _Min) / _Histogram.size();
+}
+
+inline long ImageStatistics::Count(int b) const
+{
+  return _Histogram[b];
+}
+
+inline long ImageStatistics::NumberOfZeros() const
+{
+  return _Zeros;
+}
+
+#endif
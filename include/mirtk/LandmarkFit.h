@@ -0,0 +1,197 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LANDMARKFIT_H
+#define _LANDMARKFIT_H
+
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/PointSet.h>
+
+
+/// Transformation models which can be fitted to landmark correspondences
+enum LandmarkFitModel { LandmarkFit_Rigid, LandmarkFit_Similarity, LandmarkFit_Affine };
+
+/// Treatment of outlier landmarks
+enum LandmarkFitMode { LandmarkFit_LeastSquares, LandmarkFit_RANSAC, LandmarkFit_IRLS };
+
+/**
+ * Closed-form fit of a linear transformation to landmark correspondences
+ *
+ * The rigid and similarity models are fitted with the quaternion method of
+ * Horn, the affine model by solving the normal equations. Outliers are either
+ * rejected by RANSAC using minimal samples of landmark pairs, or down-weighted
+ * by iteratively reweighted least squares with Cauchy weights. Residuals are
+ * the distances in mm between transformed target and source landmarks.
+ */
+class MIRTK_Viewer_EXPORT LandmarkFit
+{
+
+  /// Transformation model
+  LandmarkFitModel _Model;
+
+  /// Treatment of outliers
+  LandmarkFitMode _Mode;
+
+  /// Residual in mm above which a landmark pair is an outlier
+  double _Threshold;
+
+  /// Maximum number of RANSAC samples
+  int _Iterations;
+
+  /// Fitted transformation (3x4 matrix in homogeneous coordinates)
+  double _Matrix[3][4];
+
+  /// Residual of each landmark pair
+  std::vector<double> _Residual;
+
+  /// Whether landmark pair is an inlier
+  std::vector<bool> _Inlier;
+
+  /// Weighted least squares fit of the model
+  bool Solve(const mirtk::PointSet &, const mirtk::PointSet &, const std::vector<double> &, double [3][4]) const;
+
+  /// Compute residuals of a transformation
+  void Residuals(const mirtk::PointSet &, const mirtk::PointSet &, const double [3][4], std::vector<double> &) const;
+
+  /// Reject outliers using random minimal samples
+  bool RunRANSAC(const mirtk::PointSet &, const mirtk::PointSet &);
+
+  /// Down-weight outliers iteratively
+  bool RunIRLS(const mirtk::PointSet &, const mirtk::PointSet &);
+
+public:
+
+  /// Constructor
+  LandmarkFit();
+
+  /// Set transformation model
+  void SetModel(LandmarkFitModel);
+
+  /// Get transformation model
+  LandmarkFitModel GetModel() const;
+
+  /// Set treatment of outliers
+  void SetMode(LandmarkFitMode);
+
+  /// Get treatment of outliers
+  LandmarkFitMode GetMode() const;
+
+  /// Set residual in mm above which a landmark pair is an outlier
+  void SetThreshold(double);
+
+  /// Get residual in mm above which a landmark pair is an outlier
+  double GetThreshold() const;
+
+  /// Set maximum number of RANSAC samples
+  void SetIterations(int);
+
+  /// Minimum number of landmark pairs required by the model
+  int MinimumNumberOfLandmarks() const;
+
+  /// Fit transformation mapping target landmarks onto source landmarks,
+  /// returns false if there are too few or degenerate landmarks
+  bool Run(const mirtk::PointSet &, const mirtk::PointSet &);
+
+  /// Replace fitted matrix by the one actually applied, e.g., when the
+  /// transformation cannot represent the model, and update the residuals
+  void Evaluate(const mirtk::PointSet &, const mirtk::PointSet &, const double [3][4]);
+
+  /// Get element of fitted 4x4 matrix
+  double Get(int, int) const;
+
+  /// Number of landmark pairs of last fit
+  int NumberOfLandmarks() const;
+
+  /// Residual in mm of landmark pair
+  double Residual(int) const;
+
+  /// Whether landmark pair is an inlier
+  bool IsInlier(int) const;
+
+  /// Number of inliers
+  int NumberOfInliers() const;
+
+  /// Mean residual in mm of all landmark pairs
+  double MeanResidual() const;
+
+};
+
+inline void LandmarkFit::SetModel(LandmarkFitModel model)
+{
+  _Model = model;
+}
+
+inline LandmarkFitModel LandmarkFit::GetModel() const
+{
+  return _Model;
+}
+
+inline void LandmarkFit::SetMode(LandmarkFitMode mode)
+{
+  _Mode = mode;
+}
+
+inline LandmarkFitMode LandmarkFit::GetMode() const
+{
+  return _Mode;
+}
+
+inline void LandmarkFit::SetThreshold(double threshold)
+{
+  _Threshold = threshold;
+}
+
+inline double LandmarkFit::GetThreshold() const
+{
+  return _Threshold;
+}
+
+inline void LandmarkFit::SetIterations(int n)
+{
+  _Iterations = (n > 0) ? n : 1;
+}
+
+inline int LandmarkFit::MinimumNumberOfLandmarks() const
+{
+  return (_Model == LandmarkFit_Affine) ? 4 : 3;
+}
+
+inline double LandmarkFit::Get(int i, int j) const
+{
+  if (i == 3) return (j == 3) ? 1.0 : .0;
+  return _Matrix[i][j];
+}
+
+inline int LandmarkFit::NumberOfLandmarks() const
+{
+  return static_cast<int>(_Residual.size());
+}
+
+inline double LandmarkFit::Residual(int i) const
+{
+  return _Residual[i];
+}
+
+inline bool LandmarkFit::IsInlier(int i) const
+{
+  return _Inlier[i];
+}
+
+#endif
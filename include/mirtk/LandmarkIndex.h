@@ -0,0 +1,94 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LANDMARKINDEX_H
+#define _LANDMARKINDEX_H
+
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Image.h>
+#include <mirtk/PointSet.h>
+#include <mirtk/Transformation.h>
+
+
+/**
+ * Index of landmarks by their distance along the normal of viewer planes
+ *
+ * Landmark positions are mapped by an optional transformation once per
+ * change of the landmarks or transformation, which for source landmarks
+ * is an iterative inversion of free-form deformations. For each plane
+ * normal, the landmarks are sorted by their signed distance along it such
+ * that those within the slab of a displayed slice are found by a binary
+ * search instead of testing every landmark on every draw.
+ */
+class MIRTK_Viewer_EXPORT LandmarkIndex
+{
+
+  /// Landmarks sorted along a plane normal
+  struct Slabs
+  {
+    double Normal[3];
+    std::vector<std::pair<double, int> > Order;
+  };
+
+  /// Landmark positions after transformation
+  std::vector<mirtk::Point> _Position;
+
+  /// Sorted landmarks of recently displayed plane orientations
+  std::vector<Slabs> _Slabs;
+
+  /// Versions of landmarks and transformation the positions were computed for
+  std::vector<double> _Key;
+
+  /// Get sorted landmarks for plane normal
+  const Slabs &GetSlabs(const double *);
+
+public:
+
+  /// Update positions if landmarks or transformation changed, where the
+  /// landmarks are identified by a version bumped on each edit, and the
+  /// transformation may be NULL, is inverted if requested and identified
+  /// by a version bumped on each change of its parameters
+  void Update(const mirtk::PointSet &, unsigned long, const mirtk::Transformation *, bool, unsigned long);
+
+  /// Discard positions
+  void Clear();
+
+  /// Number of landmarks
+  int Size() const;
+
+  /// Position of landmark after transformation
+  const mirtk::Point &Position(int) const;
+
+  /// Indices of landmarks within the field of view of a slice, ascending
+  void Find(const mirtk::GreyImage *, std::vector<int> &);
+
+};
+
+inline int LandmarkIndex::Size() const
+{
+  return static_cast<int>(_Position.size());
+}
+
+inline const mirtk::Point &LandmarkIndex::Position(int i) const
+{
+  return _Position[i];
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MAPPEDIMAGE_H
+#define _MAPPEDIMAGE_H
+
+#include <cstddef>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Image.h>
+
+
+/**
+ * Image whose voxels are memory-mapped from an uncompressed image file
+ *
+ * Pages of the file are read by the operating system when voxels are first
+ * accessed, such that only those slices which are displayed are read from
+ * disk. The mapping is private, i.e., modifications are not written back.
+ */
+template <class VoxelType>
+class MappedImage : public mirtk::GenericImage<VoxelType>
+{
+
+  /// Start of memory-mapped file
+  void *_Map;
+
+  /// Size of memory-mapped file
+  size_t _MapSize;
+
+public:
+
+  /// Constructor
+  MappedImage(const mirtk::ImageAttributes &, VoxelType *, void *, size_t);
+
+  /// Destructor
+  virtual ~MappedImage();
+
+};
+
+/// Memory-map uncompressed single file NIfTI image read-only, returns NULL if
+/// the file cannot be mapped and has to be read with mirtk::Image::New instead
+MIRTK_Viewer_EXPORT mirtk::Image *ReadMappedImage(const char *);
+
+/// Whether image was memory-mapped by ReadMappedImage
+MIRTK_Viewer_EXPORT bool IsMappedImage(const mirtk::Image *);
+
+/// Estimate intensity range from about the given number of voxels, which are
+/// read in few contiguous blocks such that only few pages of a mapped file are read
+MIRTK_Viewer_EXPORT void EstimateMinMaxAsDouble(const mirtk::Image *, double *, double *, int = 1000000);
+
+/// Continue exact computation of intensity range for the next given number
+/// of voxels starting at the given voxel index, returns index of next voxel
+/// or -1 if all voxels have been processed
+MIRTK_Viewer_EXPORT long RefineMinMaxAsDouble(const mirtk::Image *, double *, double *, long, long);
+
+#endif
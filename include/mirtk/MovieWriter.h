@@ -0,0 +1,142 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MOVIEWRITER_H
+#define _MOVIEWRITER_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+  #include <sys/types.h>
+#endif
+
+#include <mirtk/ViewerExport.h>
+
+
+/**
+ * Writes rendered frames of a movie on a background thread
+ *
+ * The format is chosen by the file name extension: ".y4m" writes an
+ * uncompressed YUV4MPEG2 stream, other video extensions such as ".mp4"
+ * pipe raw RGB frames to a local ffmpeg binary, and any other name is
+ * used for one PNG image per frame, where the frame number is appended
+ * to the file name stem (e.g., movie.png is written as movie_00000.png).
+ * Frames are rendered into a fixed pool of RGB buffers which are reused
+ * once the writer thread is done with them, such that rendering of the
+ * next frame overlaps with encoding of the previous ones.
+ */
+class MIRTK_Viewer_EXPORT MovieWriter
+{
+
+  /// Output file name
+  std::string _FileName;
+
+  /// Output format
+  enum Format { Format_PNG, Format_Y4M, Format_FFmpeg } _Format;
+
+  /// Frame size
+  int _Width, _Height;
+
+  /// Frames per second
+  double _Rate;
+
+  /// Output stream of Y4M file or ffmpeg pipe
+  FILE *_Stream;
+
+#ifndef _WIN32
+  /// Process ID of ffmpeg
+  pid_t _Process;
+#endif
+
+  /// RGB frame buffers, top row first
+  std::vector<std::vector<unsigned char> > _Buffer;
+
+  /// Buffers available for rendering
+  std::deque<int> _Free;
+
+  /// Buffers waiting to be written
+  std::deque<int> _Queue;
+
+  /// Conversion buffer reused for each frame
+  std::vector<unsigned char> _Conversion;
+
+  /// Number of frames written
+  int _Frame;
+
+  /// Whether writing of a frame failed
+  bool _Failed;
+
+  /// Whether writer thread should terminate once the queue is empty
+  bool _Stop;
+
+  /// Writer thread
+  std::thread _Writer;
+
+  /// Mutex guarding buffer queues and flags
+  std::mutex _Mutex;
+
+  /// Signals writer thread that a frame was submitted
+  std::condition_variable _QueueCondition;
+
+  /// Signals renderer that a buffer became available
+  std::condition_variable _FreeCondition;
+
+  /// Start ffmpeg with a pipe for the raw frames
+  bool StartFFmpeg();
+
+  /// Wait for ffmpeg to encode the remaining frames, returns false on error
+  bool StopFFmpeg();
+
+  /// Name of PNG file of given frame
+  std::string FrameFileName(int) const;
+
+  /// Writer thread main loop
+  void Run();
+
+  /// Write frame
+  bool Write(const unsigned char *);
+
+public:
+
+  /// Constructor
+  MovieWriter(int = 4);
+
+  /// Destructor
+  virtual ~MovieWriter();
+
+  /// Open movie of given frame size and frames per second
+  bool Open(const char *, int, int, double);
+
+  /// Get buffer for next frame, waits until one is available
+  unsigned char *Acquire();
+
+  /// Submit rendered frame for writing
+  void Submit(unsigned char *);
+
+  /// Write remaining frames and close movie, returns false on error
+  bool Close();
+
+};
+
+#endif
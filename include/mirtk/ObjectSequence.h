@@ -0,0 +1,172 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _OBJECTSEQUENCE_H
+#define _OBJECTSEQUENCE_H
+
+#include <mirtk/IOConfig.h>
+
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/SurfaceCutter.h>
+
+#include <vtkPointSet.h>
+#include <vtkSmartPointer.h>
+
+
+/**
+ * Ordered list of surface or mesh files which are read on demand
+ *
+ * Objects are only read when first displayed. During playback of an object
+ * movie, a worker thread reads the objects of the next frames ahead. Objects
+ * which have not been displayed recently are discarded together with their
+ * cached cuts when the memory used by all objects exceeds a budget, such that
+ * sequences of hundreds of frames can be played. Objects displayed in the
+ * current frame are never discarded, even if these alone exceed the budget.
+ */
+class MIRTK_Viewer_EXPORT ObjectSequence
+{
+
+  /// File names of objects
+  std::vector<std::string> _FileName;
+
+  /// Objects read so far (NULL if not read or discarded)
+  std::vector<vtkSmartPointer<vtkPointSet> > _Object;
+
+  /// Cuts of objects with viewer planes
+  std::vector<SurfaceCutter *> _Cutter;
+
+  /// Frame in which object was last displayed
+  std::vector<unsigned long> _LastUsed;
+
+  /// Whether object is currently read by the worker thread
+  std::vector<bool> _Pending;
+
+  /// Indices of objects still to be read
+  std::deque<int> _Queue;
+
+  /// Number of objects to read ahead
+  int _Prefetch;
+
+  /// Memory budget in bytes
+  size_t _Budget;
+
+  /// Current frame
+  unsigned long _Frame;
+
+  /// Worker thread
+  std::thread _Worker;
+
+  /// Whether worker thread should terminate
+  bool _Stop;
+
+  /// Mutex guarding all of the above except the cutters
+  std::mutex _Mutex;
+
+  /// Signals worker thread that the queue is not empty
+  std::condition_variable _QueueCondition;
+
+  /// Signals main thread that an object has been read
+  std::condition_variable _ReadyCondition;
+
+  /// Whether object file exists and its header is valid
+  static bool CanRead(const char *);
+
+  /// Read object from file, empty if it could not be read
+  static vtkSmartPointer<vtkPointSet> Read(const char *);
+
+  /// Worker thread main loop
+  void Run();
+
+  /// Stop worker thread
+  void Stop();
+
+  /// Discard least recently displayed objects until within budget (mutex must be held)
+  void Evict();
+
+public:
+
+  /// Constructor
+  ObjectSequence(int = 4, size_t = 1024 * 1024 * 1024);
+
+  /// Destructor
+  virtual ~ObjectSequence();
+
+  /// Append object file to sequence, returns false if it cannot be read
+  bool Add(const char *);
+
+  /// Remove all objects from sequence
+  void Clear();
+
+  /// Number of objects in sequence
+  int Size() const;
+
+  /// File name of i-th object
+  const char *GetFileName(int) const;
+
+  /// Set number of objects to read ahead
+  void SetPrefetch(int);
+
+  /// Set memory budget in bytes
+  void SetBudget(size_t);
+
+  /// Get memory budget in bytes
+  size_t GetBudget() const;
+
+  /// Memory used by objects read so far in bytes
+  size_t MemorySize();
+
+  /// Begin new frame, objects displayed before may be discarded from now on
+  void NextFrame();
+
+  /// Start reading the objects following the given one
+  void Prefetch(int);
+
+  /// Get cutter of i-th object, reading the object if needed. The object
+  /// may be discarded by the next call of NextFrame, the cutter by Clear.
+  SurfaceCutter *Get(int);
+
+};
+
+inline int ObjectSequence::Size() const
+{
+  return static_cast<int>(_FileName.size());
+}
+
+inline const char *ObjectSequence::GetFileName(int i) const
+{
+  return _FileName[i].c_str();
+}
+
+inline size_t ObjectSequence::GetBudget() const
+{
+  return _Budget;
+}
+
+#endif
+
+#endif
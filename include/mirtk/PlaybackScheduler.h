@@ -0,0 +1,119 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYBACKSCHEDULER_H
+#define _PLAYBACKSCHEDULER_H
+
+#include <chrono>
+
+#include <mirtk/ViewerExport.h>
+
+
+/**
+ * Wall-clock schedule of movie playback
+ *
+ * Frames are numbered by ticks since the start of playback, where tick i
+ * is due i frame periods after the start. The frame of the tick following
+ * the displayed one is prepared in the background and presented when due.
+ * When preparing a frame takes longer than a period, the ticks which are
+ * already overdue by the time it is presented are dropped, such that
+ * playback keeps in time instead of slowing down.
+ */
+class MIRTK_Viewer_EXPORT PlaybackScheduler
+{
+
+  /// Time of tick 0
+  std::chrono::steady_clock::time_point _Start;
+
+  /// Duration of one frame in seconds
+  double _Period;
+
+  /// Frame displayed at tick 0
+  int _FirstFrame;
+
+  /// Tick of frame being prepared for display
+  long _Pending;
+
+  /// Number of frames presented
+  long _Presented;
+
+  /// Number of frames dropped
+  long _Dropped;
+
+  /// Whether playback is running
+  bool _Running;
+
+  /// Seconds since tick 0
+  double Elapsed() const;
+
+public:
+
+  /// Constructor
+  PlaybackScheduler();
+
+  /// Start playback at given (displayed) frame with given frame duration
+  void Start(int, double);
+
+  /// Stop playback
+  void Stop();
+
+  /// Whether playback is running
+  bool IsRunning() const;
+
+  /// Tick of frame which is due now
+  long Due() const;
+
+  /// Tick of frame being prepared for display
+  long Pending() const;
+
+  /// Frame of given tick for a sequence of the given number of frames
+  int Frame(long, int) const;
+
+  /// Seconds until given tick is due, negative if overdue
+  double TimeUntil(long) const;
+
+  /// Record presentation of pending frame, returns tick to prepare next
+  long Present();
+
+  /// Requested number of frames per second
+  double RequestedRate() const;
+
+  /// Achieved number of frames per second
+  double AchievedRate() const;
+
+  /// Number of frames dropped so far
+  long NumberOfDroppedFrames() const;
+
+};
+
+inline bool PlaybackScheduler::IsRunning() const
+{
+  return _Running;
+}
+
+inline long PlaybackScheduler::Pending() const
+{
+  return _Pending;
+}
+
+inline long PlaybackScheduler::NumberOfDroppedFrames() const
+{
+  return _Dropped;
+}
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+
+
+/**
+ * Timings of pipeline stages and counters of the registration viewer
+ *
+ * Stages are timed by ProfileScope objects, optionally per viewer, and
+ * keep a rolling window of their most recent durations. Frame times are
+ * those of RView::Draw and are summarized by a histogram. The profiler is
+ * disabled by default, in which case scoped timers only test a flag. It is
+ * enabled by setting the environment variable MIRTK_VIEWER_PROFILE, which
+ * prints a summary on exit, or MIRTK_VIEWER_TRACE to the name of a file to
+ * which all timings are written in Chrome trace JSON format (cf.
+ * chrome://tracing), or by the heads-up display of the view tool.
+ */
+class MIRTK_Viewer_EXPORT Profiler
+{
+public:
+
+  /// Number of recent durations kept per stage
+  static const int WindowSize = 128;
+
+  /// Number of frame time histogram bins, bin i < 2^i ms except the last
+  static const int HistogramSize = 8;
+
+  /// Timings of a stage
+  struct Stage
+  {
+    long   Count;
+    double Total;
+    double Max;
+    double Window[WindowSize];
+
+    /// Mean of recent durations in seconds
+    double Mean() const;
+
+    /// Last duration in seconds
+    double Last() const;
+  };
+
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  /// Whether timers and counters are recorded
+  std::atomic<bool> _Enabled;
+
+  /// Whether profiler was enabled by the environment
+  bool _Environment;
+
+  /// Start time of timestamps
+  Clock::time_point _Start;
+
+  /// Stages by name and viewer, -1 if not viewer specific
+  std::map<std::pair<std::string, int>, Stage> _Stage;
+
+  /// Counters accumulated since the last frame
+  std::map<std::string, long> _Counter;
+
+  /// Counters of the last frame
+  std::map<std::string, long> _FrameCounter;
+
+  /// Frame time histogram
+  long _Histogram[HistogramSize];
+
+  /// Number of frames
+  long _Frames;
+
+  /// Trace file, NULL if not tracing
+  FILE *_Trace;
+
+  /// Small identifiers of threads for the trace
+  std::map<std::thread::id, int> _Thread;
+
+  /// Mutex guarding all of the above, stages are timed by several threads
+  mutable std::mutex _Mutex;
+
+  /// Write trace event, mutex must be held
+  void TraceEvent(const char *, char, double, double, int, long);
+
+public:
+
+  /// Constructor
+  Profiler();
+
+  /// Destructor, see Finish
+  virtual ~Profiler();
+
+  /// Finish trace file and print summary if enabled by the environment,
+  /// called on exit if the profiler is not destroyed before
+  void Finish();
+
+  /// Enable or disable recording
+  void Enable(bool);
+
+  /// Whether recording is enabled
+  bool IsEnabled() const;
+
+  /// Whether profiler was enabled by the environment
+  bool IsEnabledByEnvironment() const;
+
+  /// Write timings to Chrome trace file, enables profiler
+  bool OpenTrace(const char *);
+
+  /// Finish trace file
+  void CloseTrace();
+
+  /// Time in seconds since construction
+  double Now() const;
+
+  /// Record duration of stage from start to end time (cf. Now)
+  void Record(const char *, int, double, double);
+
+  /// Add to counter of current frame
+  void Count(const char *, long);
+
+  /// End frame which was drawn in the given time in seconds
+  void EndFrame(double);
+
+  /// Discard all timings and counters
+  void Reset();
+
+  /// Get copy of stage timings
+  std::map<std::pair<std::string, int>, Stage> GetStages() const;
+
+  /// Get counters of last frame
+  std::map<std::string, long> GetCounters() const;
+
+  /// Get frame time histogram
+  void GetHistogram(long [HistogramSize]) const;
+
+  /// Summary of timings, one stage, counter or histogram per line
+  std::string Report() const;
+
+};
+
+/**
+ * Times the enclosing scope as a stage of the profiler
+ */
+class MIRTK_Viewer_EXPORT ProfileScope
+{
+
+  /// Profiler, NULL if disabled
+  Profiler *_Profiler;
+
+  /// Name of stage
+  const char *_Name;
+
+  /// Viewer index or -1
+  int _Viewer;
+
+  /// Start time
+  double _Start;
+
+public:
+
+  /// Start timing of stage
+  ProfileScope(Profiler &, const char *, int = -1);
+
+  /// Record duration of stage
+  ~ProfileScope();
+
+};
+
+inline bool Profiler::IsEnabled() const
+{
+  return _Enabled;
+}
+
+inline bool Profiler::IsEnabledByEnvironment() const
+{
+  return _Environment;
+}
+
+inline ProfileScope::ProfileScope(Profiler &profiler, const char *name, int viewer)
+{
+  _Profiler = profiler.IsEnabled() ? &profiler : NULL;
+  _Name     = name;
+  _Viewer   = viewer;
+  _Start    = _Profiler ? _Profiler->Now() : 0;
+}
+
+inline ProfileScope::~ProfileScope()
+{
+  if (_Profiler) _Profiler->Record(_Name, _Viewer, _Start, _Profiler->Now());
+}
+
+#endif
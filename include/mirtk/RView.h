@@ -14,6 +14,10 @@
 #define _RVIEW_H
 
 #include <iostream>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include <mirtk/ViewerExport.h>
 #include <mirtk/IOConfig.h>
@@ -93,6 +97,8 @@ enum RegionGrowingMode { RegionGrowing2D, RegionGrowing3D };
 #endif
 
 #include <list>
+#include <string>
+#include <vector>
 
 #if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
 #include <vtkPointSet.h>
@@ -103,15 +109,23 @@ enum RegionGrowingMode { RegionGrowing2D, RegionGrowing3D };
 
 #define MAX_SEGMENTS 256
 
-#define MAX_NUMBER_OF_OBJECTS 40
-
 #include <mirtk/SegmentTable.h>
 
 #include <mirtk/LookupTable.h>
+#include <mirtk/LandmarkFit.h>
+#include <mirtk/LandmarkIndex.h>
 #include <mirtk/Viewer.h>
 #include <mirtk/RViewConfig.h>
 #include <mirtk/HistogramWindow.h>
 #include <mirtk/VoxelContour.h>
+#include <mirtk/ImagePyramid.h>
+#include <mirtk/ImageSequenceLoader.h>
+#include <mirtk/ImageStatistics.h>
+#include <mirtk/SliceCache.h>
+#include <mirtk/ObjectSequence.h>
+#include <mirtk/BufferPool.h>
+#include <mirtk/TransformationMailbox.h>
+#include <mirtk/Profiler.h>
 
 
 class MIRTK_Viewer_EXPORT RView
@@ -140,9 +154,79 @@ protected:
   /// Source image
   mirtk::Image *_sourceImage;
 
+  /// Downsampled target images for zoomed out display
+  ImagePyramid _targetPyramid;
+
+  /// Downsampled source images for zoomed out display
+  ImagePyramid _sourcePyramid;
+
+  /// Flag whether to reslice from downsampled images when zoomed out
+  bool _UsePyramid;
+
+  /// Flag whether to downsample memory-mapped images as well, which
+  /// requires reading the whole file (cf. PyramidOn)
+  bool _UsePyramidOfMappedImages;
+
+  /// Pyramid level the displayed target slices await (0 if none)
+  int _targetPyramidLevel;
+
+  /// Pyramid level the displayed source slices await (0 if none)
+  int _sourcePyramidLevel;
+
+  /// Next voxel for exact intensity range of target (-1 if range is exact)
+  long _targetRangeVoxel;
+
+  /// Next voxel for exact intensity range of source (-1 if range is exact)
+  long _sourceRangeVoxel;
+
+  /// Target intensity range of voxels processed so far
+  double _targetRangeMin, _targetRangeMax;
+
+  /// Source intensity range of voxels processed so far
+  double _sourceRangeMin, _sourceRangeMax;
+
+  /// Thread computing the exact intensity ranges of memory-mapped images
+  std::thread _rangeThread;
+
+  /// Whether range thread should terminate
+  std::atomic<bool> _rangeStop;
+
+  /// Whether range thread has processed all voxels
+  std::atomic<bool> _rangeDone;
+
+  /// Target and source intensity ranges computed by range thread
+  double _rangeResult[4];
+
+  /// Stop computation of exact intensity ranges by range thread
+  void StopIntensityRange();
+
+  /// Background reader of target image sequence
+  ImageSequenceLoader _targetLoader;
+
+  /// Background reader of source image sequence
+  ImageSequenceLoader _sourceLoader;
+
+  /// Intensity statistics of target image
+  ImageStatistics _targetStatistics;
+
+  /// Intensity statistics of source image
+  ImageStatistics _sourceStatistics;
+
+  /// Initialize default display window from image statistics
+  void InitializeDisplayRange(const ImageStatistics &, double, double, double &, double &);
+
+  /// Set exact target intensity range
+  void SetTargetRange(double, double);
+
+  /// Set exact source intensity range
+  void SetSourceRange(double, double);
+
   /// Segmentation image
   mirtk::GreyImage *_segmentationImage;
 
+  /// Version of segmentation image, bumped when it is read or edited
+  unsigned long _segmentationVersion;
+
   /// Segment Table
   SegmentTable *_segmentTable;
 
@@ -170,6 +254,12 @@ protected:
   /// Displacement field used to cache source transformation
   mirtk::ImageTransformationCache _sourceTransformCache;
 
+  /// Version of source transformation, bumped when it or its parameters change
+  unsigned long _sourceTransformVersion;
+
+  /// Version of source transformation whose displacements are cached
+  unsigned long _sourceTransformCacheVersion;
+
   /// Whether to cache displacements or not
   bool _CacheDisplacements;
 
@@ -197,6 +287,28 @@ protected:
   /// Source landmarks (pointset)
   mirtk::PointSet _sourceLandmarks;
 
+  /// Version of target landmarks, bumped on each edit
+  unsigned long _targetLandmarksVersion;
+
+  /// Version of source landmarks, bumped on each edit
+  unsigned long _sourceLandmarksVersion;
+
+  /// Target landmarks sorted along viewer plane normals
+  LandmarkIndex _targetLandmarkIndex;
+
+  /// Source landmarks mapped into target space and sorted along viewer plane normals
+  LandmarkIndex _sourceLandmarkIndex;
+
+  /// Fit of linear transformation to landmark correspondences
+  LandmarkFit _landmarkFit;
+
+  /// Latest DOFs of source transformation published by a running registration
+  TransformationMailbox _sourceTransformMailbox;
+
+  /// Target landmarks mapped by the inverse source transformation for drawing
+  /// correspondences, updated on first use after landmarks or transformation changed
+  LandmarkIndex _correspondenceIndex;
+
   /// Contour
   VoxelContour _voxelContour;
 
@@ -207,11 +319,8 @@ protected:
   ViewerMode _contourViewerMode;
 
 #if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
-  /// Number of vtk objects
-  int _NoOfObjects;
-
-  /// Object (surface or mesh)
-  vtkPointSet *_Object[MAX_NUMBER_OF_OBJECTS];
+  /// Objects (surfaces or meshes), read when first displayed
+  ObjectSequence _Objects;
 
   /// Flag for display object as a movie
   bool _ObjectMovie;
@@ -221,6 +330,10 @@ protected:
   /// Combined source and target images in OpenGL format
   Color **_drawable;
 
+  /// Memory of drawables and output images of all viewers, reused when
+  /// the viewers are resized or reconfigured
+  BufferPool _buffers;
+
   /// Color lookup table for target image
   LookupTable *_targetLookupTable;
 
@@ -248,6 +361,18 @@ protected:
   /// Subtraction display value range
   double _subtractionDisplayMin, _subtractionDisplayMax;
 
+  /// Files of target image (sequence), empty if not read from file
+  std::vector<std::string> _targetFileName;
+
+  /// Files of source image (sequence), empty if not read from file
+  std::vector<std::string> _sourceFileName;
+
+  /// File of segmentation image
+  std::string _segmentationFileName;
+
+  /// File of source transformation
+  std::string _transformationFileName;
+
   /// Target frame
   int _targetFrame;
 
@@ -300,6 +425,36 @@ protected:
   /// Interpolator for segmentation image
   mirtk::InterpolateImageFunction *_segmentationInterpolator;
 
+  /// Fast interpolator for target image used during interaction
+  mirtk::InterpolateImageFunction *_targetFastInterpolator;
+
+  /// Fast interpolator for source image used during interaction
+  mirtk::InterpolateImageFunction *_sourceFastInterpolator;
+
+  /// Flag for progressive rendering (fast interpolation during interaction)
+  bool _Progressive;
+
+  /// Flag whether user is currently interacting with the viewer
+  bool _Interactive;
+
+  /// Cache of displayed slices, e.g., for cine playback
+  SliceCache _sliceCache;
+
+  /// Flag whether displayed slices are cached
+  bool _CacheSlices;
+
+  /// Get key identifying the currently displayed slices
+  void GetSliceCacheKey(SliceCache::Key &);
+
+  /// Copy displayed slices of all viewers from cache, returns false if not cached
+  bool RestoreSlices(const SliceCache::Key &);
+
+  /// Copy displayed slices of all viewers into cache
+  void StoreSlices(const SliceCache::Key &);
+
+  /// Timings of update and draw stages
+  Profiler _profiler;
+
   /// Interpolator for selection image
   mirtk::InterpolateImageFunction *_selectionInterpolator;
 
@@ -434,6 +589,69 @@ protected:
   bool _DisplayObjectGrid;
 #endif
 
+  /// Background thread for asynchronous updates
+  std::thread _updateThread;
+
+  /// Guards viewer state against concurrent access by update thread
+  std::recursive_mutex _updateMutex;
+
+  /// Held by update thread while it reslices without holding the lock, and
+  /// by the GUI thread before it replaces images, interpolators or cached
+  /// displacements used for this (cf. LockResources)
+  std::recursive_mutex _resliceMutex;
+
+  /// Filter used by update thread to reslice target and source images
+  mirtk::ImageTransformation _resliceFilter;
+
+  /// Slice resliced by update thread, copied to viewer output if still current
+  mirtk::GreyImage _resliceOutput;
+
+  /// Copy of source transformation used by update thread
+  mirtk::Transformation *_resliceTransform;
+
+  /// Version of source transformation copied by update thread
+  unsigned long _resliceTransformVersion;
+
+  /// Signals update thread that an update was requested
+  std::condition_variable_any _updateCondition;
+
+  /// Incremented whenever an update is requested, cancels update in progress
+  std::atomic<unsigned long> _updateGeneration;
+
+  /// Generation of most recently completed update
+  std::atomic<unsigned long> _updateCompleted;
+
+  /// Generation of most recent asynchronous update request
+  unsigned long _updateRequested;
+
+  /// Whether update thread should terminate
+  bool _updateStop;
+
+  /// Function called by update thread when an update completed
+  void (*_updateCallback)(void *);
+
+  /// Client data passed to update callback
+  void *_updateCallbackData;
+
+  /// Reslice and combine images, returns false if cancelled by newer update
+  bool RunUpdate(unsigned long, bool);
+
+  /// Whether an update of the given generation may continue
+  bool UpdateCheckpoint(unsigned long, bool);
+
+  /// Reslice target or source image of viewer without holding the lock,
+  /// returns false if the slice was superseded meanwhile
+  bool ResliceUnlocked(unsigned long, int, bool, mirtk::Image *, mirtk::InterpolateImageFunction *);
+
+  /// Lock viewer state and wait for the slice resliced by update thread
+  void LockResources();
+
+  /// Unlock resources and viewer state
+  void UnlockResources();
+
+  /// Main loop of update thread
+  void UpdateThread();
+
 public:
 
   /// Constructor
@@ -445,16 +663,41 @@ public:
   /// Render
   void Draw();
 
-  /// Render offscreen
+  /// Render offscreen and write screenshot to file
   void DrawOffscreen(char *);
 
+  /// Render offscreen into RGB buffer of GetWidth() x GetHeight() pixels,
+  /// top row first
+  void DrawOffscreen(unsigned char *);
+
   /// Update registration viewer
   void Update();
 
+  /// Update registration viewer in background, cancelling update in progress
+  void UpdateAsync();
+
+  /// Set function called by background thread when an update completed
+  void SetUpdateCallback(void (*)(void *), void *);
+
+  /// Whether the most recently requested update has not completed yet
+  bool IsUpdating();
+
+  /// Lock viewer state against concurrent access by background update
+  void Lock();
+
+  /// Unlock viewer state
+  void Unlock();
+
   /// Set update of source transformation to on
   void SourceUpdateOn();
 
-  /// Set update of segmentation transformation to on
+  /// Notify viewer that parameters of the source transformation were modified
+  void SourceTransformModified();
+
+  /// Version of source transformation, bumped when it or its parameters change
+  unsigned long GetSourceTransformVersion() const;
+
+  /// Set update of segmentation to on after its image was edited
   void SegmentationUpdateOn();
 
   /// Resize registration viewer
@@ -466,23 +709,35 @@ public:
   /// Configure registration viewer
   virtual void Configure(RViewConfig []);
 
-  /// Read configuration
-  virtual void Read(char *);
+  /// Read session or configuration file of an earlier release, returns
+  /// false if the file cannot be read, malformed lines are skipped
+  virtual bool Read(char *);
 
-  /// Write configuration
-  virtual void Write(char *);
+  /// Write session file capturing the complete viewer state, i.e., images,
+  /// frames, geometry, display ranges, overlays, segments and landmarks
+  virtual bool Write(char *);
 
   /// Read target image
   virtual void ReadTarget(char *);
 
-  /// Read target image sequence
-  virtual void ReadTarget(int, char **);
+  /// Read target image sequence, optionally reading all but the first
+  /// frame in the background (see LoadFrames)
+  virtual void ReadTarget(int, char **, bool = false);
+
+  /// Set target image which was read before, the viewer takes ownership.
+  /// The intensity range is computed unless a valid one (min <= max) is given.
+  virtual void SetTarget(mirtk::Image *, double = 0, double = -1);
 
   /// Read source image
   virtual void ReadSource(char *);
 
-  /// Read source image sequence
-  virtual void ReadSource(int, char **);
+  /// Read source image sequence, optionally reading all but the first
+  /// frame in the background (see LoadFrames)
+  virtual void ReadSource(int, char **, bool = false);
+
+  /// Set source image which was read before, the viewer takes ownership.
+  /// The intensity range is computed unless a valid one (min <= max) is given.
+  virtual void SetSource(mirtk::Image *, double = 0, double = -1);
 
   /// Read segmentation image
   virtual void ReadSegmentation(char *);
@@ -502,6 +757,10 @@ public:
   /// Write transformation
   virtual void WriteTransformation(char *);
 
+  /// Replace transformation by given one (takes ownership), reusing the
+  /// existing transformation filters and displacement cache
+  virtual void SwapTransformation(mirtk::Transformation *);
+
   /// Read target landmarks
   virtual void ReadTargetLandmarks(char *);
 
@@ -515,8 +774,8 @@ public:
   virtual void WriteSourceLandmarks(char *);
 
 #if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
-  /// Read object
-  virtual void ReadObject(const char *);
+  /// Read object, returns false if its file cannot be read
+  virtual bool ReadObject(const char *);
 
   /// Remove object
   virtual void RemoveObject();
@@ -524,6 +783,12 @@ public:
   /// Return object
   virtual vtkPointSet *GetObject(int);
 
+  /// Return number of objects
+  int GetNumberOfObjects();
+
+  /// Set memory budget of objects in bytes
+  void SetObjectBudget(size_t);
+
   /// Turn display of object movie
   void ObjectMovieOn();
 
@@ -573,6 +838,12 @@ public:
   /// Get source frame
   int GetSourceFrame();
 
+  /// Get number of target frames which can be displayed
+  int GetNumberOfTargetFrames();
+
+  /// Get number of source frames which can be displayed
+  int GetNumberOfSourceFrames();
+
   /// Get minimum target intensity
   double GetTargetMin();
   
@@ -591,6 +862,30 @@ public:
   /// Get maximum subtraction intensity
   double GetSubtractionMax();
   
+  /// Continue computation of exact intensity range of memory-mapped images
+  /// for the given number of voxels, returns false when done
+  bool RefineIntensityRange(long = 16777216);
+
+  /// Compute exact intensity range of memory-mapped images in a background
+  /// thread, to be called periodically until it returns false, which applies
+  /// the ranges once the thread is done
+  bool RefineIntensityRangeAsync();
+
+  /// Get intensity statistics of target image, computing them if needed
+  const ImageStatistics &GetTargetStatistics();
+
+  /// Get intensity statistics of source image, computing them if needed
+  const ImageStatistics &GetSourceStatistics();
+
+  /// Check progress of background reading of image sequences and complete
+  /// it once all frames are read, returns false when done
+  bool LoadFrames();
+
+  /// Check whether the pyramid levels computed in the background for the
+  /// displayed slices are ready, optionally waiting for them, and returns
+  /// true if the slices have to be updated to reslice from these
+  bool UpdatePyramids(bool = false);
+
   /// Set ROI to default parameters
   void ResetROI();
 
@@ -953,6 +1248,49 @@ public:
   /// Get interpolation model fo target image
   mirtk::InterpolationMode GetSourceInterpolationMode();
 
+  /// Turn progressive rendering on
+  void ProgressiveOn();
+
+  /// Turn progressive rendering off
+  void ProgressiveOff();
+
+  /// Return progressive rendering
+  bool GetProgressive();
+
+  /// Turn reslicing from downsampled images when zoomed out on,
+  /// including memory-mapped images which are otherwise not downsampled
+  void PyramidOn();
+
+  /// Turn reslicing from downsampled images when zoomed out off
+  void PyramidOff();
+
+  /// Return reslicing from downsampled images when zoomed out
+  bool GetPyramid();
+
+  /// Turn caching of displayed slices for cine playback on
+  void SliceCacheOn();
+
+  /// Turn caching of displayed slices off and discard cached slices
+  void SliceCacheOff();
+
+  /// Return caching of displayed slices
+  bool GetSliceCache();
+
+  /// Set memory budget of slice cache in bytes
+  void SetSliceCacheBudget(size_t);
+
+  /// Get memory budget of slice cache in bytes
+  size_t GetSliceCacheBudget();
+
+  /// Get timings of update and draw stages
+  Profiler &GetProfiler();
+
+  /// Begin interaction, reslice with fast interpolation if progressive
+  void BeginInteraction();
+
+  /// End interaction, reslice with configured interpolation again
+  void EndInteraction();
+
   /// Set transformation apply flag for source image
   void SetSourceTransformApply(bool);
 
@@ -1100,9 +1438,20 @@ public:
   /// Return number of source landmarks
   int GetNumberOfSourceLandmarks();
 
-  /// Approximate transformation using landmark correspondences
+  /// Approximate transformation using landmark correspondences, returns the
+  /// mean residual in mm or -1 if there are too few or degenerate landmarks
   double FitLandmarks();
 
+  /// Get model, outlier treatment and residuals of landmark fit
+  LandmarkFit &GetLandmarkFit();
+
+  /// Get mailbox to which a running registration publishes its DOFs
+  TransformationMailbox &GetTransformationMailbox();
+
+  /// Copy latest DOFs published to the mailbox into the source transformation,
+  /// returns whether the transformation was changed and needs to be redrawn
+  bool FetchTransformation();
+
   /// Callback method for function keys
   void cb_special(int key, int x, int y,
                   int target_delta, int source_delta);
@@ -1118,14 +1467,64 @@ public:
 
 };
 
+inline void RView::Lock()
+{
+  _updateMutex.lock();
+}
+
+inline void RView::Unlock()
+{
+  _updateMutex.unlock();
+}
+
+inline void RView::LockResources()
+{
+  _updateMutex.lock();
+  _resliceMutex.lock();
+}
+
+inline void RView::UnlockResources()
+{
+  _resliceMutex.unlock();
+  _updateMutex.unlock();
+}
+
+inline bool RView::IsUpdating()
+{
+  return _updateCompleted != _updateGeneration;
+}
+
+inline void RView::SetUpdateCallback(void (*f)(void *), void *data)
+{
+  Lock();
+  _updateCallback     = f;
+  _updateCallbackData = data;
+  Unlock();
+}
+
 inline void RView::SourceUpdateOn()
 {
   _sourceUpdate = true;
 }
 
+inline void RView::SourceTransformModified()
+{
+  // Cached displacements are marked as modified by the next update
+  Lock();
+  _sourceTransformVersion++;
+  _sourceUpdate = true;
+  Unlock();
+}
+
+inline unsigned long RView::GetSourceTransformVersion() const
+{
+  return _sourceTransformVersion;
+}
+
 inline void RView::SegmentationUpdateOn()
 {
   _segmentationUpdate = true;
+  _segmentationVersion++;
 }
 
 
@@ -1171,6 +1570,84 @@ inline void RView::SetConfigMode(ConfigViewerMode configMode)
   _configMode = configMode;
 }
 
+inline void RView::PyramidOn()
+{
+  _UsePyramid   = true;
+  _UsePyramidOfMappedImages = true;
+  _targetUpdate = true;
+  _sourceUpdate = true;
+}
+
+inline void RView::PyramidOff()
+{
+  _UsePyramid   = false;
+  _UsePyramidOfMappedImages = false;
+  _targetUpdate = true;
+  _sourceUpdate = true;
+}
+
+inline bool RView::GetPyramid()
+{
+  return _UsePyramid;
+}
+
+inline void RView::SliceCacheOn()
+{
+  _CacheSlices = true;
+}
+
+inline void RView::SliceCacheOff()
+{
+  _CacheSlices = false;
+  _sliceCache.Clear();
+}
+
+inline bool RView::GetSliceCache()
+{
+  return _CacheSlices;
+}
+
+inline void RView::SetSliceCacheBudget(size_t budget)
+{
+  _sliceCache.SetBudget(budget);
+}
+
+inline size_t RView::GetSliceCacheBudget()
+{
+  return _sliceCache.GetBudget();
+}
+
+inline Profiler &RView::GetProfiler()
+{
+  return _profiler;
+}
+
+inline LandmarkFit &RView::GetLandmarkFit()
+{
+  return _landmarkFit;
+}
+
+inline TransformationMailbox &RView::GetTransformationMailbox()
+{
+  return _sourceTransformMailbox;
+}
+
+inline void RView::ProgressiveOn()
+{
+  _Progressive = true;
+}
+
+inline void RView::ProgressiveOff()
+{
+  this->EndInteraction();
+  _Progressive = false;
+}
+
+inline bool RView::GetProgressive()
+{
+  return _Progressive;
+}
+
 inline void RView::SetViewMix(double value)
 {
   _viewMix = value;
@@ -1554,11 +2031,21 @@ inline bool RView::GetViewTAG()
 
 inline vtkPointSet *RView::GetObject(int i)
 {
-  if ((i < 0) || (i > _NoOfObjects-1)) {
+  if ((i < 0) || (i > _Objects.Size()-1)) {
     std::cerr << "RView::GetObject: Invalid object: " << i << std::endl;
     return NULL;
   }
-  return _Object[i];
+  return _Objects.Get(i)->GetObject();
+}
+
+inline int RView::GetNumberOfObjects()
+{
+  return _Objects.Size();
+}
+
+inline void RView::SetObjectBudget(size_t budget)
+{
+  _Objects.SetBudget(budget);
 }
 
 inline void RView::ObjectMovieOn()
@@ -1847,12 +2334,14 @@ inline void RView::AddTargetLandmark(mirtk::Point &point, char *)
 {
   // Add landmark as point, ignoring label for now
   _targetLandmarks.Add(point);
+  _targetLandmarksVersion++;
 }
 
 inline void RView::AddSourceLandmark(mirtk::Point &point, char *)
 {
   // Add landmark as point, ignoring label for now	
 	_sourceLandmarks.Add(point);
+  _sourceLandmarksVersion++;
 }
 
 inline void RView::DeleteTargetLandmark(int id)
@@ -1862,6 +2351,7 @@ inline void RView::DeleteTargetLandmark(int id)
     DeselectTargetLandmark(id);
     mirtk::Point p = _targetLandmarks(id-1);
     _targetLandmarks.Del(p);
+    _targetLandmarksVersion++;
   }
 }
 
@@ -1872,6 +2362,7 @@ inline void RView::DeleteSourceLandmark(int id)
     DeselectSourceLandmark(id);
     mirtk::Point p = _sourceLandmarks(id-1);
     _sourceLandmarks.Del(p);
+    _sourceLandmarksVersion++;
   }
 }
 
@@ -1880,6 +2371,7 @@ inline void RView::InsertTargetLandmark(mirtk::Point &point, int id, char *)
   // Insert landmark, ignoring label for now
   if (_targetLandmarks.Size() == 0) {
     _targetLandmarks.Add(point);
+    _targetLandmarksVersion++;
   } else if ((id > 0) && (id <= _targetLandmarks.Size())) {
     // Would be nice to call an mirtk::PointSet::Insert method...
     int i;
@@ -1892,6 +2384,7 @@ inline void RView::InsertTargetLandmark(mirtk::Point &point, int id, char *)
     for (i = id; i <= pset.Size(); i++) {
       _targetLandmarks.Add(pset(i-1));
     }
+    _targetLandmarksVersion++;
   } else {
     std::cerr << "RView::InsertTargetLandmark : invalid position " << id << std::endl;
   }
@@ -1902,6 +2395,7 @@ inline void RView::InsertSourceLandmark(mirtk::Point &point, int id, char *)
   // Insert landmark, ignoring label for now
   if (_sourceLandmarks.Size() == 0) {
     _sourceLandmarks.Add(point);
+    _sourceLandmarksVersion++;
   } else if ((id > 0) && (id <= _sourceLandmarks.Size())) {
     // Would be nice to call an mirtk::PointSet::Insert method...
     int i;
@@ -1914,6 +2408,7 @@ inline void RView::InsertSourceLandmark(mirtk::Point &point, int id, char *)
     for (i = id; i <= pset.Size(); i++) {
       _sourceLandmarks.Add(pset(i-1));
     }
+    _sourceLandmarksVersion++;
   } else {
     std::cerr << "RView::InsertSourceLandmark : invalid position " << id << std::endl;
   }
@@ -1950,6 +2445,7 @@ inline void RView::PutTargetLandmark(mirtk::Point point, int id, char *)
   // Put landmark in list, ignoring label for now
   if ((id > 0) && (id <= _targetLandmarks.Size())) {
     _targetLandmarks(id-1) = point;
+    _targetLandmarksVersion++;
   }
 }
 
@@ -1958,6 +2454,7 @@ inline void RView::PutSourceLandmark(mirtk::Point point, int id, char *)
   // Put landmark in list, ignoring label for now
   if ((id > 0) && (id <= _sourceLandmarks.Size())) {
     _sourceLandmarks(id-1) = point;
+    _sourceLandmarksVersion++;
   }
 }
 
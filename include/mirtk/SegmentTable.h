@@ -36,6 +36,9 @@ protected:
   /// Segment Table
   Segment _entry[std::numeric_limits<short>::max() + 1];
 
+  /// Version of segment table, bumped when any segment is modified
+  unsigned long _version;
+
 public:
 
 /// Constructor (basic)
@@ -86,6 +89,9 @@ public:
   /// Find if entry contains valid value
   bool IsValid(int);
 
+  /// Version of segment table, changes whenever a segment is modified
+  unsigned long GetVersion() const;
+
   /// Remove segment with index
   void Clear(int);
 
@@ -100,6 +106,11 @@ public:
 };
 
 
+inline unsigned long SegmentTable::GetVersion() const
+{
+  return _version;
+}
+
 inline void SegmentTable::GetColor(int id, unsigned char* r, unsigned char* g, unsigned char* b)
 {
   _entry[id].getColor(r, g, b);
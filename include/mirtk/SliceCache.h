@@ -0,0 +1,111 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SLICECACHE_H
+#define _SLICECACHE_H
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+
+
+/**
+ * Least recently used cache of resliced and composited slices
+ *
+ * Each entry holds one buffer per viewer with the voxels of the slices as
+ * displayed for a given state of the viewer, e.g., during cine playback.
+ * The state is identified by a key of all parameters which affect the
+ * displayed slices, such as plane geometry, time frames, lookup tables
+ * and view mode. Least recently used entries are discarded when the total
+ * size of all buffers exceeds the memory budget.
+ */
+class MIRTK_Viewer_EXPORT SliceCache
+{
+
+public:
+
+  /// Parameters which identify the displayed slices
+  typedef std::vector<double> Key;
+
+  /// Buffer for each viewer
+  typedef std::vector<std::vector<char> > Buffers;
+
+private:
+
+  /// Cached entries, most recently used first
+  std::list<std::pair<Key, Buffers> > _Entries;
+
+  /// Index of cached entries
+  std::map<Key, std::list<std::pair<Key, Buffers> >::iterator> _Index;
+
+  /// Memory budget in bytes
+  size_t _Budget;
+
+  /// Total size of buffers in bytes
+  size_t _Size;
+
+  /// Discard least recently used entries until size is within budget
+  void Evict();
+
+public:
+
+  /// Constructor
+  SliceCache(size_t = 0);
+
+  /// Set memory budget in bytes, a budget of zero disables the cache
+  void SetBudget(size_t);
+
+  /// Get memory budget in bytes
+  size_t GetBudget() const;
+
+  /// Total size of buffers in bytes
+  size_t Size() const;
+
+  /// Number of cached entries
+  int NumberOfEntries() const;
+
+  /// Discard all entries
+  void Clear();
+
+  /// Find entry and mark it as most recently used, returns NULL if not cached
+  const Buffers *Find(const Key &);
+
+  /// Insert entry, taking over the given buffers
+  void Insert(const Key &, Buffers &);
+
+};
+
+inline size_t SliceCache::GetBudget() const
+{
+  return _Budget;
+}
+
+inline size_t SliceCache::Size() const
+{
+  return _Size;
+}
+
+inline int SliceCache::NumberOfEntries() const
+{
+  return static_cast<int>(_Entries.size());
+}
+
+#endif
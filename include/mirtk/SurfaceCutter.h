@@ -0,0 +1,145 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SURFACECUTTER_H
+#define _SURFACECUTTER_H
+
+#include <mirtk/IOConfig.h>
+
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+
+#include <cstddef>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Transformation.h>
+
+#include <vtkPointSet.h>
+
+class vtkCell;
+class vtkIdList;
+class vtkPoints;
+
+
+/**
+ * Cuts of a surface or mesh with viewer planes
+ *
+ * The faces of the object are triangulated once. For each plane normal,
+ * the triangles are sorted into buckets of their extent along the normal
+ * such that only the triangles of one bucket need to be tested when the
+ * object is cut. The resulting line segments are cached per plane and
+ * transformation, as these only change when the slice or the
+ * transformation of a warped object changes. A warped object is cut after
+ * its vertices were mapped in parallel once per transformation, and both
+ * the original and the warped vertices are kept such that toggling the
+ * warp does not require either to be recomputed.
+ */
+class MIRTK_Viewer_EXPORT SurfaceCutter
+{
+
+  /// Triangles sorted into buckets along a plane normal
+  struct Buckets
+  {
+    bool   Warped;
+    double Normal[3];
+    double Min, Max, Width;
+    std::vector<int> Offset;
+    std::vector<int> Triangle;
+  };
+
+  /// Line segments of a cut
+  struct Cut
+  {
+    std::vector<double> Key;
+    std::vector<double> Segments;
+  };
+
+  /// Object (not owned)
+  vtkPointSet *_Object;
+
+  /// Modification time of object when it was triangulated
+  vtkMTimeType _MTime;
+
+  /// Points of object
+  std::vector<double> _Point;
+
+  /// Points of object mapped by transformation
+  std::vector<double> _WarpedPoint;
+
+  /// Key of transformation the warped points were computed for
+  std::vector<double> _WarpKey;
+
+  /// Point indices of triangles
+  std::vector<int> _Index;
+
+  /// Buckets of recently displayed plane orientations
+  std::vector<Buckets> _Buckets;
+
+  /// Recently computed cuts
+  std::vector<Cut> _Cuts;
+
+  /// Triangulate faces of object
+  void Triangulate();
+
+  /// Append triangles of two-dimensional cell to index
+  void AddTriangles(vtkCell *, vtkIdList *, vtkPoints *);
+
+  /// Map points by transformation if it changed
+  void Warp(const mirtk::Transformation *, unsigned long);
+
+  /// Get buckets of triangles of original or warped points for plane normal
+  const Buckets &GetBuckets(const double *, bool);
+
+public:
+
+  /// Constructor
+  SurfaceCutter(vtkPointSet * = NULL);
+
+  /// Set object to cut
+  void Initialize(vtkPointSet *);
+
+  /// Get object
+  vtkPointSet *GetObject() const;
+
+  /// Number of triangles
+  int NumberOfTriangles() const;
+
+  /// Memory used for triangles, buckets and cached cuts in bytes
+  size_t MemorySize() const;
+
+  /// Cut object with plane given by a point and its normal, returns pairs of
+  /// end points of line segments in world coordinates. If the transformation
+  /// is not NULL, the object warped by it is cut, where the version bumped on
+  /// each change of its parameters identifies changes of the transformation.
+  const std::vector<double> &Run(const double *, const double *, const mirtk::Transformation * = NULL, unsigned long = 0);
+
+};
+
+inline vtkPointSet *SurfaceCutter::GetObject() const
+{
+  return _Object;
+}
+
+inline int SurfaceCutter::NumberOfTriangles() const
+{
+  return static_cast<int>(_Index.size() / 3);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _TRANSFORMATIONMAILBOX_H
+#define _TRANSFORMATIONMAILBOX_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Transformation.h>
+
+
+/**
+ * Single-slot mailbox for snapshots of the parameters of a transformation
+ *
+ * A running registration publishes the current DOFs whenever its optimizer
+ * made a step, while the viewer fetches the latest snapshot at its own frame
+ * rate. Snapshots which were overwritten before the viewer fetched them are
+ * dropped. Neither side ever waits for the other: the mailbox is a triple
+ * buffer whose slots are exchanged with a single atomic operation. There
+ * must be at most one publishing and one fetching thread at a time, hence
+ * a publisher has to Attach to the mailbox first, which fails while
+ * another one is attached.
+ *
+ * Snapshots can also be received from another process via a local socket
+ * (cf. Listen), which attaches for as long as a client is connected. The
+ * protocol is plain text, one snapshot per line with the DOF values
+ * separated by white space, such that a stand-in for a registration can be
+ * as simple as
+ *
+ *   socat - UNIX-CONNECT:/tmp/view.sock < dofs.txt
+ *
+ * or the publish_dofs tool, which animates a sequence of .dof files.
+ */
+class MIRTK_Viewer_EXPORT TransformationMailbox
+{
+
+  /// Slots of triple buffer
+  std::vector<double> _Slot[3];
+
+  /// Slot being written by the publisher
+  int _Back;
+
+  /// Slot last fetched by the viewer
+  int _Front;
+
+  /// Slot holding the latest snapshot, or'ed with a flag if not yet fetched
+  std::atomic<int> _Middle;
+
+  /// Number of published snapshots
+  std::atomic<long> _Published;
+
+  /// Whether a publisher is attached
+  std::atomic<bool> _Attached;
+
+  /// Path of local socket
+  std::string _SocketPath;
+
+  /// File descriptor of local socket, -1 if not listening
+  int _Socket;
+
+  /// Thread receiving snapshots from the socket
+  std::thread _Listener;
+
+  /// Whether listener thread should terminate
+  std::atomic<bool> _Stop;
+
+  /// Listener thread main loop
+  void Serve();
+
+  /// Publish snapshot written to back slot
+  void Swap();
+
+public:
+
+  /// Constructor
+  TransformationMailbox();
+
+  /// Destructor
+  virtual ~TransformationMailbox();
+
+  /// Attach publisher, returns false if another one is attached already
+  bool Attach();
+
+  /// Detach publisher
+  void Detach();
+
+  /// Publish snapshot of given number of DOFs
+  void Publish(const double *, int);
+
+  /// Publish snapshot of the DOFs of the given transformation
+  void Publish(const mirtk::Transformation *);
+
+  /// Take the latest snapshot if a new one was published since the last call
+  bool Fetch();
+
+  /// Snapshot taken by the last successful call of Fetch
+  const std::vector<double> &Snapshot() const;
+
+  /// Number of snapshots published so far
+  long NumberOfPublished() const;
+
+  /// Receive snapshots from local socket with the given path, returns false
+  /// if the socket could not be created
+  bool Listen(const char *);
+
+  /// Stop receiving snapshots from local socket
+  void Close();
+
+};
+
+inline const std::vector<double> &TransformationMailbox::Snapshot() const
+{
+  return _Slot[_Front];
+}
+
+inline long TransformationMailbox::NumberOfPublished() const
+{
+  return _Published;
+}
+
+#endif
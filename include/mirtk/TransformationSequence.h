@@ -0,0 +1,130 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _TRANSFORMATIONSEQUENCE_H
+#define _TRANSFORMATIONSEQUENCE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mirtk/ViewerExport.h>
+#include <mirtk/Transformation.h>
+
+
+/**
+ * Ordered list of transformation files which are read ahead of playback
+ *
+ * While the viewer displays transformation i, worker threads read (and
+ * convert rigid to affine) the next transformations of the sequence such
+ * that a call to Get() usually returns without any file I/O. The returned
+ * transformation is owned by the caller, e.g., passed on to
+ * RView::SwapTransformation.
+ */
+class MIRTK_Viewer_EXPORT TransformationSequence
+{
+
+  /// File names of transformations
+  std::vector<std::string> _FileName;
+
+  /// Transformations read ahead of playback (NULL if not yet read)
+  std::vector<mirtk::Transformation *> _Transformation;
+
+  /// Whether transformation is currently read by a worker thread
+  std::vector<bool> _Pending;
+
+  /// Indices of transformations still to be read
+  std::deque<int> _Queue;
+
+  /// Number of transformations to read ahead
+  int _Prefetch;
+
+  /// Number of worker threads
+  int _NumberOfThreads;
+
+  /// Worker threads
+  std::vector<std::thread> _Worker;
+
+  /// Whether worker threads should terminate
+  bool _Stop;
+
+  /// Mutex guarding all of the above
+  std::mutex _Mutex;
+
+  /// Signals worker threads that the queue is not empty
+  std::condition_variable _QueueCondition;
+
+  /// Signals main thread that a transformation has been read
+  std::condition_variable _ReadyCondition;
+
+  /// Worker thread main loop
+  void Run();
+
+  /// Start worker threads if not running yet
+  void Start();
+
+  /// Stop worker threads
+  void Stop();
+
+  /// Enqueue next transformations after the given one (mutex must be held)
+  void Enqueue(int);
+
+public:
+
+  /// Constructor
+  TransformationSequence(int = 4, int = 2);
+
+  /// Destructor
+  virtual ~TransformationSequence();
+
+  /// Append transformation file to sequence
+  void Add(const char *);
+
+  /// Remove all transformations from sequence
+  void Clear();
+
+  /// Number of transformations in sequence
+  int Size() const;
+
+  /// Set number of transformations to read ahead
+  void SetPrefetch(int);
+
+  /// Get number of transformations to read ahead
+  int GetPrefetch() const;
+
+  /// Start reading the transformations following the given one
+  void Prefetch(int);
+
+  /// Get i-th transformation, waiting for it if still being read.
+  /// Ownership of the returned transformation is passed to the caller.
+  mirtk::Transformation *Get(int);
+
+  /// Read transformation from file, rigid transformations are converted to affine
+  static mirtk::Transformation *Read(const char *);
+
+};
+
+inline int TransformationSequence::GetPrefetch() const
+{
+  return _Prefetch;
+}
+
+#endif
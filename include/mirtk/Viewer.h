@@ -26,6 +26,9 @@
 
 class RView;
 class VoxelContour;
+class LandmarkIndex;
+class SurfaceCutter;
+class ObjectSequence;
 class MultiLevelTransformation;
 class FreeFormTransformation;
 
@@ -77,25 +80,25 @@ public:
   /// Draw control points as deformation arrows
   virtual void DrawArrows();
 
-  /// Draw landmarks
-  void DrawLandmarks(mirtk::PointSet &, std::set<int> &, mirtk::GreyImage *, int = true, int = true);
+  /// Draw landmarks within the slice, the index holds their transformed positions
+  void DrawLandmarks(LandmarkIndex &, std::set<int> &, mirtk::GreyImage *, int = true, int = true);
 
-  /// Draw landmark correspondences
-  void DrawCorrespondences(mirtk::PointSet &, mirtk::PointSet &, mirtk::GreyImage *);
+  /// Draw landmark correspondences, the index holds the inverse-mapped target landmarks
+  void DrawCorrespondences(LandmarkIndex &, mirtk::PointSet &, mirtk::GreyImage *);
 
-  /// Draw landmark correspondences
-  void DrawCorrespondences(mirtk::PointSet &, mirtk::PointSet &, std::set<int> &, mirtk::GreyImage *);
+  /// Draw landmark correspondences, the index holds the inverse-mapped target landmarks
+  void DrawCorrespondences(LandmarkIndex &, mirtk::PointSet &, std::set<int> &, mirtk::GreyImage *);
 
   /// Draw ROI
   void DrawROI(mirtk::GreyImage *image, double, double, double, double,
                double, double);
 
 #if MIRTK_IO_WITH_VTK
-  /// Draw multiple objects
-  void DrawObject(vtkPointSet **, mirtk::GreyImage *, int = false, int = false, mirtk::Transformation* = NULL);
+  /// Draw all objects, warped by the transformation of the given version if requested
+  void DrawObjects(ObjectSequence &, mirtk::GreyImage *, int = false, int = false, mirtk::Transformation* = NULL, unsigned long = 0);
 
-  /// Draw object
-  void DrawObject(vtkPointSet *, mirtk::GreyImage *, int = false, int = false, mirtk::Transformation* = NULL);
+  /// Draw object, the cutter caches its cuts with viewer planes
+  void DrawObject(SurfaceCutter *, mirtk::GreyImage *, int = false, int = false, mirtk::Transformation* = NULL, unsigned long = 0);
 #endif
 
   /// Draw information about L/R, A/P, S/I on the viewer
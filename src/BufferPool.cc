@@ -0,0 +1,71 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+
+#include <mirtk/BufferPool.h>
+
+
+BufferPool::BufferPool()
+{
+  _NumberOfAllocations = 0;
+}
+
+BufferPool::~BufferPool()
+{
+  this->Clear();
+}
+
+void *BufferPool::Get(int i, size_t n)
+{
+  size_t capacity;
+
+  if (i < 0) return NULL;
+  if (i >= static_cast<int>(_Data.size())) {
+    _Data.resize(i + 1, NULL);
+    _Capacity.resize(i + 1, 0);
+  }
+  if (n > _Capacity[i]) {
+    capacity = _Capacity[i] + _Capacity[i] / 2;
+    if (capacity < n) capacity = n;
+    ::operator delete(_Data[i]);
+    _Data[i]     = NULL;
+    _Capacity[i] = 0;
+    _Data[i]     = static_cast<char *>(::operator new(capacity));
+    _Capacity[i] = capacity;
+    _NumberOfAllocations++;
+  }
+  return _Data[i];
+}
+
+void BufferPool::Clear()
+{
+  size_t i;
+
+  for (i = 0; i < _Data.size(); i++) ::operator delete(_Data[i]);
+  _Data.clear();
+  _Capacity.clear();
+}
+
+size_t BufferPool::MemorySize() const
+{
+  size_t i, size = 0;
+
+  for (i = 0; i < _Capacity.size(); i++) size += _Capacity[i];
+  return size;
+}
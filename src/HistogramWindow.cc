@@ -50,7 +50,7 @@ void HistogramWindow::CalculateHistograms()
 
 void HistogramWindow::CalculateHistogram(int label_id)
 {
-  int i, j, k, l;
+  int i, j, k, l, b;
   double min, max;
   double value;
 
@@ -59,23 +59,25 @@ void HistogramWindow::CalculateHistogram(int label_id)
     return;
   }
 
-  _v->GetTarget()->GetMinMaxAsDouble(&min, &max);
+  // Statistics are computed once when the image is loaded
+  const ImageStatistics &stats = _v->GetTargetStatistics();
+  min = stats.Min();
+  max = stats.Max();
 
   if (label_id < 0) {
     _globalHistogram.PutMin(min);
     _globalHistogram.PutMax(max);
     _globalHistogram.PutNumberOfBins(HISTOGRAM_BINS);
 
-    for (l = 0; l < _v->GetTarget()->GetT(); l++){
-      for (k = 0; k < _v->GetTarget()->GetZ(); k++){
-        for (j = 0; j < _v->GetTarget()->GetY(); j++){
-          for (i = 0; i < _v->GetTarget()->GetX(); i++){
-               value = _v->GetTarget()->GetAsDouble(i, j, k, l);
-          	if (value!=0)_globalHistogram.AddSample(value);
-          }
-        }
+    // Merge finer bins of cached histogram, excluding zero voxels
+    for (b = 0; b < stats.NumberOfBins(); b++) {
+      if (stats.Count(b) > 0) {
+        _globalHistogram.Add(_globalHistogram.ValToBin(stats.BinCenter(b)), stats.Count(b));
       }
     }
+    if (stats.NumberOfZeros() > 0) {
+      _globalHistogram.Delete(_globalHistogram.ValToBin(.0), stats.NumberOfZeros());
+    }
   } else {
     if (_v->GetSegmentTable()->IsValid(label_id) == true) {
       _localHistogram[label_id].PutMin(min);
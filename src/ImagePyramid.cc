@@ -0,0 +1,303 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <mirtk/ImagePyramid.h>
+#include <mirtk/Parallel.h>
+
+// Maximum number of downsampled levels
+#define MAX_PYRAMID_LEVELS 8
+
+
+namespace {
+
+// Merge blocks of up to 2x2x2 voxels of one frame, either by averaging them
+// or, for label images, by their most frequent value
+struct DownsampleFrame
+{
+  const mirtk::Image      *_Input;
+  mirtk::Image            *_Output;
+  int                      _Frame;
+  int                      _Step[3];
+  bool                     _Labels;
+  const std::atomic<bool> *_Stop;
+
+  void operator ()(const mirtk::blocked_range<int> &re) const
+  {
+    int    i, j, k, i2, j2, k2, a, b, n, count, max_count;
+    double value[8], sum, mode;
+
+    for (k = re.begin(); k != re.end(); k++) {
+      if (*_Stop) return;
+      for (j = 0; j < _Output->GetY(); j++) {
+        for (i = 0; i < _Output->GetX(); i++) {
+          n = 0;
+          for (k2 = _Step[2] * k; k2 < _Step[2] * (k + 1) && k2 < _Input->GetZ(); k2++) {
+            for (j2 = _Step[1] * j; j2 < _Step[1] * (j + 1) && j2 < _Input->GetY(); j2++) {
+              for (i2 = _Step[0] * i; i2 < _Step[0] * (i + 1) && i2 < _Input->GetX(); i2++) {
+                value[n++] = _Input->GetAsDouble(i2, j2, k2, _Frame);
+              }
+            }
+          }
+          if (_Labels) {
+            // Ties are resolved in favour of the first voxel of the block
+            mode      = value[0];
+            max_count = 0;
+            for (a = 0; a < n; a++) {
+              count = 0;
+              for (b = a; b < n; b++) {
+                if (value[b] == value[a]) count++;
+              }
+              if (count > max_count) {
+                mode      = value[a];
+                max_count = count;
+              }
+            }
+            _Output->PutAsDouble(i, j, k, _Frame, mode);
+          } else {
+            sum = 0;
+            for (a = 0; a < n; a++) sum += value[a];
+            _Output->PutAsDouble(i, j, k, _Frame, sum / n);
+          }
+        }
+      }
+    }
+  }
+};
+
+// Whether an axis of given size and voxel size is halved for a level whose
+// voxels must not be larger than the given size
+inline bool HalveAxis(int n, double voxel, double max_voxel)
+{
+  return n > 1 && 2 * voxel <= max_voxel * (1 + 1e-6);
+}
+
+}
+
+
+ImagePyramid::ImagePyramid()
+{
+  _Image     = NULL;
+  _Labels    = false;
+  _VoxelSize = 0;
+  _Computed  = 0;
+  _Requested = 0;
+  _Running   = false;
+  _Stop      = false;
+}
+
+ImagePyramid::~ImagePyramid()
+{
+  this->Clear();
+}
+
+void ImagePyramid::Initialize(mirtk::Image *image, bool labels)
+{
+  int x, y, z, l;
+  double dx, dy, dz, max_voxel;
+
+  this->Clear();
+  _Image  = image;
+  _Labels = labels;
+  if (_Image == NULL || _Image->IsEmpty()) return;
+
+  // Smallest voxel dimension, that of a single slice is irrelevant
+  _VoxelSize = std::min(_Image->GetXSize(), _Image->GetYSize());
+  if (_Image->GetZ() > 1) _VoxelSize = std::min(_VoxelSize, _Image->GetZSize());
+
+  // Number of levels until the image is reduced to a single voxel in-plane
+  x  = _Image->GetX();
+  y  = _Image->GetY();
+  z  = _Image->GetZ();
+  dx = _Image->GetXSize();
+  dy = _Image->GetYSize();
+  dz = _Image->GetZSize();
+  max_voxel = _VoxelSize;
+  for (l = 0; l < MAX_PYRAMID_LEVELS && (x > 1 || y > 1); l++) {
+    max_voxel *= 2;
+    if (HalveAxis(x, dx, max_voxel)) {
+      x  = (x + 1) / 2;
+      dx = 2 * dx;
+    }
+    if (HalveAxis(y, dy, max_voxel)) {
+      y  = (y + 1) / 2;
+      dy = 2 * dy;
+    }
+    if (HalveAxis(z, dz, max_voxel)) {
+      z  = (z + 1) / 2;
+      dz = 2 * dz;
+    }
+    _Level.push_back(NULL);
+  }
+}
+
+void ImagePyramid::Clear()
+{
+  size_t l;
+
+  // Level being computed is discarded
+  _Stop = true;
+  if (_Worker.joinable()) _Worker.join();
+  _Stop = false;
+
+  for (l = 0; l < _Level.size(); l++) delete _Level[l];
+  _Level.clear();
+  _Image     = NULL;
+  _VoxelSize = 0;
+  _Computed  = 0;
+  _Requested = 0;
+  _Running   = false;
+}
+
+int ImagePyramid::SelectLevel(double resolution) const
+{
+  double voxel, pixel;
+  int l;
+
+  if (_Image == NULL || _Level.empty() || resolution <= 0) return 0;
+
+  // Size of a display pixel and of the smallest voxel dimension in mm, the
+  // voxels of level l are at most 2^l times as large as the latter
+  pixel = 1.0 / resolution;
+  voxel = _VoxelSize;
+
+  // Coarsest level whose voxels are not larger than a display pixel
+  l = static_cast<int>(floor(log(pixel / voxel) / log(2.0)));
+  if (l < 0) l = 0;
+  if (l > static_cast<int>(_Level.size())) l = static_cast<int>(_Level.size());
+  return l;
+}
+
+mirtk::Image *ImagePyramid::Downsample(mirtk::Image *input, double max_voxel)
+{
+  int t, step[3];
+  double x, y, z;
+
+  // Halve only axes whose voxels do not become larger than the maximum
+  mirtk::ImageAttributes attr = input->GetImageAttributes();
+  step[0]  = HalveAxis(attr._x, attr._dx, max_voxel) ? 2 : 1;
+  step[1]  = HalveAxis(attr._y, attr._dy, max_voxel) ? 2 : 1;
+  step[2]  = HalveAxis(attr._z, attr._dz, max_voxel) ? 2 : 1;
+  attr._x  = (attr._x + step[0] - 1) / step[0];
+  attr._y  = (attr._y + step[1] - 1) / step[1];
+  attr._z  = (attr._z + step[2] - 1) / step[2];
+  attr._dx = step[0] * attr._dx;
+  attr._dy = step[1] * attr._dy;
+  attr._dz = step[2] * attr._dz;
+
+  // Image center moves by half a voxel for odd image dimensions, it is the
+  // midpoint between the first and last downsampled voxel centers, and it
+  // is unchanged along axes which are not downsampled
+  x = (step[0] == 2) ? attr._x - 0.5 : (attr._x - 1) / 2.0;
+  y = (step[1] == 2) ? attr._y - 0.5 : (attr._y - 1) / 2.0;
+  z = (step[2] == 2) ? attr._z - 0.5 : (attr._z - 1) / 2.0;
+  input->ImageToWorld(x, y, z);
+  attr._xorigin = x;
+  attr._yorigin = y;
+  attr._zorigin = z;
+
+  mirtk::Image *output = mirtk::Image::New(input->GetDataType());
+  output->Initialize(attr);
+
+  DownsampleFrame body;
+  body._Input   = input;
+  body._Output  = output;
+  body._Step[0] = step[0];
+  body._Step[1] = step[1];
+  body._Step[2] = step[2];
+  body._Labels  = _Labels;
+  body._Stop    = &_Stop;
+  for (t = 0; t < attr._t; t++) {
+    body._Frame = t;
+    mirtk::parallel_for(mirtk::blocked_range<int>(0, attr._z), body);
+  }
+  if (_Stop) {
+    delete output;
+    return NULL;
+  }
+  return output;
+}
+
+void ImagePyramid::Run()
+{
+  int l;
+  mirtk::Image *input, *output;
+
+  // Each level is computed from the previous one, which is not modified
+  // anymore once computed and can therefore be read without the lock
+  std::unique_lock<std::mutex> lock(_Mutex);
+  while (!_Stop && _Computed < _Requested) {
+    l     = _Computed + 1;
+    input = (l > 1) ? _Level[l-2] : _Image;
+    lock.unlock();
+    output = this->Downsample(input, _VoxelSize * pow(2.0, l));
+    lock.lock();
+    if (output == NULL) break;
+    _Level[l-1] = output;
+    _Computed   = l;
+    _Condition.notify_all();
+  }
+  _Running = false;
+  _Condition.notify_all();
+}
+
+void ImagePyramid::Start(int l)
+{
+  if (l <= _Requested) return;
+  _Requested = l;
+  if (!_Running) {
+    // Previous worker has finished, but may not have been joined yet
+    if (_Worker.joinable()) _Worker.join();
+    _Running = true;
+    _Worker  = std::thread(&ImagePyramid::Run, this);
+  }
+}
+
+int ImagePyramid::Request(int l)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  if (l <= 0 || _Level.empty()) return 0;
+  if (l > static_cast<int>(_Level.size())) l = static_cast<int>(_Level.size());
+  this->Start(l);
+  return std::min(l, _Computed);
+}
+
+bool ImagePyramid::IsReady(int l) const
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  if (l > static_cast<int>(_Level.size())) l = static_cast<int>(_Level.size());
+  return l <= _Computed;
+}
+
+void ImagePyramid::Wait(int l)
+{
+  std::unique_lock<std::mutex> lock(_Mutex);
+  if (l <= 0 || _Level.empty()) return;
+  if (l > static_cast<int>(_Level.size())) l = static_cast<int>(_Level.size());
+  this->Start(l);
+  _Condition.wait(lock, [this, l] { return _Computed >= l || !_Running; });
+}
+
+mirtk::Image *ImagePyramid::GetLevel(int l)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  if (l > _Computed) l = _Computed;
+  return (l > 0) ? _Level[l-1] : _Image;
+}
@@ -0,0 +1,132 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include <mirtk/ImageSequenceLoader.h>
+
+
+ImageSequenceLoader::ImageSequenceLoader(int threads)
+{
+  _Image           = NULL;
+  _Next            = 0;
+  _Loaded          = 0;
+  _Failed          = 0;
+  _NumberOfThreads = (threads > 0) ? threads : 1;
+  _Stop            = false;
+}
+
+ImageSequenceLoader::~ImageSequenceLoader()
+{
+  this->Stop();
+}
+
+void ImageSequenceLoader::Run()
+{
+  int i, x, y, z;
+  std::string name;
+
+  std::unique_lock<std::mutex> lock(_Mutex);
+  while (!_Stop && _Failed == 0 && _Next < static_cast<int>(_FileName.size())) {
+    i = _Next++;
+    name = _FileName[i];
+
+    // Read frame without holding the lock, other frames are written
+    // concurrently and the leading frames may be displayed meanwhile
+    lock.unlock();
+    mirtk::Image *frame = mirtk::Image::New(name.c_str());
+    mirtk::ImageAttributes attr = frame->GetImageAttributes();
+    attr._torigin = 0;
+    attr._dt      = 1;
+    bool ok = (attr == _Attributes);
+    if (ok) {
+      if (frame->GetDataType() == _Image->GetDataType()) {
+        memcpy(_Image->GetScalarPointer(0, 0, 0, i), frame->GetScalarPointer(),
+               frame->NumberOfVoxels() * frame->GetDataTypeSize());
+      } else {
+        for (z = 0; z < frame->GetZ(); z++) {
+          for (y = 0; y < frame->GetY(); y++) {
+            for (x = 0; x < frame->GetX(); x++) {
+              _Image->PutAsDouble(x, y, z, i, frame->GetAsDouble(x, y, z));
+            }
+          }
+        }
+      }
+    }
+    delete frame;
+    lock.lock();
+
+    if (!ok) {
+      if (_Failed == 0 || i < _Failed) _Failed = i;
+      break;
+    }
+    _Done[i] = true;
+    while (_Loaded < static_cast<int>(_Done.size()) && _Done[_Loaded]) ++_Loaded;
+  }
+}
+
+void ImageSequenceLoader::Start(mirtk::Image *image, int n, char **argv)
+{
+  int i;
+
+  this->Stop();
+  _Image      = image;
+  _Attributes = image->GetImageAttributes();
+  _Attributes._t       = 1;
+  _Attributes._torigin = 0;
+  _Attributes._dt      = 1;
+  _FileName.clear();
+  for (i = 0; i < n; i++) _FileName.push_back(argv[i]);
+  _Done.assign(n, false);
+  _Done[0] = true;
+  _Next    = 1;
+  _Loaded  = 1;
+  _Failed  = 0;
+  _Stop    = false;
+  if (n < 2) return;
+  for (i = 0; i < _NumberOfThreads && i < n - 1; i++) {
+    _Worker.push_back(std::thread(&ImageSequenceLoader::Run, this));
+  }
+}
+
+void ImageSequenceLoader::Stop()
+{
+  size_t i;
+
+  {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Stop = true;
+  }
+  for (i = 0; i < _Worker.size(); i++) _Worker[i].join();
+  _Worker.clear();
+}
+
+bool ImageSequenceLoader::IsDone()
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  return _Failed != 0 || _Loaded == static_cast<int>(_FileName.size());
+}
+
+int ImageSequenceLoader::Finish()
+{
+  size_t i;
+
+  for (i = 0; i < _Worker.size(); i++) _Worker[i].join();
+  _Worker.clear();
+  return _Failed;
+}
@@ -0,0 +1,237 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include <mirtk/ImageStatistics.h>
+#include <mirtk/Parallel.h>
+
+
+namespace {
+
+// Whether voxel value is finite, i.e., neither NaN nor infinite
+template <class VoxelType>
+inline bool IsFinite(VoxelType)
+{
+  return true;
+}
+
+inline bool IsFinite(float value)
+{
+  return std::isfinite(value);
+}
+
+inline bool IsFinite(double value)
+{
+  return std::isfinite(value);
+}
+
+// Minimum and maximum of finite voxels, operating on the raw voxel data such
+// that the compiler can vectorize the inner loop
+template <class VoxelType>
+struct MinMaxVoxels
+{
+  const VoxelType *_Data;
+  double           _Min;
+  double           _Max;
+
+  MinMaxVoxels(const VoxelType *data)
+  :
+    _Data(data), _Min(HUGE_VAL), _Max(-HUGE_VAL)
+  {}
+
+  MinMaxVoxels(const MinMaxVoxels &other, mirtk::split)
+  :
+    _Data(other._Data), _Min(other._Min), _Max(other._Max)
+  {}
+
+  void join(const MinMaxVoxels &other)
+  {
+    if (other._Min < _Min) _Min = other._Min;
+    if (other._Max > _Max) _Max = other._Max;
+  }
+
+  void operator ()(const mirtk::blocked_range<int> &re)
+  {
+    VoxelType min = std::numeric_limits<VoxelType>::max();
+    VoxelType max = std::numeric_limits<VoxelType>::lowest();
+    for (int idx = re.begin(); idx != re.end(); idx++) {
+      if (!IsFinite(_Data[idx])) continue;
+      min = (_Data[idx] < min) ? _Data[idx] : min;
+      max = (_Data[idx] > max) ? _Data[idx] : max;
+    }
+    // Range is empty if all voxels of the block were skipped
+    if (min <= max) {
+      if (min < _Min) _Min = min;
+      if (max > _Max) _Max = max;
+    }
+  }
+};
+
+// Histogram of finite voxels between min and max
+template <class VoxelType>
+struct HistogramVoxels
+{
+  const VoxelType   *_Data;
+  double             _Min;
+  double             _Scale;
+  std::vector<long>  _Histogram;
+  long               _Zeros;
+
+  HistogramVoxels(const VoxelType *data, double min, double max)
+  :
+    _Data(data), _Min(min), _Scale((max > min) ? STATISTICS_BINS / (max - min) : .0),
+    _Histogram(STATISTICS_BINS, 0), _Zeros(0)
+  {}
+
+  HistogramVoxels(const HistogramVoxels &other, mirtk::split)
+  :
+    _Data(other._Data), _Min(other._Min), _Scale(other._Scale),
+    _Histogram(STATISTICS_BINS, 0), _Zeros(0)
+  {}
+
+  void join(const HistogramVoxels &other)
+  {
+    for (int b = 0; b < STATISTICS_BINS; b++) _Histogram[b] += other._Histogram[b];
+    _Zeros += other._Zeros;
+  }
+
+  void operator ()(const mirtk::blocked_range<int> &re)
+  {
+    int    b;
+    double value;
+
+    for (int idx = re.begin(); idx != re.end(); idx++) {
+      if (!IsFinite(_Data[idx])) continue;
+      value = static_cast<double>(_Data[idx]);
+      b = static_cast<int>((value - _Min) * _Scale);
+      if (b < 0) b = 0;
+      if (b >= STATISTICS_BINS) b = STATISTICS_BINS - 1;
+      _Histogram[b]++;
+      if (value == .0) _Zeros++;
+    }
+  }
+};
+
+template <class VoxelType>
+void ComputeStatistics(const mirtk::Image *image, double &min, double &max,
+                       std::vector<long> &histogram, long &zeros, long &count)
+{
+  const int n = image->NumberOfVoxels();
+  const VoxelType *data = reinterpret_cast<const VoxelType *>(image->GetScalarPointer());
+
+  MinMaxVoxels<VoxelType> minmax(data);
+  mirtk::parallel_reduce(mirtk::blocked_range<int>(0, n), minmax);
+  min = minmax._Min;
+  max = minmax._Max;
+  if (min > max) {
+    // No finite voxels
+    min = max = 0;
+    histogram.assign(STATISTICS_BINS, 0);
+    zeros = count = 0;
+    return;
+  }
+
+  HistogramVoxels<VoxelType> hist(data, min, max);
+  mirtk::parallel_reduce(mirtk::blocked_range<int>(0, n), hist);
+  histogram = hist._Histogram;
+  zeros     = hist._Zeros;
+  count     = 0;
+  for (int b = 0; b < STATISTICS_BINS; b++) count += histogram[b];
+}
+
+}
+
+
+ImageStatistics::ImageStatistics()
+{
+  this->Invalidate();
+}
+
+void ImageStatistics::Invalidate()
+{
+  _Valid = false;
+  _Min   = 0;
+  _Max   = 0;
+  _Count = 0;
+  _Zeros = 0;
+  _Histogram.clear();
+}
+
+void ImageStatistics::Compute(const mirtk::Image *image)
+{
+  this->Invalidate();
+  if (image == NULL || image->NumberOfVoxels() == 0) return;
+
+  switch (image->GetDataType()) {
+    case mirtk::MIRTK_VOXEL_CHAR:
+      ComputeStatistics<char>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    case mirtk::MIRTK_VOXEL_UNSIGNED_CHAR:
+      ComputeStatistics<unsigned char>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    case mirtk::MIRTK_VOXEL_SHORT:
+      ComputeStatistics<short>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    case mirtk::MIRTK_VOXEL_UNSIGNED_SHORT:
+      ComputeStatistics<unsigned short>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    case mirtk::MIRTK_VOXEL_INT:
+      ComputeStatistics<int>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    case mirtk::MIRTK_VOXEL_UNSIGNED_INT:
+      ComputeStatistics<unsigned int>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    case mirtk::MIRTK_VOXEL_FLOAT:
+      ComputeStatistics<float>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    case mirtk::MIRTK_VOXEL_DOUBLE:
+      ComputeStatistics<double>(image, _Min, _Max, _Histogram, _Zeros, _Count);
+      break;
+    default:
+      std::cerr << "ImageStatistics::Compute: Unsupported voxel type" << std::endl;
+      exit(1);
+  }
+  _Valid = true;
+}
+
+double ImageStatistics::Percentile(double p) const
+{
+  int    b;
+  long   count, target;
+  double width;
+
+  if (!_Valid || _Count == 0) return 0;
+  if (p <= 0)   return _Min;
+  if (p >= 100) return _Max;
+
+  // Linear interpolation within the bin containing the percentile
+  target = static_cast<long>(p / 100.0 * _Count);
+  width  = (_Max - _Min) / _Histogram.size();
+  count  = 0;
+  for (b = 0; b < static_cast<int>(_Histogram.size()); b++) {
+    if (count + _Histogram[b] > target) {
+      return _Min + width * (b + static_cast<double>(target - count) / _Histogram[b]);
+    }
+    count += _Histogram[b];
+  }
+  return _Max;
+}
@@ -0,0 +1,414 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <mirtk/LandmarkFit.h>
+
+// Maximum number of iterations of reweighted least squares
+#define MAX_IRLS_ITERATIONS 20
+
+
+namespace {
+
+// Eigenvector of largest eigenvalue of symmetric 4x4 matrix (Jacobi method)
+void LargestEigenvector(double a[4][4], double v[4])
+{
+  int i, j, k, p, q, sweep;
+  double off, theta, t, c, s, tau, apq, aip, aiq, vip, viq, e[4][4];
+
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < 4; j++) e[i][j] = (i == j) ? 1.0 : .0;
+  }
+  for (sweep = 0; sweep < 50; sweep++) {
+    off = 0;
+    for (p = 0; p < 4; p++) {
+      for (q = p + 1; q < 4; q++) off += a[p][q] * a[p][q];
+    }
+    if (off < 1e-30) break;
+    for (p = 0; p < 4; p++) {
+      for (q = p + 1; q < 4; q++) {
+        apq = a[p][q];
+        if (fabs(apq) < 1e-300) continue;
+        theta = (a[q][q] - a[p][p]) / (2 * apq);
+        t = ((theta >= 0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1));
+        c = 1 / sqrt(t * t + 1);
+        s = t * c;
+        tau = s / (1 + c);
+        a[p][p] -= t * apq;
+        a[q][q] += t * apq;
+        a[p][q] = a[q][p] = 0;
+        for (k = 0; k < 4; k++) {
+          if (k == p || k == q) continue;
+          aip = a[k][p];
+          aiq = a[k][q];
+          a[k][p] = a[p][k] = aip - s * (aiq + tau * aip);
+          a[k][q] = a[q][k] = aiq + s * (aip - tau * aiq);
+        }
+        for (k = 0; k < 4; k++) {
+          vip = e[k][p];
+          viq = e[k][q];
+          e[k][p] = vip - s * (viq + tau * vip);
+          e[k][q] = viq + s * (vip - tau * viq);
+        }
+      }
+    }
+  }
+  j = 0;
+  for (i = 1; i < 4; i++) {
+    if (a[i][i] > a[j][j]) j = i;
+  }
+  for (i = 0; i < 4; i++) v[i] = e[i][j];
+}
+
+// Solve 3x3 linear system with multiple right-hand sides by Gaussian elimination
+bool Solve3x3(double a[3][3], double b[3][3])
+{
+  int i, j, k, p;
+  double f;
+
+  for (k = 0; k < 3; k++) {
+    p = k;
+    for (i = k + 1; i < 3; i++) {
+      if (fabs(a[i][k]) > fabs(a[p][k])) p = i;
+    }
+    if (fabs(a[p][k]) < 1e-12) return false;
+    for (j = 0; j < 3; j++) {
+      std::swap(a[k][j], a[p][j]);
+      std::swap(b[k][j], b[p][j]);
+    }
+    for (i = 0; i < 3; i++) {
+      if (i == k) continue;
+      f = a[i][k] / a[k][k];
+      for (j = 0; j < 3; j++) {
+        a[i][j] -= f * a[k][j];
+        b[i][j] -= f * b[k][j];
+      }
+    }
+  }
+  for (k = 0; k < 3; k++) {
+    for (j = 0; j < 3; j++) b[k][j] /= a[k][k];
+  }
+  return true;
+}
+
+// Median of values
+double Median(std::vector<double> values)
+{
+  if (values.empty()) return 0;
+  std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+  return values[values.size() / 2];
+}
+
+}
+
+
+LandmarkFit::LandmarkFit()
+{
+  int i, j;
+
+  _Model      = LandmarkFit_Rigid;
+  _Mode       = LandmarkFit_LeastSquares;
+  _Threshold  = 5;
+  _Iterations = 1000;
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 4; j++) _Matrix[i][j] = (i == j) ? 1.0 : .0;
+  }
+}
+
+bool LandmarkFit::Solve(const mirtk::PointSet &target, const mirtk::PointSet &source,
+                        const std::vector<double> &w, double m[3][4]) const
+{
+  int i, j, k, n;
+  double sw, ct[3], cs[3], t[3], s[3], S[3][3], T[3][3], N[4][4], q[4], R[3][3], scale, num, den, minors;
+
+  // Weighted centroids
+  n  = target.Size();
+  sw = 0;
+  for (j = 0; j < 3; j++) ct[j] = cs[j] = 0;
+  for (i = 0; i < n; i++) {
+    if (w[i] <= 0) continue;
+    const mirtk::Point &p1 = target(i);
+    const mirtk::Point &p2 = source(i);
+    ct[0] += w[i] * p1._x; ct[1] += w[i] * p1._y; ct[2] += w[i] * p1._z;
+    cs[0] += w[i] * p2._x; cs[1] += w[i] * p2._y; cs[2] += w[i] * p2._z;
+    sw += w[i];
+  }
+  if (sw <= 0) return false;
+  for (j = 0; j < 3; j++) {
+    ct[j] /= sw;
+    cs[j] /= sw;
+  }
+
+  // Weighted cross-covariance S and covariance T of centered landmarks
+  for (j = 0; j < 3; j++) {
+    for (k = 0; k < 3; k++) S[j][k] = T[j][k] = 0;
+  }
+  for (i = 0; i < n; i++) {
+    if (w[i] <= 0) continue;
+    const mirtk::Point &p1 = target(i);
+    const mirtk::Point &p2 = source(i);
+    t[0] = p1._x - ct[0]; t[1] = p1._y - ct[1]; t[2] = p1._z - ct[2];
+    s[0] = p2._x - cs[0]; s[1] = p2._y - cs[1]; s[2] = p2._z - cs[2];
+    for (j = 0; j < 3; j++) {
+      for (k = 0; k < 3; k++) {
+        S[j][k] += w[i] * t[j] * s[k];
+        T[j][k] += w[i] * t[j] * t[k];
+      }
+    }
+  }
+  den = T[0][0] + T[1][1] + T[2][2];
+  if (den <= 0) return false;
+
+  if (_Model == LandmarkFit_Affine) {
+    // Normal equations T L^T = S of the linear part
+    if (!Solve3x3(T, S)) return false;
+    for (j = 0; j < 3; j++) {
+      for (k = 0; k < 3; k++) R[j][k] = S[k][j];
+    }
+  } else {
+    // Rotation about the line is undetermined for collinear landmarks, whose
+    // covariance has rank one, i.e., the sum of its principal minors vanishes
+    minors = T[0][0] * T[1][1] - T[0][1] * T[1][0]
+           + T[0][0] * T[2][2] - T[0][2] * T[2][0]
+           + T[1][1] * T[2][2] - T[1][2] * T[2][1];
+    if (minors <= 1e-8 * den * den) return false;
+
+    // Rotation is the unit quaternion maximizing q^T N q (Horn, 1987)
+    N[0][0] =  S[0][0] + S[1][1] + S[2][2];
+    N[1][1] =  S[0][0] - S[1][1] - S[2][2];
+    N[2][2] = -S[0][0] + S[1][1] - S[2][2];
+    N[3][3] = -S[0][0] - S[1][1] + S[2][2];
+    N[0][1] = N[1][0] = S[1][2] - S[2][1];
+    N[0][2] = N[2][0] = S[2][0] - S[0][2];
+    N[0][3] = N[3][0] = S[0][1] - S[1][0];
+    N[1][2] = N[2][1] = S[0][1] + S[1][0];
+    N[1][3] = N[3][1] = S[2][0] + S[0][2];
+    N[2][3] = N[3][2] = S[1][2] + S[2][1];
+    LargestEigenvector(N, q);
+    R[0][0] = q[0]*q[0] + q[1]*q[1] - q[2]*q[2] - q[3]*q[3];
+    R[1][1] = q[0]*q[0] - q[1]*q[1] + q[2]*q[2] - q[3]*q[3];
+    R[2][2] = q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3];
+    R[0][1] = 2 * (q[1]*q[2] - q[0]*q[3]);
+    R[1][0] = 2 * (q[1]*q[2] + q[0]*q[3]);
+    R[0][2] = 2 * (q[1]*q[3] + q[0]*q[2]);
+    R[2][0] = 2 * (q[1]*q[3] - q[0]*q[2]);
+    R[1][2] = 2 * (q[2]*q[3] - q[0]*q[1]);
+    R[2][1] = 2 * (q[2]*q[3] + q[0]*q[1]);
+
+    // Least squares scale given the rotation, i.e., trace(R S) / trace(T)
+    if (_Model == LandmarkFit_Similarity) {
+      num = 0;
+      for (j = 0; j < 3; j++) {
+        for (k = 0; k < 3; k++) num += R[j][k] * S[k][j];
+      }
+      scale = num / den;
+      if (scale <= 0) return false;
+      for (j = 0; j < 3; j++) {
+        for (k = 0; k < 3; k++) R[j][k] *= scale;
+      }
+    }
+  }
+
+  // Translation maps target centroid onto source centroid
+  for (j = 0; j < 3; j++) {
+    for (k = 0; k < 3; k++) m[j][k] = R[j][k];
+    m[j][3] = cs[j] - (R[j][0] * ct[0] + R[j][1] * ct[1] + R[j][2] * ct[2]);
+  }
+  return true;
+}
+
+void LandmarkFit::Residuals(const mirtk::PointSet &target, const mirtk::PointSet &source,
+                            const double m[3][4], std::vector<double> &residual) const
+{
+  int i;
+  double x, y, z;
+
+  residual.resize(target.Size());
+  for (i = 0; i < target.Size(); i++) {
+    const mirtk::Point &p1 = target(i);
+    const mirtk::Point &p2 = source(i);
+    x = m[0][0] * p1._x + m[0][1] * p1._y + m[0][2] * p1._z + m[0][3] - p2._x;
+    y = m[1][0] * p1._x + m[1][1] * p1._y + m[1][2] * p1._z + m[1][3] - p2._y;
+    z = m[2][0] * p1._x + m[2][1] * p1._y + m[2][2] * p1._z + m[2][3] - p2._z;
+    residual[i] = sqrt(x * x + y * y + z * z);
+  }
+}
+
+bool LandmarkFit::RunRANSAC(const mirtk::PointSet &target, const mirtk::PointSet &source)
+{
+  int i, j, n, k, iter, inliers, best, changed, samples;
+  double m[3][4], sum, best_sum, ratio;
+  std::vector<int> sample;
+  std::vector<double> w, residual;
+
+  n = target.Size();
+  k = this->MinimumNumberOfLandmarks();
+  w.resize(n);
+  sample.resize(n);
+  for (i = 0; i < n; i++) sample[i] = i;
+
+  // Fixed seed such that repeated fits of the same landmarks agree
+  std::mt19937 rng(42);
+  best     = 0;
+  best_sum = 0;
+  samples  = _Iterations;
+  for (iter = 0; iter < samples; iter++) {
+    // Partial shuffle draws k distinct landmark pairs
+    for (j = 0; j < k; j++) {
+      std::uniform_int_distribution<int> dist(j, n - 1);
+      std::swap(sample[j], sample[dist(rng)]);
+    }
+    std::fill(w.begin(), w.end(), .0);
+    for (j = 0; j < k; j++) w[sample[j]] = 1;
+    if (!this->Solve(target, source, w, m)) continue;
+
+    // Consensus set, ties are broken by the sum of inlier residuals
+    this->Residuals(target, source, m, residual);
+    inliers = 0;
+    sum     = 0;
+    for (i = 0; i < n; i++) {
+      if (residual[i] <= _Threshold) {
+        inliers++;
+        sum += residual[i];
+      }
+    }
+    if (inliers > best || (inliers == best && sum < best_sum)) {
+      best     = inliers;
+      best_sum = sum;
+      for (i = 0; i < 3; i++) {
+        for (j = 0; j < 4; j++) _Matrix[i][j] = m[i][j];
+      }
+      // Number of samples needed to draw an outlier-free sample with 99% probability
+      ratio = pow(static_cast<double>(best) / n, k);
+      if (ratio >= 1) break;
+      if (ratio > 0) samples = std::min(_Iterations, static_cast<int>(ceil(log(0.01) / log(1 - ratio))));
+    }
+  }
+  if (best < k) return false;
+  this->Residuals(target, source, _Matrix, _Residual);
+  for (i = 0; i < n; i++) _Inlier[i] = (_Residual[i] <= _Threshold);
+
+  // Refit to all inliers, which may change the consensus set
+  for (iter = 0; iter < 5; iter++) {
+    for (i = 0; i < n; i++) w[i] = _Inlier[i] ? 1.0 : .0;
+    if (!this->Solve(target, source, w, m)) break;
+    for (i = 0; i < 3; i++) {
+      for (j = 0; j < 4; j++) _Matrix[i][j] = m[i][j];
+    }
+    this->Residuals(target, source, _Matrix, _Residual);
+    changed = 0;
+    for (i = 0; i < n; i++) {
+      if (_Inlier[i] != (_Residual[i] <= _Threshold)) changed++;
+      _Inlier[i] = (_Residual[i] <= _Threshold);
+    }
+    if (changed == 0 || this->NumberOfInliers() < k) break;
+  }
+  return true;
+}
+
+bool LandmarkFit::RunIRLS(const mirtk::PointSet &target, const mirtk::PointSet &source)
+{
+  int i, j, n, iter;
+  double m[3][4], sigma, c, change;
+  std::vector<double> w;
+
+  n = target.Size();
+  w.assign(n, 1.0);
+  if (!this->Solve(target, source, w, _Matrix)) return false;
+  this->Residuals(target, source, _Matrix, _Residual);
+
+  for (iter = 0; iter < MAX_IRLS_ITERATIONS; iter++) {
+    // Robust estimate of the residual scale from the median absolute residual
+    sigma = 1.4826 * Median(_Residual);
+    if (sigma < 1e-6) break;
+    c = 2.385 * sigma;
+    for (i = 0; i < n; i++) w[i] = 1 / (1 + (_Residual[i] / c) * (_Residual[i] / c));
+    if (!this->Solve(target, source, w, m)) break;
+    change = 0;
+    for (i = 0; i < 3; i++) {
+      for (j = 0; j < 4; j++) {
+        change = std::max(change, fabs(m[i][j] - _Matrix[i][j]));
+        _Matrix[i][j] = m[i][j];
+      }
+    }
+    this->Residuals(target, source, _Matrix, _Residual);
+    if (change < 1e-6) break;
+  }
+  for (i = 0; i < n; i++) _Inlier[i] = (_Residual[i] <= _Threshold);
+  return true;
+}
+
+bool LandmarkFit::Run(const mirtk::PointSet &target, const mirtk::PointSet &source)
+{
+  int n;
+  bool ok;
+
+  n = target.Size();
+  _Residual.clear();
+  _Inlier.clear();
+  if (source.Size() != n || n < this->MinimumNumberOfLandmarks()) return false;
+  _Residual.resize(n, .0);
+  _Inlier.resize(n, true);
+
+  // RANSAC needs more than a minimal sample to find any outliers
+  if (_Mode == LandmarkFit_RANSAC && n > this->MinimumNumberOfLandmarks()) {
+    ok = this->RunRANSAC(target, source);
+  } else if (_Mode == LandmarkFit_IRLS) {
+    ok = this->RunIRLS(target, source);
+  } else {
+    ok = this->Solve(target, source, std::vector<double>(n, 1.0), _Matrix);
+    if (ok) this->Residuals(target, source, _Matrix, _Residual);
+  }
+  if (!ok) {
+    _Residual.clear();
+    _Inlier.clear();
+  }
+  return ok;
+}
+
+void LandmarkFit::Evaluate(const mirtk::PointSet &target, const mirtk::PointSet &source, const double m[3][4])
+{
+  int i, j;
+
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 4; j++) _Matrix[i][j] = m[i][j];
+  }
+  this->Residuals(target, source, _Matrix, _Residual);
+  _Inlier.resize(_Residual.size());
+  for (i = 0; i < static_cast<int>(_Residual.size()); i++) _Inlier[i] = (_Residual[i] <= _Threshold);
+}
+
+int LandmarkFit::NumberOfInliers() const
+{
+  int n = 0;
+  for (size_t i = 0; i < _Inlier.size(); i++) {
+    if (_Inlier[i]) n++;
+  }
+  return n;
+}
+
+double LandmarkFit::MeanResidual() const
+{
+  double sum = 0;
+  if (_Residual.empty()) return 0;
+  for (size_t i = 0; i < _Residual.size(); i++) sum += _Residual[i];
+  return sum / _Residual.size();
+}
@@ -0,0 +1,133 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <mirtk/LandmarkIndex.h>
+#include <mirtk/Parallel.h>
+
+// Maximum number of plane orientations for which landmarks are kept sorted
+#define MAX_LANDMARK_SLABS 6
+
+
+namespace {
+
+// Map landmarks by transformation, inverting it is an iterative solve for FFDs
+struct TransformLandmarks
+{
+  const mirtk::Transformation *_Transformation;
+  bool                         _Invert;
+  mirtk::Point                *_Position;
+
+  void operator ()(const mirtk::blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); i++) {
+      if (_Invert) _Transformation->Inverse  (_Position[i]);
+      else         _Transformation->Transform(_Position[i]);
+    }
+  }
+};
+
+}
+
+
+void LandmarkIndex::Update(const mirtk::PointSet &landmarks, unsigned long landmarks_version,
+                           const mirtk::Transformation *transform, bool invert,
+                           unsigned long transform_version)
+{
+  int i;
+  std::vector<double> key;
+
+  key.push_back(landmarks.Size());
+  key.push_back(landmarks_version);
+  key.push_back(static_cast<double>(reinterpret_cast<size_t>(transform)));
+  key.push_back(transform ? transform->NumberOfDOFs() : 0);
+  key.push_back(invert);
+  key.push_back(transform ? transform_version : 0);
+  if (key == _Key) return;
+
+  // Compute positions
+  _Key = key;
+  _Slabs.clear();
+  _Position.resize(landmarks.Size());
+  for (i = 0; i < landmarks.Size(); i++) _Position[i] = landmarks(i);
+  if (transform != NULL && !_Position.empty()) {
+    TransformLandmarks body;
+    body._Transformation = transform;
+    body._Invert         = invert;
+    body._Position       = _Position.data();
+    mirtk::parallel_for(mirtk::blocked_range<int>(0, static_cast<int>(_Position.size())), body);
+  }
+}
+
+void LandmarkIndex::Clear()
+{
+  _Position.clear();
+  _Slabs.clear();
+  _Key.clear();
+}
+
+const LandmarkIndex::Slabs &LandmarkIndex::GetSlabs(const double *normal)
+{
+  size_t i;
+
+  for (i = 0; i < _Slabs.size(); i++) {
+    if (_Slabs[i].Normal[0] == normal[0] &&
+        _Slabs[i].Normal[1] == normal[1] &&
+        _Slabs[i].Normal[2] == normal[2]) return _Slabs[i];
+  }
+  if (_Slabs.size() >= MAX_LANDMARK_SLABS) _Slabs.erase(_Slabs.begin());
+
+  Slabs slabs;
+  slabs.Normal[0] = normal[0];
+  slabs.Normal[1] = normal[1];
+  slabs.Normal[2] = normal[2];
+  slabs.Order.resize(_Position.size());
+  for (i = 0; i < _Position.size(); i++) {
+    slabs.Order[i].first  = _Position[i]._x * normal[0] + _Position[i]._y * normal[1] + _Position[i]._z * normal[2];
+    slabs.Order[i].second = static_cast<int>(i);
+  }
+  std::sort(slabs.Order.begin(), slabs.Order.end());
+  _Slabs.push_back(slabs);
+  return _Slabs.back();
+}
+
+void LandmarkIndex::Find(const mirtk::GreyImage *image, std::vector<int> &ids)
+{
+  double d, h;
+  std::vector<std::pair<double, int> >::const_iterator it, end;
+
+  ids.clear();
+  if (_Position.empty()) return;
+
+  // Slab of slice along its normal, slightly enlarged such that the exact
+  // field of view test decides about landmarks on its boundary
+  const mirtk::ImageAttributes &attr = image->GetImageAttributes();
+  d = attr._xorigin * attr._zaxis[0] + attr._yorigin * attr._zaxis[1] + attr._zorigin * attr._zaxis[2];
+  h = 0.5 * image->GetZ() * attr._dz * 1.001;
+
+  const Slabs &slabs = this->GetSlabs(attr._zaxis);
+  it  = std::lower_bound(slabs.Order.begin(), slabs.Order.end(), std::make_pair(d - h, -1));
+  end = std::upper_bound(slabs.Order.begin(), slabs.Order.end(), std::make_pair(d + h, static_cast<int>(_Position.size())));
+  for (; it != end; ++it) {
+    const mirtk::Point &p = _Position[it->second];
+    if (image->IsInFOV(p._x, p._y, p._z)) ids.push_back(it->second);
+  }
+  std::sort(ids.begin(), ids.end());
+}
@@ -0,0 +1,264 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <mirtk/MappedImage.h>
+#include <mirtk/ImageReader.h>
+
+#ifndef _WIN32
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+
+template <class VoxelType>
+MappedImage<VoxelType>::MappedImage(const mirtk::ImageAttributes &attr, VoxelType *data, void *map, size_t size)
+:
+  mirtk::GenericImage<VoxelType>(attr, data),
+  _Map(map), _MapSize(size)
+{
+}
+
+template <class VoxelType>
+MappedImage<VoxelType>::~MappedImage()
+{
+#ifndef _WIN32
+  if (_Map) munmap(_Map, _MapSize);
+#endif
+}
+
+template class MappedImage<char>;
+template class MappedImage<unsigned char>;
+template class MappedImage<short>;
+template class MappedImage<unsigned short>;
+template class MappedImage<int>;
+template class MappedImage<unsigned int>;
+template class MappedImage<float>;
+template class MappedImage<double>;
+
+
+mirtk::Image *ReadMappedImage(const char *name)
+{
+#ifdef _WIN32
+  return NULL;
+#else
+  int    fd, sizeof_hdr;
+  short  bitpix;
+  float  vox_offset;
+  char   hdr[348];
+  size_t len, offset, nbytes;
+  struct stat st;
+  FILE  *fp;
+
+  // Only uncompressed single file NIfTI images in native byte order
+  len = strlen(name);
+  if (len < 4 || strcmp(name + len - 4, ".nii") != 0) return NULL;
+  fp = fopen(name, "rb");
+  if (fp == NULL) return NULL;
+  if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) {
+    fclose(fp);
+    return NULL;
+  }
+  fclose(fp);
+  memcpy(&sizeof_hdr, hdr,       sizeof(int));
+  memcpy(&bitpix,     hdr + 72,  sizeof(short));
+  memcpy(&vox_offset, hdr + 108, sizeof(float));
+  if (sizeof_hdr != 348 || strncmp(hdr + 344, "n+1", 3) != 0) {
+    std::cerr << "ReadMappedImage: " << name << " is not a single file NIfTI-1 image in native byte order, reading it into memory" << std::endl;
+    return NULL;
+  }
+  offset = static_cast<size_t>(vox_offset);
+
+  // Use image reader for the geometry and type of the image
+  std::unique_ptr<mirtk::ImageReader> reader(mirtk::ImageReader::New(name));
+  const mirtk::ImageAttributes &attr = reader->Attributes();
+  if ((reader->Slope() != .0 && reader->Slope() != 1.0) || reader->Intercept() != .0) {
+    // Voxels need to be rescaled, cannot be used as is
+    std::cerr << "ReadMappedImage: Voxels of " << name << " are rescaled, reading it into memory" << std::endl;
+    return NULL;
+  }
+
+  // Map file
+  fd = open(name, O_RDONLY);
+  if (fd == -1) return NULL;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return NULL;
+  }
+  nbytes = static_cast<size_t>(st.st_size);
+  if (nbytes < offset + static_cast<size_t>(attr.NumberOfAllPoints()) * (bitpix / 8)) {
+    close(fd);
+    return NULL;
+  }
+  // Read-only such that no memory is committed for the mapping, which would
+  // fail for private writable mappings of files larger than RAM plus swap.
+  // The viewer never modifies the voxels of the images it displays.
+  void *map = mmap(NULL, nbytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    std::cerr << "ReadMappedImage: Cannot map " << name << ": " << strerror(errno) << ", reading it into memory" << std::endl;
+    return NULL;
+  }
+  void *data = static_cast<char *>(map) + offset;
+
+  switch (reader->DataType()) {
+    case mirtk::MIRTK_VOXEL_CHAR:
+      return new MappedImage<char>(attr, static_cast<char *>(data), map, nbytes);
+    case mirtk::MIRTK_VOXEL_UNSIGNED_CHAR:
+      return new MappedImage<unsigned char>(attr, static_cast<unsigned char *>(data), map, nbytes);
+    case mirtk::MIRTK_VOXEL_SHORT:
+      return new MappedImage<short>(attr, static_cast<short *>(data), map, nbytes);
+    case mirtk::MIRTK_VOXEL_UNSIGNED_SHORT:
+      return new MappedImage<unsigned short>(attr, static_cast<unsigned short *>(data), map, nbytes);
+    case mirtk::MIRTK_VOXEL_INT:
+      return new MappedImage<int>(attr, static_cast<int *>(data), map, nbytes);
+    case mirtk::MIRTK_VOXEL_UNSIGNED_INT:
+      return new MappedImage<unsigned int>(attr, static_cast<unsigned int *>(data), map, nbytes);
+    case mirtk::MIRTK_VOXEL_FLOAT:
+      return new MappedImage<float>(attr, static_cast<float *>(data), map, nbytes);
+    case mirtk::MIRTK_VOXEL_DOUBLE:
+      return new MappedImage<double>(attr, static_cast<double *>(data), map, nbytes);
+    default:
+      munmap(map, nbytes);
+      return NULL;
+  }
+#endif
+}
+
+bool IsMappedImage(const mirtk::Image *image)
+{
+  return dynamic_cast<const MappedImage<char>           *>(image) != NULL ||
+         dynamic_cast<const MappedImage<unsigned char>  *>(image) != NULL ||
+         dynamic_cast<const MappedImage<short>          *>(image) != NULL ||
+         dynamic_cast<const MappedImage<unsigned short> *>(image) != NULL ||
+         dynamic_cast<const MappedImage<int>            *>(image) != NULL ||
+         dynamic_cast<const MappedImage<unsigned int>   *>(image) != NULL ||
+         dynamic_cast<const MappedImage<float>          *>(image) != NULL ||
+         dynamic_cast<const MappedImage<double>         *>(image) != NULL;
+}
+
+namespace {
+
+// Number of voxels of all frames, which may exceed the range of int
+inline long NumberOfAllVoxels(const mirtk::Image *image)
+{
+  return static_cast<long>(image->GetX()) * image->GetY() * image->GetZ() * image->GetT();
+}
+
+// Update intensity range by every step-th voxel in [begin, end)
+template <class VoxelType>
+void MinMax(const void *data, long begin, long end, long step, double *min, double *max)
+{
+  const VoxelType *voxel = static_cast<const VoxelType *>(data);
+  double value;
+
+  for (long idx = begin; idx < end; idx += step) {
+    value = static_cast<double>(voxel[idx]);
+    if (value < *min) *min = value;
+    if (value > *max) *max = value;
+  }
+}
+
+// Update intensity range by every step-th voxel in [begin, end), where the
+// voxels are accessed by a long index instead of mirtk::Image::GetAsDouble,
+// whose int index does not address all voxels of images with 2^31 or more
+void MinMaxAsDouble(const mirtk::Image *image, long begin, long end, long step, double *min, double *max)
+{
+  const void *data = image->GetScalarPointer();
+
+  switch (image->GetDataType()) {
+    case mirtk::MIRTK_VOXEL_CHAR:
+      MinMax<char>(data, begin, end, step, min, max);
+      break;
+    case mirtk::MIRTK_VOXEL_UNSIGNED_CHAR:
+      MinMax<unsigned char>(data, begin, end, step, min, max);
+      break;
+    case mirtk::MIRTK_VOXEL_SHORT:
+      MinMax<short>(data, begin, end, step, min, max);
+      break;
+    case mirtk::MIRTK_VOXEL_UNSIGNED_SHORT:
+      MinMax<unsigned short>(data, begin, end, step, min, max);
+      break;
+    case mirtk::MIRTK_VOXEL_INT:
+      MinMax<int>(data, begin, end, step, min, max);
+      break;
+    case mirtk::MIRTK_VOXEL_UNSIGNED_INT:
+      MinMax<unsigned int>(data, begin, end, step, min, max);
+      break;
+    case mirtk::MIRTK_VOXEL_FLOAT:
+      MinMax<float>(data, begin, end, step, min, max);
+      break;
+    case mirtk::MIRTK_VOXEL_DOUBLE:
+      MinMax<double>(data, begin, end, step, min, max);
+      break;
+    default:
+      std::cerr << "MinMaxAsDouble: Unsupported voxel type" << std::endl;
+      break;
+  }
+}
+
+}
+
+void EstimateMinMaxAsDouble(const mirtk::Image *image, double *min, double *max, int samples)
+{
+  const int chunks = 8;
+  long i, n, slice, size, begin, end;
+
+  n    = NumberOfAllVoxels(image);
+  *min = *max = (n > 0) ? image->GetAsDouble(0) : .0;
+  if (samples <= 0 || n <= samples) {
+    MinMaxAsDouble(image, 0, n, 1, min, max);
+    return;
+  }
+
+  // Voxels are sampled in few contiguous blocks instead of regularly
+  // spaced, which would read almost every page of a memory-mapped file.
+  // First the central slice of the first frame, or its central part
+  slice = static_cast<long>(image->GetX()) * image->GetY();
+  size  = (slice < samples / 2) ? slice : samples / 2;
+  begin = (image->GetZ() / 2) * slice + (slice - size) / 2;
+  MinMaxAsDouble(image, begin, begin + size, 1, min, max);
+
+  // Then chunks spread evenly over all slices and frames
+  size = (samples - size) / chunks;
+  if (size < 1) size = 1;
+  for (i = 0; i < chunks; i++) {
+    begin = (2 * i + 1) * n / (2 * chunks) - size / 2;
+    if (begin < 0) begin = 0;
+    end = (begin + size < n) ? begin + size : n;
+    MinMaxAsDouble(image, begin, end, 1, min, max);
+  }
+}
+
+long RefineMinMaxAsDouble(const mirtk::Image *image, double *min, double *max, long idx, long count)
+{
+  long n, end;
+
+  n   = NumberOfAllVoxels(image);
+  end = (idx + count < n) ? idx + count : n;
+  MinMaxAsDouble(image, idx, end, 1, min, max);
+  return (end < n) ? end : -1;
+}
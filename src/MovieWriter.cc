@@ -0,0 +1,446 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <mirtk/MovieWriter.h>
+#include <mirtk/Image.h>
+#include <mirtk/Parallel.h>
+
+#ifdef _WIN32
+  #define popen  _popen
+  #define pclose _pclose
+#else
+  #include <fcntl.h>
+  #include <pthread.h>
+  #include <signal.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+#endif
+
+
+namespace {
+
+// Whether file name ends with the given extension
+bool HasExtension(const std::string &name, const char *ext)
+{
+  size_t n = strlen(ext);
+  return name.size() > n && name.compare(name.size() - n, n, ext) == 0;
+}
+
+// Convert rows of RGB frame to planar YUV 4:2:0 (full range, BT.601)
+struct ConvertToYUV420
+{
+  const unsigned char *_RGB;
+  unsigned char       *_Y, *_U, *_V;
+  int                  _Width, _Height;
+
+  void operator ()(const mirtk::blocked_range<int> &re) const
+  {
+    int i, j, i2, j2, n, cw;
+    double r, g, b, u, v;
+    const unsigned char *p;
+
+    cw = (_Width + 1) / 2;
+    for (j = re.begin(); j != re.end(); j++) {
+      // Luma of both rows covered by this chroma row
+      for (j2 = 2 * j; j2 < 2 * j + 2 && j2 < _Height; j2++) {
+        p = _RGB + 3 * j2 * _Width;
+        for (i = 0; i < _Width; i++, p += 3) {
+          _Y[j2 * _Width + i] = static_cast<unsigned char>(0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2] + 0.5);
+        }
+      }
+      // Chroma averaged over blocks of 2x2 pixels
+      for (i = 0; i < cw; i++) {
+        r = g = b = 0;
+        n = 0;
+        for (j2 = 2 * j; j2 < 2 * j + 2 && j2 < _Height; j2++) {
+          for (i2 = 2 * i; i2 < 2 * i + 2 && i2 < _Width; i2++) {
+            p = _RGB + 3 * (j2 * _Width + i2);
+            r += p[0];
+            g += p[1];
+            b += p[2];
+            n++;
+          }
+        }
+        r /= n;
+        g /= n;
+        b /= n;
+        u = 128.0 - 0.168736 * r - 0.331264 * g + 0.5 * b;
+        v = 128.0 + 0.5 * r - 0.418688 * g - 0.081312 * b;
+        _U[j * cw + i] = static_cast<unsigned char>(std::max(0.0, std::min(255.0, u + 0.5)));
+        _V[j * cw + i] = static_cast<unsigned char>(std::max(0.0, std::min(255.0, v + 0.5)));
+      }
+    }
+  }
+};
+
+}
+
+
+MovieWriter::MovieWriter(int buffers)
+{
+  _Format = Format_PNG;
+  _Width  = 0;
+  _Height = 0;
+  _Rate   = 25;
+  _Stream = NULL;
+#ifndef _WIN32
+  _Process = -1;
+#endif
+  _Frame  = 0;
+  _Failed = false;
+  _Stop   = false;
+  _Buffer.resize((buffers > 0) ? buffers : 1);
+}
+
+MovieWriter::~MovieWriter()
+{
+  this->Close();
+}
+
+bool MovieWriter::Open(const char *name, int width, int height, double rate)
+{
+  size_t i;
+
+  this->Close();
+  _FileName = name;
+  _Width    = width;
+  _Height   = height;
+  _Rate     = (rate > 0) ? rate : 25;
+  _Frame    = 0;
+  _Failed   = false;
+  _Stop     = false;
+
+  if (HasExtension(_FileName, ".y4m")) {
+    _Format = Format_Y4M;
+    _Stream = fopen(name, "wb");
+    if (_Stream == NULL) {
+      std::cerr << "MovieWriter::Open: Cannot open file " << name << std::endl;
+      return false;
+    }
+    // Samples are full range (cf. ConvertToYUV420), players assume limited range otherwise
+    fprintf(_Stream, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", _Width, _Height,
+            static_cast<int>(round(1000 * _Rate)));
+    _Conversion.resize(_Width * _Height + 2 * ((_Width + 1) / 2) * ((_Height + 1) / 2));
+  } else if (HasExtension(_FileName, ".mp4") || HasExtension(_FileName, ".mov") ||
+             HasExtension(_FileName, ".mkv") || HasExtension(_FileName, ".avi") ||
+             HasExtension(_FileName, ".webm")) {
+    _Format = Format_FFmpeg;
+    if (!this->StartFFmpeg()) return false;
+  } else {
+    _Format = Format_PNG;
+  }
+
+  // Allocate frame buffers once
+  _Free.clear();
+  _Queue.clear();
+  for (i = 0; i < _Buffer.size(); i++) {
+    _Buffer[i].resize(3 * _Width * _Height);
+    _Free.push_back(static_cast<int>(i));
+  }
+  _Writer = std::thread(&MovieWriter::Run, this);
+  return true;
+}
+
+#ifndef _WIN32
+
+bool MovieWriter::StartFFmpeg()
+{
+  int data[2], status[2], error;
+  ssize_t n;
+  char size[32], rate[32];
+
+  // The file name is passed as argument to ffmpeg without a shell. The file
+  // protocol prefix prevents names starting with '-' to be taken as option.
+  std::string output = "file:" + _FileName;
+  snprintf(size, sizeof(size), "%dx%d", _Width, _Height);
+  snprintf(rate, sizeof(rate), "%g", _Rate);
+  const char *argv[] = {
+    "ffmpeg", "-loglevel", "error", "-y",
+    "-f", "rawvideo", "-pix_fmt", "rgb24", "-s", size, "-r", rate, "-i", "-",
+    "-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2", "-pix_fmt", "yuv420p",
+    output.c_str(), NULL
+  };
+
+  // Pipe for the frames and pipe which is closed on successful exec, or
+  // through which the child reports why ffmpeg could not be started
+  if (pipe(data) != 0) {
+    std::cerr << "MovieWriter::Open: Cannot create pipe: " << strerror(errno) << std::endl;
+    return false;
+  }
+  if (pipe(status) != 0) {
+    std::cerr << "MovieWriter::Open: Cannot create pipe: " << strerror(errno) << std::endl;
+    close(data[0]);
+    close(data[1]);
+    return false;
+  }
+  fcntl(data[1],   F_SETFD, FD_CLOEXEC);
+  fcntl(status[0], F_SETFD, FD_CLOEXEC);
+  fcntl(status[1], F_SETFD, FD_CLOEXEC);
+
+  _Process = fork();
+  if (_Process == 0) {
+    // Child process, only async-signal-safe calls until exec
+    dup2(data[0], STDIN_FILENO);
+    close(data[0]);
+    execvp(argv[0], const_cast<char *const *>(argv));
+    error = errno;
+    if (write(status[1], &error, sizeof(error)) < 0) {}
+    _exit(127);
+  }
+  close(data[0]);
+  close(status[1]);
+  if (_Process == -1) {
+    std::cerr << "MovieWriter::Open: Cannot run ffmpeg: " << strerror(errno) << std::endl;
+    close(data[1]);
+    close(status[0]);
+    return false;
+  }
+  do {
+    n = read(status[0], &error, sizeof(error));
+  } while (n == -1 && errno == EINTR);
+  close(status[0]);
+  if (n > 0) {
+    std::cerr << "MovieWriter::Open: Cannot run ffmpeg: " << strerror(error) << std::endl;
+    waitpid(_Process, NULL, 0);
+    _Process = -1;
+    close(data[1]);
+    return false;
+  }
+
+  // Unbuffered, such that a failed write is detected by the writer thread
+  // and fclose does not write to the pipe from another thread
+  _Stream = fdopen(data[1], "wb");
+  if (_Stream == NULL) {
+    close(data[1]);
+    this->StopFFmpeg();
+    return false;
+  }
+  setvbuf(_Stream, NULL, _IONBF, 0);
+  return true;
+}
+
+bool MovieWriter::StopFFmpeg()
+{
+  int status;
+  bool ok = true;
+
+  if (_Stream != NULL) {
+    if (fclose(_Stream) != 0) ok = false;
+    _Stream = NULL;
+  }
+  if (_Process != -1) {
+    while (waitpid(_Process, &status, 0) == -1) {
+      if (errno != EINTR) {
+        status = -1;
+        break;
+      }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+    _Process = -1;
+  }
+  return ok;
+}
+
+#else
+
+bool MovieWriter::StartFFmpeg()
+{
+  char command[1024];
+
+  // Characters which would end the quoted name in the command
+  if (_FileName.find_first_of("\"%") != std::string::npos) {
+    std::cerr << "MovieWriter::Open: Invalid file name " << _FileName << std::endl;
+    return false;
+  }
+  snprintf(command, sizeof(command),
+           "ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgb24 -s %dx%d -r %g -i - "
+           "-vf pad=ceil(iw/2)*2:ceil(ih/2)*2 -pix_fmt yuv420p \"%s\"",
+           _Width, _Height, _Rate, _FileName.c_str());
+  _Stream = popen(command, "wb");
+  if (_Stream == NULL) {
+    std::cerr << "MovieWriter::Open: Cannot run ffmpeg" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool MovieWriter::StopFFmpeg()
+{
+  bool ok = true;
+
+  if (_Stream != NULL) {
+    if (pclose(_Stream) != 0) ok = false;
+    _Stream = NULL;
+  }
+  return ok;
+}
+
+#endif
+
+std::string MovieWriter::FrameFileName(int frame) const
+{
+  size_t pos, dir;
+  char number[32];
+
+  // Insert frame number before the extension
+  snprintf(number, sizeof(number), "_%05d", frame);
+  pos = _FileName.rfind('.');
+  dir = _FileName.find_last_of("/\\");
+  if (pos == std::string::npos || (dir != std::string::npos && pos < dir)) {
+    return _FileName + number + ".png";
+  }
+  return _FileName.substr(0, pos) + number + _FileName.substr(pos);
+}
+
+unsigned char *MovieWriter::Acquire()
+{
+  int i;
+
+  std::unique_lock<std::mutex> lock(_Mutex);
+  _FreeCondition.wait(lock, [this] { return !_Free.empty(); });
+  i = _Free.front();
+  _Free.pop_front();
+  return _Buffer[i].data();
+}
+
+void MovieWriter::Submit(unsigned char *buffer)
+{
+  size_t i;
+
+  {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    for (i = 0; i < _Buffer.size(); i++) {
+      if (_Buffer[i].data() == buffer) _Queue.push_back(static_cast<int>(i));
+    }
+  }
+  _QueueCondition.notify_all();
+}
+
+void MovieWriter::Run()
+{
+  int i;
+  bool ok;
+
+#ifndef _WIN32
+  // Report a terminated ffmpeg as failed write instead of being killed
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+#endif
+
+  std::unique_lock<std::mutex> lock(_Mutex);
+  while (true) {
+    _QueueCondition.wait(lock, [this] { return _Stop || !_Queue.empty(); });
+    if (_Queue.empty()) break;
+    i = _Queue.front();
+    _Queue.pop_front();
+
+    // Encode frame without holding the lock
+    lock.unlock();
+    ok = _Failed ? false : this->Write(_Buffer[i].data());
+    lock.lock();
+
+    if (!ok) _Failed = true;
+    _Frame++;
+    _Free.push_back(i);
+    _FreeCondition.notify_all();
+  }
+}
+
+bool MovieWriter::Write(const unsigned char *rgb)
+{
+  int i, n;
+  unsigned char *ptr;
+
+  switch (_Format) {
+    case Format_Y4M: {
+      ConvertToYUV420 body;
+      body._RGB    = rgb;
+      body._Width  = _Width;
+      body._Height = _Height;
+      body._Y      = _Conversion.data();
+      body._U      = body._Y + _Width * _Height;
+      body._V      = body._U + ((_Width + 1) / 2) * ((_Height + 1) / 2);
+      mirtk::parallel_for(mirtk::blocked_range<int>(0, (_Height + 1) / 2), body);
+      return fputs("FRAME\n", _Stream) >= 0 &&
+             fwrite(_Conversion.data(), 1, _Conversion.size(), _Stream) == _Conversion.size();
+    }
+    case Format_FFmpeg: {
+      n = 3 * _Width * _Height;
+      if (fwrite(rgb, 1, n, _Stream) == static_cast<size_t>(n)) return true;
+      if (errno == EPIPE) {
+        std::cerr << "MovieWriter::Write: ffmpeg terminated before all frames were written" << std::endl;
+#ifndef _WIN32
+        // Discard SIGPIPE which is pending because it is blocked
+        sigset_t pending, mask;
+        int signal;
+        sigpending(&pending);
+        if (sigismember(&pending, SIGPIPE)) {
+          sigemptyset(&mask);
+          sigaddset(&mask, SIGPIPE);
+          sigwait(&mask, &signal);
+        }
+#endif
+      }
+      return false;
+    }
+    default: {
+      // Planar RGB image as expected by the PNG writer
+      mirtk::GenericImage<unsigned char> image(_Width, _Height, 3, 1);
+      n = _Width * _Height;
+      ptr = image.GetPointerToVoxels();
+      for (i = 0; i < n; i++) {
+        ptr[i]     = rgb[3*i];
+        ptr[i+n]   = rgb[3*i+1];
+        ptr[i+2*n] = rgb[3*i+2];
+      }
+      image.Write(this->FrameFileName(_Frame).c_str());
+      return true;
+    }
+  }
+}
+
+bool MovieWriter::Close()
+{
+  bool ok;
+
+  if (_Writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(_Mutex);
+      _Stop = true;
+    }
+    _QueueCondition.notify_all();
+    _Writer.join();
+  }
+  ok = !_Failed;
+  if (_Format == Format_FFmpeg) {
+    if (!this->StopFFmpeg()) ok = false;
+  } else if (_Stream != NULL) {
+    if (fclose(_Stream) != 0) ok = false;
+    _Stream = NULL;
+  }
+  if (!ok) std::cerr << "MovieWriter::Close: Failed to write movie " << _FileName << std::endl;
+  _Failed = false;
+  return ok;
+}
@@ -0,0 +1,273 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mirtk/ObjectSequence.h>
+
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <mirtk/PointSetIO.h>
+
+#include <vtkPolyData.h>
+
+
+ObjectSequence::ObjectSequence(int prefetch, size_t budget)
+{
+  _Prefetch = (prefetch > 0) ? prefetch : 0;
+  _Budget   = budget;
+  _Frame    = 0;
+  _Stop     = false;
+}
+
+ObjectSequence::~ObjectSequence()
+{
+  this->Clear();
+}
+
+bool ObjectSequence::CanRead(const char *name)
+{
+  size_t len;
+  char header[256];
+
+  std::ifstream file(name, std::ios::in | std::ios::binary);
+  if (!file) {
+    std::cerr << "ObjectSequence::CanRead: Cannot open file " << name << std::endl;
+    return false;
+  }
+  file.read(header, sizeof(header) - 1);
+  header[file.gcount()] = '\0';
+  if (file.gcount() == 0) {
+    std::cerr << "ObjectSequence::CanRead: File " << name << " is empty" << std::endl;
+    return false;
+  }
+
+  // Only the header of VTK files is checked, other formats are read on demand
+  len = strlen(name);
+  if (len > 4 && strcmp(name + len - 4, ".vtk") == 0 && strncmp(header, "# vtk DataFile", 14) != 0) {
+    std::cerr << "ObjectSequence::CanRead: File " << name << " is not a legacy VTK file" << std::endl;
+    return false;
+  }
+  if (len > 4 && strcmp(name + len - 4, ".vtp") == 0 && strstr(header, "<VTKFile") == NULL) {
+    std::cerr << "ObjectSequence::CanRead: File " << name << " is not a VTK XML file" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+vtkSmartPointer<vtkPointSet> ObjectSequence::Read(const char *name)
+{
+  // An empty object is kept on failure such that it is not read again each frame
+  vtkSmartPointer<vtkPolyData> object = mirtk::ReadPolyData(name, false);
+  if (object->GetNumberOfPoints() == 0) {
+    std::cerr << "ObjectSequence::Read: Object " << name << " could not be read or is empty" << std::endl;
+  }
+  return vtkSmartPointer<vtkPointSet>(object.GetPointer());
+}
+
+void ObjectSequence::Run()
+{
+  int i;
+  std::string name;
+
+  std::unique_lock<std::mutex> lock(_Mutex);
+  while (true) {
+    _QueueCondition.wait(lock, [this] { return _Stop || !_Queue.empty(); });
+    if (_Stop) break;
+    i = _Queue.front();
+    _Queue.pop_front();
+    name = _FileName[i];
+
+    // Read object without holding the lock
+    lock.unlock();
+    vtkSmartPointer<vtkPointSet> object = Read(name.c_str());
+    lock.lock();
+
+    // Not discarded before it was displayed in one of the next frames
+    _Object[i]   = object;
+    _LastUsed[i] = _Frame + _Prefetch;
+    _Pending[i]  = false;
+    _ReadyCondition.notify_all();
+  }
+}
+
+void ObjectSequence::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Stop = true;
+    while (!_Queue.empty()) {
+      _Pending[_Queue.front()] = false;
+      _Queue.pop_front();
+    }
+  }
+  _QueueCondition.notify_all();
+  if (_Worker.joinable()) _Worker.join();
+  _Stop = false;
+}
+
+bool ObjectSequence::Add(const char *name)
+{
+  if (!CanRead(name)) return false;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _FileName.push_back(name);
+  _Object.push_back(vtkSmartPointer<vtkPointSet>());
+  _Cutter.push_back(new SurfaceCutter);
+  _LastUsed.push_back(0);
+  _Pending.push_back(false);
+  return true;
+}
+
+void ObjectSequence::Clear()
+{
+  size_t i;
+
+  this->Stop();
+  for (i = 0; i < _Cutter.size(); i++) delete _Cutter[i];
+  _FileName.clear();
+  _Object.clear();
+  _Cutter.clear();
+  _LastUsed.clear();
+  _Pending.clear();
+}
+
+void ObjectSequence::SetPrefetch(int n)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _Prefetch = (n > 0) ? n : 0;
+}
+
+void ObjectSequence::SetBudget(size_t budget)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _Budget = budget;
+  this->Evict();
+}
+
+size_t ObjectSequence::MemorySize()
+{
+  size_t i, size;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  size = 0;
+  for (i = 0; i < _Object.size(); i++) {
+    if (_Object[i].GetPointer() == NULL) continue;
+    size += static_cast<size_t>(_Object[i]->GetActualMemorySize()) * 1024;
+    size += _Cutter[i]->MemorySize();
+  }
+  return size;
+}
+
+void ObjectSequence::Evict()
+{
+  size_t i, size, oldest;
+
+  size = 0;
+  for (i = 0; i < _Object.size(); i++) {
+    if (_Object[i].GetPointer() == NULL) continue;
+    size += static_cast<size_t>(_Object[i]->GetActualMemorySize()) * 1024;
+    size += _Cutter[i]->MemorySize();
+  }
+  while (size > _Budget) {
+    // Least recently displayed object, not including the current frame
+    oldest = _Object.size();
+    for (i = 0; i < _Object.size(); i++) {
+      if (_Object[i].GetPointer() == NULL || _LastUsed[i] >= _Frame) continue;
+      if (oldest == _Object.size() || _LastUsed[i] < _LastUsed[oldest]) oldest = i;
+    }
+    if (oldest == _Object.size()) break;
+    size -= static_cast<size_t>(_Object[oldest]->GetActualMemorySize()) * 1024;
+    size -= _Cutter[oldest]->MemorySize();
+    _Cutter[oldest]->Initialize(NULL);
+    _Object[oldest] = vtkSmartPointer<vtkPointSet>();
+  }
+}
+
+void ObjectSequence::NextFrame()
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  this->Evict();
+  _Frame++;
+}
+
+void ObjectSequence::Prefetch(int i)
+{
+  int j, n;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  if (_Prefetch == 0) return;
+  if (!_Worker.joinable()) _Worker = std::thread(&ObjectSequence::Run, this);
+
+  // Forget about objects which have not been started yet,
+  // the viewer has moved on and needs those following i first
+  while (!_Queue.empty()) {
+    _Pending[_Queue.front()] = false;
+    _Queue.pop_front();
+  }
+  n = static_cast<int>(_FileName.size());
+  for (j = i + 1; j <= i + _Prefetch && j < n; j++) {
+    if (_Object[j].GetPointer() == NULL && !_Pending[j]) {
+      _Pending[j] = true;
+      _Queue.push_back(j);
+    }
+  }
+  if (!_Queue.empty()) _QueueCondition.notify_all();
+}
+
+SurfaceCutter *ObjectSequence::Get(int i)
+{
+  if ((i < 0) || (i >= this->Size())) {
+    std::cerr << "ObjectSequence::Get: Invalid object: " << i << std::endl;
+    return NULL;
+  }
+
+  std::unique_lock<std::mutex> lock(_Mutex);
+
+  // Wait for worker thread if it is currently reading this object
+  if (_Pending[i]) {
+    std::deque<int>::iterator it;
+    for (it = _Queue.begin(); it != _Queue.end(); ++it) {
+      if (*it == i) break;
+    }
+    if (it != _Queue.end()) {
+      // Not started yet, read it ourselves below
+      _Queue.erase(it);
+      _Pending[i] = false;
+    } else {
+      _ReadyCondition.wait(lock, [this, i] { return !_Pending[i]; });
+    }
+  }
+
+  if (_Object[i].GetPointer() == NULL) {
+    std::string name = _FileName[i];
+    lock.unlock();
+    vtkSmartPointer<vtkPointSet> object = Read(name.c_str());
+    lock.lock();
+    _Object[i] = object;
+  }
+  if (_Cutter[i]->GetObject() != _Object[i].GetPointer()) {
+    _Cutter[i]->Initialize(_Object[i]);
+  }
+  _LastUsed[i] = _Frame;
+  return _Cutter[i];
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <mirtk/PlaybackScheduler.h>
+
+
+PlaybackScheduler::PlaybackScheduler()
+{
+  _Period     = 1;
+  _FirstFrame = 0;
+  _Pending    = 0;
+  _Presented  = 0;
+  _Dropped    = 0;
+  _Running    = false;
+}
+
+double PlaybackScheduler::Elapsed() const
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _Start).count();
+}
+
+void PlaybackScheduler::Start(int frame, double period)
+{
+  _Start      = std::chrono::steady_clock::now();
+  _Period     = (period > 0) ? period : 1;
+  _FirstFrame = frame;
+  _Pending    = 1;
+  _Presented  = 0;
+  _Dropped    = 0;
+  _Running    = true;
+}
+
+void PlaybackScheduler::Stop()
+{
+  _Running = false;
+}
+
+long PlaybackScheduler::Due() const
+{
+  return static_cast<long>(floor(this->Elapsed() / _Period));
+}
+
+int PlaybackScheduler::Frame(long tick, int n) const
+{
+  if (n <= 0) return 0;
+  return static_cast<int>((_FirstFrame + tick) % n);
+}
+
+double PlaybackScheduler::TimeUntil(long tick) const
+{
+  return tick * _Period - this->Elapsed();
+}
+
+long PlaybackScheduler::Present()
+{
+  long due;
+
+  _Presented++;
+
+  // Skip frames which are overdue already, these would be late as well
+  due = this->Due();
+  if (due > _Pending) {
+    _Dropped += due - _Pending;
+    _Pending  = due;
+  }
+  return ++_Pending;
+}
+
+double PlaybackScheduler::RequestedRate() const
+{
+  return 1.0 / _Period;
+}
+
+double PlaybackScheduler::AchievedRate() const
+{
+  double elapsed = this->Elapsed();
+  return (elapsed > 0) ? _Presented / elapsed : .0;
+}
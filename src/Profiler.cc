@@ -0,0 +1,272 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <mirtk/Profiler.h>
+
+
+namespace {
+
+// Profilers enabled by the environment, the viewer tools usually exit
+// without destroying the registration viewer
+std::vector<Profiler *> profilers;
+
+void FinishProfilers()
+{
+  while (!profilers.empty()) profilers.back()->Finish();
+}
+
+}
+
+
+double Profiler::Stage::Mean() const
+{
+  int i, n;
+  double sum;
+
+  n = (Count < WindowSize) ? static_cast<int>(Count) : WindowSize;
+  if (n == 0) return 0;
+  sum = 0;
+  for (i = 0; i < n; i++) sum += Window[i];
+  return sum / n;
+}
+
+double Profiler::Stage::Last() const
+{
+  return (Count > 0) ? Window[(Count - 1) % WindowSize] : 0;
+}
+
+Profiler::Profiler()
+{
+  const char *value;
+
+  _Start       = Clock::now();
+  _Trace       = NULL;
+  _Enabled     = false;
+  _Environment = false;
+  this->Reset();
+
+  value = getenv("MIRTK_VIEWER_PROFILE");
+  if (value != NULL && value[0] != '\0' && strcmp(value, "0") != 0) {
+    _Enabled     = true;
+    _Environment = true;
+  }
+  value = getenv("MIRTK_VIEWER_TRACE");
+  if (value != NULL && value[0] != '\0') {
+    _Environment = this->OpenTrace(value);
+  }
+  if (_Environment) {
+    if (profilers.empty()) atexit(FinishProfilers);
+    profilers.push_back(this);
+  }
+}
+
+Profiler::~Profiler()
+{
+  this->Finish();
+}
+
+void Profiler::Finish()
+{
+  size_t i;
+
+  this->CloseTrace();
+  if (_Environment && _Frames > 0) std::cout << this->Report();
+  for (i = 0; i < profilers.size(); i++) {
+    if (profilers[i] == this) {
+      profilers.erase(profilers.begin() + i);
+      break;
+    }
+  }
+  _Environment = false;
+}
+
+void Profiler::Enable(bool enabled)
+{
+  _Enabled = enabled;
+}
+
+bool Profiler::OpenTrace(const char *name)
+{
+  this->CloseTrace();
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _Trace = fopen(name, "w");
+  if (_Trace == NULL) {
+    std::cerr << "Profiler::OpenTrace: Cannot open file " << name << std::endl;
+    return false;
+  }
+  fputs("[\n", _Trace);
+  _Enabled = true;
+  return true;
+}
+
+void Profiler::CloseTrace()
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  if (_Trace == NULL) return;
+  // Metadata event terminates the list without a trailing comma
+  fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"MIRTK Viewer\"}}\n]\n", _Trace);
+  fclose(_Trace);
+  _Trace = NULL;
+}
+
+double Profiler::Now() const
+{
+  return std::chrono::duration<double>(Clock::now() - _Start).count();
+}
+
+void Profiler::TraceEvent(const char *name, char phase, double start, double end, int viewer, long value)
+{
+  int tid;
+
+  std::map<std::thread::id, int>::iterator it = _Thread.find(std::this_thread::get_id());
+  if (it == _Thread.end()) {
+    tid = static_cast<int>(_Thread.size()) + 1;
+    _Thread[std::this_thread::get_id()] = tid;
+  } else {
+    tid = it->second;
+  }
+  if (phase == 'X') {
+    fprintf(_Trace, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+            name, 1e6 * start, 1e6 * (end - start), tid);
+    if (viewer >= 0) fprintf(_Trace, ",\"args\":{\"viewer\":%d}", viewer);
+    fputs("},\n", _Trace);
+  } else {
+    fprintf(_Trace, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%ld}},\n",
+            name, 1e6 * start, tid, value);
+  }
+}
+
+void Profiler::Record(const char *name, int viewer, double start, double end)
+{
+  if (!_Enabled) return;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  Stage &stage = _Stage[std::make_pair(std::string(name), viewer)];
+  stage.Window[stage.Count % WindowSize] = end - start;
+  stage.Count++;
+  stage.Total += end - start;
+  if (end - start > stage.Max) stage.Max = end - start;
+  if (_Trace) this->TraceEvent(name, 'X', start, end, viewer, 0);
+}
+
+void Profiler::Count(const char *name, long n)
+{
+  if (!_Enabled) return;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _Counter[name] += n;
+}
+
+void Profiler::EndFrame(double duration)
+{
+  int i;
+  double now, ms, limit;
+
+  if (!_Enabled) return;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  ms = 1000 * duration;
+  for (i = 0, limit = 1; i < HistogramSize - 1 && ms >= limit; i++) limit *= 2;
+  _Histogram[i]++;
+  _Frames++;
+
+  // Counters of this frame include those of updates since the last one
+  _FrameCounter = _Counter;
+  _Counter.clear();
+  if (_Trace) {
+    now = this->Now();
+    for (std::map<std::string, long>::iterator it = _FrameCounter.begin(); it != _FrameCounter.end(); ++it) {
+      this->TraceEvent(it->first.c_str(), 'C', now, now, -1, it->second);
+    }
+  }
+}
+
+void Profiler::Reset()
+{
+  int i;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _Stage.clear();
+  _Counter.clear();
+  _FrameCounter.clear();
+  for (i = 0; i < HistogramSize; i++) _Histogram[i] = 0;
+  _Frames = 0;
+}
+
+std::map<std::pair<std::string, int>, Profiler::Stage> Profiler::GetStages() const
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  return _Stage;
+}
+
+std::map<std::string, long> Profiler::GetCounters() const
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  return _FrameCounter;
+}
+
+void Profiler::GetHistogram(long histogram[HistogramSize]) const
+{
+  int i;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  for (i = 0; i < HistogramSize; i++) histogram[i] = _Histogram[i];
+}
+
+std::string Profiler::Report() const
+{
+  int i;
+  char line[256];
+  long histogram[HistogramSize];
+  std::ostringstream os;
+
+  std::map<std::pair<std::string, int>, Stage> stages = this->GetStages();
+  std::map<std::string, long> counters = this->GetCounters();
+  this->GetHistogram(histogram);
+
+  for (std::map<std::pair<std::string, int>, Stage>::iterator it = stages.begin(); it != stages.end(); ++it) {
+    std::string name = it->first.first;
+    if (it->first.second >= 0) {
+      snprintf(line, sizeof(line), "[%d]", it->first.second);
+      name += line;
+    }
+    snprintf(line, sizeof(line), "%-24s %8.2f ms  mean %8.2f ms  max %8.2f ms  n %ld\n", name.c_str(),
+             1000 * it->second.Last(), 1000 * it->second.Mean(), 1000 * it->second.Max, it->second.Count);
+    os << line;
+  }
+  for (std::map<std::string, long>::iterator it = counters.begin(); it != counters.end(); ++it) {
+    snprintf(line, sizeof(line), "%-24s %ld\n", it->first.c_str(), it->second);
+    os << line;
+  }
+  os << "Frame time";
+  for (i = 0; i < HistogramSize; i++) {
+    if (i < HistogramSize - 1) {
+      snprintf(line, sizeof(line), "  <%d ms: %ld", 1 << i, histogram[i]);
+    } else {
+      snprintf(line, sizeof(line), "  more: %ld", histogram[i]);
+    }
+    os << line;
+  }
+  os << "\n";
+  return os.str();
+}
@@ -16,7 +16,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 #include <mirtk/OpenGl.h>
 #include <mirtk/RView.h>
@@ -24,13 +30,58 @@
 
 #include <mirtk/Image.h>
 #include <mirtk/Transformations.h>
-
-#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
-  #include <mirtk/PointSetIO.h>
-#endif
+#include <mirtk/MappedImage.h>
+#include <mirtk/TransformationSequence.h>
+#include <mirtk/Parallel.h>
 
 #include <mirtk/OpenGl.h>
 
+// Percentiles of intensities used as default display window
+#define DISPLAY_PERCENTILE_MIN  0.1
+#define DISPLAY_PERCENTILE_MAX 99.9
+
+// Default memory budget of slice cache in bytes
+#define SLICE_CACHE_BUDGET (256 * 1024 * 1024)
+
+// Pooled buffers of each viewer (cf. RView::Initialize)
+#define DRAWABLE_BUFFER       0
+#define TARGET_BUFFER         1
+#define SOURCE_BUFFER         2
+#define SEGMENTATION_BUFFER   3
+#define SELECTION_BUFFER      4
+#define NUMBER_OF_BUFFERS     5
+
+// Version of session files written by RView::Write, files without version
+// are configuration files of earlier releases
+#define SESSION_VERSION 2
+
+
+// Get zero-initialized output buffer of a viewer from the pool
+static mirtk::GreyPixel *PooledBuffer(BufferPool &pool, int viewer, int buffer, int n)
+{
+  mirtk::GreyPixel *data = pool.Get<mirtk::GreyPixel>(NUMBER_OF_BUFFERS * viewer + buffer, n);
+  memset(data, 0, n * sizeof(mirtk::GreyPixel));
+  return data;
+}
+
+// Whether image is a label image, such as a segmentation, i.e., its integral
+// voxel values are displayed with nearest neighbor interpolation
+static bool IsLabelImage(const mirtk::Image *image, mirtk::InterpolationMode mode)
+{
+  if (mode != mirtk::Interpolation_NN) return false;
+  switch (image->GetDataType()) {
+    case mirtk::MIRTK_VOXEL_CHAR:
+    case mirtk::MIRTK_VOXEL_UNSIGNED_CHAR:
+    case mirtk::MIRTK_VOXEL_SHORT:
+    case mirtk::MIRTK_VOXEL_UNSIGNED_SHORT:
+    case mirtk::MIRTK_VOXEL_INT:
+    case mirtk::MIRTK_VOXEL_UNSIGNED_INT:
+      return true;
+    default:
+      return false;
+  }
+}
+
 
 RView::RView(int x, int y)
 {
@@ -73,6 +124,23 @@ RView::RView(int x, int y)
   _segmentationInterpolator = mirtk::InterpolateImageFunction::New(mirtk::Interpolation_NN);
   _selectionInterpolator    = mirtk::InterpolateImageFunction::New(mirtk::Interpolation_NN);
 
+  // Default: Linear interpolation while interacting with the viewer
+  _targetFastInterpolator = mirtk::InterpolateImageFunction::New(mirtk::Interpolation_Linear);
+  _sourceFastInterpolator = mirtk::InterpolateImageFunction::New(mirtk::Interpolation_Linear);
+  _Progressive = true;
+  _Interactive = false;
+
+  // Default: Reslice from downsampled images when zoomed out, except
+  // memory-mapped images which would have to be read completely
+  _UsePyramid = true;
+  _UsePyramidOfMappedImages = false;
+  _targetPyramidLevel = 0;
+  _sourcePyramidLevel = 0;
+
+  // Default: Cache displayed slices only during cine playback
+  _CacheSlices = false;
+  _sliceCache.SetBudget(SLICE_CACHE_BUDGET);
+
   // Default time frame
   _targetFrame = 0;
   _sourceFrame = 0;
@@ -153,13 +221,11 @@ RView::RView(int x, int y)
 
   // Initialize landmark display
   _DisplayLandmarks = false;
+  _targetLandmarksVersion = 0;
+  _sourceLandmarksVersion = 0;
 
 #if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
   // Initialize object and display
-  _NoOfObjects = 0;
-  for (int i = 0; i < MAX_NUMBER_OF_OBJECTS; i++) {
-    _Object[i] = nullptr;
-  }
   _DisplayObject = false;
   _DisplayObjectWarp = false;
   _DisplayObjectGrid = false;
@@ -172,6 +238,7 @@ RView::RView(int x, int y)
 
   // Allocate memory for segmentation
   _segmentationImage = new mirtk::GreyImage;
+  _segmentationVersion = 0;
 
   // Allocate memory for segment Table
   _segmentTable = new SegmentTable();
@@ -181,6 +248,8 @@ RView::RView(int x, int y)
   // transformation should always be an identity transformation.
   _targetTransform = new mirtk::AffineTransformation;
   _sourceTransform = new mirtk::AffineTransformation;
+  _sourceTransformVersion = 0;
+  _sourceTransformCacheVersion = 0;
   _segmentationTransform = new mirtk::AffineTransformation;
   _selectionTransform = new mirtk::AffineTransformation;
 
@@ -203,6 +272,10 @@ RView::RView(int x, int y)
   _sourceDisplayMax = 1;
   _subtractionDisplayMin = 0;
   _subtractionDisplayMax = 1;
+  _targetRangeVoxel = -1;
+  _sourceRangeVoxel = -1;
+  _rangeStop = false;
+  _rangeDone = false;
 
   // Allocate memory for source and target lookup tables
   _targetLookupTable = new LookupTable;
@@ -216,6 +289,16 @@ RView::RView(int x, int y)
   _RegionGrowingThresholdMin = 0;
   _RegionGrowingThresholdMax = 0;
 
+  // No background updates yet
+  _updateGeneration   = 0;
+  _updateCompleted    = 0;
+  _updateRequested    = 0;
+  _updateStop         = false;
+  _updateCallback     = NULL;
+  _updateCallbackData = NULL;
+  _resliceTransform        = NULL;
+  _resliceTransformVersion = 0;
+
   // By default configure rview to start with three orthogonal views
   _configMode = _View_XY_XZ_YZ;
   this->Configure(View_XY_XZ_YZ);
@@ -223,47 +306,263 @@ RView::RView(int x, int y)
 
 RView::~RView()
 {
-#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
-  for (int i = 0; i < MAX_NUMBER_OF_OBJECTS; i++) {
-    if (_Object[i] != nullptr) _Object[i]->Delete();
+  // Stop reading of image sequences
+  _targetLoader.Stop();
+  _sourceLoader.Stop();
+  this->StopIntensityRange();
+
+  // Terminate background update thread
+  if (_updateThread.joinable()) {
+    _updateMutex.lock();
+    _updateStop = true;
+    _updateMutex.unlock();
+    _updateCondition.notify_all();
+    _updateThread.join();
   }
-#endif
+  delete _resliceTransform;
 }
 
 void RView::Update()
 {
-  int i, j, k, l;
+  unsigned long generation;
+
+  // Interpolators and cached displacements are shared with the update thread
+  LockResources();
+  generation = ++_updateGeneration;
+  if (this->RunUpdate(generation, false)) _updateCompleted = generation;
+  UnlockResources();
+}
+
+void RView::UpdateAsync()
+{
+  Lock();
+  if (!_updateThread.joinable()) {
+    _updateThread = std::thread(&RView::UpdateThread, this);
+  }
+  _updateRequested = ++_updateGeneration;
+  Unlock();
+  _updateCondition.notify_all();
+}
+
+void RView::UpdateThread()
+{
+  unsigned long done = 0, generation;
+
+  std::unique_lock<std::recursive_mutex> lock(_updateMutex);
+  while (true) {
+    _updateCondition.wait(lock, [this, &done] { return _updateStop || _updateRequested != done; });
+    if (_updateStop) break;
+    // A synchronous Update() cancelling this one has done the work already,
+    // a newer asynchronous request is picked up by the next iteration
+    done = _updateRequested;
+    generation = _updateGeneration;
+    if (!this->RunUpdate(generation, true)) continue;
+    _updateCompleted = generation;
+    if (_updateCallback) {
+      void (*f)(void *) = _updateCallback;
+      void *data = _updateCallbackData;
+      lock.unlock();
+      f(data);
+      lock.lock();
+    }
+  }
+}
+
+bool RView::UpdateCheckpoint(unsigned long generation, bool yield)
+{
+  if (yield) {
+    // Let GUI thread in between filter runs
+    _updateMutex.unlock();
+    std::this_thread::yield();
+    _updateMutex.lock();
+  }
+  return _updateGeneration == generation;
+}
+
+bool RView::ResliceUnlocked(unsigned long generation, int l, bool source,
+                            mirtk::Image *input, mirtk::InterpolateImageFunction *interpolator)
+{
+  double min, max;
+  mirtk::GreyImage *output;
+
+  // Configure filter of update thread as the one of the viewer, with a copy of
+  // the source transformation which the GUI thread may modify meanwhile
+  output = (source) ? _sourceImageOutput[l] : _targetImageOutput[l];
+  min    = (source) ? _sourceMin : _targetMin;
+  max    = (source) ? _sourceMax : _targetMax;
+  _resliceOutput.Initialize(output->GetImageAttributes());
+  _resliceFilter.Input(input);
+  _resliceFilter.Output(&_resliceOutput);
+  _resliceFilter.Interpolator(interpolator);
+  _resliceFilter.SourcePaddingValue(-1);
+  _resliceFilter.ScaleFactor(10000.0 / (max - min));
+  _resliceFilter.Offset(-min * 10000.0 / (max - min));
+  if (source && _sourceTransformApply) {
+    if (_resliceTransform == NULL || _resliceTransformVersion != _sourceTransformVersion) {
+      delete _resliceTransform;
+      _resliceTransform = mirtk::Transformation::New(_sourceTransform);
+      _resliceTransformVersion = _sourceTransformVersion;
+    }
+    _resliceFilter.Transformation(_resliceTransform);
+    _resliceFilter.Cache(&_sourceTransformCache);
+  } else {
+    _resliceFilter.Transformation(_targetTransform);
+    _resliceFilter.Cache(nullptr);
+  }
+  _resliceFilter.Invert(source && _sourceTransformInvert);
+  if (source) {
+    _resliceFilter.OutputTimeOffset(_targetImage->ImageToTime(_targetFrame) - _sourceImage->ImageToTime(_sourceFrame));
+  } else {
+    _resliceFilter.OutputTimeOffset(0);
+  }
+
+  // Reslice into own buffer such that the GUI thread can draw and handle
+  // events meanwhile. It only waits for this slice before it replaces the
+  // input, interpolator or cached displacements (cf. LockResources).
+  _resliceMutex.lock();
+  _updateMutex.unlock();
+  _resliceFilter.Run();
+  _resliceMutex.unlock();
+  _updateMutex.lock();
+
+  // Discard slice if viewer changed or newer update was requested meanwhile
+  if (_updateGeneration != generation || l >= _NoOfViewers) return false;
+  output = (source) ? _sourceImageOutput[l] : _targetImageOutput[l];
+  if (output->GetImageAttributes() != _resliceOutput.GetImageAttributes()) return false;
+  memcpy(output->GetPointerToVoxels(), _resliceOutput.GetPointerToVoxels(),
+         output->GetNumberOfVoxels() * sizeof(mirtk::GreyPixel));
+  return true;
+}
+
+bool RView::RunUpdate(unsigned long generation, bool yield)
+{
+  int i, j, k, l, level, ready;
   double blendA, blendB;
   Color *ptr3;
   mirtk::GreyPixel *ptr1, *ptr2, *ptr4, *ptr5;
   LookupTable *lut1, *lut2;
+  mirtk::InterpolateImageFunction *targetInterpolator, *sourceInterpolator;
+  mirtk::Image *targetInput, *sourceInput;
+  SliceCache::Key key;
+
+  ProfileScope update(_profiler, "Update");
+
+  // Slices which were displayed before, e.g., in the previous loop of
+  // a cine playback, are copied from the cache instead of resliced
+  if (_CacheSlices) {
+    this->GetSliceCacheKey(key);
+    if (this->RestoreSlices(key)) {
+      _profiler.Count("Slice cache hits", 1);
+      _targetUpdate       = false;
+      _sourceUpdate       = false;
+      _segmentationUpdate = false;
+      _selectionUpdate    = false;
+      return true;
+    }
+  }
 
-  // Check whether target and/or source and/or segmentation need updating
-  for (l = 0; l < _NoOfViewers; l++) {
-    if (_targetUpdate && !_targetImage->IsEmpty()) {
-      _targetTransformFilter[l]->SourcePaddingValue(-1);
-      _targetTransformFilter[l]->Run();
+  // Use fast interpolation while interacting with the viewer
+  targetInterpolator = _targetInterpolator;
+  sourceInterpolator = _sourceInterpolator;
+  if (_Interactive) {
+    if (this->GetTargetInterpolationMode() != mirtk::Interpolation_NN &&
+        this->GetTargetInterpolationMode() != mirtk::Interpolation_Linear) {
+      targetInterpolator = _targetFastInterpolator;
     }
-    if (_sourceUpdate && !_sourceImage->IsEmpty()) {
-      _sourceTransformFilter[l]->SourcePaddingValue(-1);
-      _sourceTransformFilter[l]->Run();
+    if (this->GetSourceInterpolationMode() != mirtk::Interpolation_NN &&
+        this->GetSourceInterpolationMode() != mirtk::Interpolation_Linear) {
+      sourceInterpolator = _sourceFastInterpolator;
     }
-    if (_segmentationUpdate && !_segmentationImage->IsEmpty()) {
-      _segmentationTransformFilter[l]->Run();
+  }
+
+  // Reslice from pyramid level matching the display resolution. Levels are
+  // computed in the background, until the matching one is ready the slices
+  // are resliced from the coarsest finer one (cf. UpdatePyramids).
+  targetInput = _targetImage;
+  sourceInput = _sourceImage;
+  if (_targetUpdate) _targetPyramidLevel = 0;
+  if (_sourceUpdate) _sourcePyramidLevel = 0;
+  if (_UsePyramid) {
+    // Not while frames are being read, the levels would miss these frames
+    if (_targetUpdate && !_targetImage->IsEmpty() && !_targetLoader.IsLoading() &&
+        (_UsePyramidOfMappedImages || !IsMappedImage(_targetImage))) {
+      level = _targetPyramid.SelectLevel(_resolution);
+      ready = _targetPyramid.Request(level);
+      targetInput = _targetPyramid.GetLevel(ready);
+      if (ready < level) _targetPyramidLevel = level;
     }
-    if (_selectionUpdate && !_voxelContour._raster->IsEmpty()) {
-      _selectionTransformFilter[l]->Run();
+    if (_sourceUpdate && !_sourceImage->IsEmpty() && !_sourceLoader.IsLoading() &&
+        (_UsePyramidOfMappedImages || !IsMappedImage(_sourceImage))) {
+      level = _sourcePyramid.SelectLevel(_resolution);
+      ready = _sourcePyramid.Request(level);
+      sourceInput = _sourcePyramid.GetLevel(ready);
+      if (ready < level) _sourcePyramidLevel = level;
     }
   }
 
-  // No more updating required
+  // Check whether target and/or source and/or segmentation need updating.
+  // Flags are only reset once all viewers are done such that a cancelled
+  // update is completed by the next one.
+  if (_targetUpdate && !_targetImage->IsEmpty()) {
+    for (l = 0; l < _NoOfViewers; l++) {
+      if (!this->UpdateCheckpoint(generation, yield)) return false;
+      ProfileScope reslice(_profiler, "Reslice target", l);
+      if (yield) {
+        if (!this->ResliceUnlocked(generation, l, false, targetInput, targetInterpolator)) return false;
+      } else {
+        _targetTransformFilter[l]->Input(targetInput);
+        _targetTransformFilter[l]->Interpolator(targetInterpolator);
+        _targetTransformFilter[l]->SourcePaddingValue(-1);
+        _targetTransformFilter[l]->Run();
+      }
+      _profiler.Count("Voxels resampled", _targetImageOutput[l]->GetNumberOfVoxels());
+    }
+  }
   _targetUpdate = false;
+  if (_sourceUpdate && !_sourceImage->IsEmpty()) {
+    // Displacements are recomputed once the transformation was modified
+    if (_sourceTransformCacheVersion != _sourceTransformVersion) {
+      if (!_sourceTransformCache.IsEmpty()) _sourceTransformCache.Modified(true);
+      _sourceTransformCacheVersion = _sourceTransformVersion;
+    }
+    for (l = 0; l < _NoOfViewers; l++) {
+      if (!this->UpdateCheckpoint(generation, yield)) return false;
+      ProfileScope reslice(_profiler, "Reslice source", l);
+      if (yield) {
+        if (!this->ResliceUnlocked(generation, l, true, sourceInput, sourceInterpolator)) return false;
+      } else {
+        _sourceTransformFilter[l]->Input(sourceInput);
+        _sourceTransformFilter[l]->Interpolator(sourceInterpolator);
+        _sourceTransformFilter[l]->SourcePaddingValue(-1);
+        _sourceTransformFilter[l]->Run();
+      }
+      _profiler.Count("Voxels resampled", _sourceImageOutput[l]->GetNumberOfVoxels());
+    }
+  }
   _sourceUpdate = false;
+  if (_segmentationUpdate && !_segmentationImage->IsEmpty()) {
+    for (l = 0; l < _NoOfViewers; l++) {
+      if (!this->UpdateCheckpoint(generation, yield)) return false;
+      ProfileScope reslice(_profiler, "Reslice segmentation", l);
+      _segmentationTransformFilter[l]->Run();
+      _profiler.Count("Voxels resampled", _segmentationImageOutput[l]->GetNumberOfVoxels());
+    }
+  }
   _segmentationUpdate = false;
+  if (_selectionUpdate && !_voxelContour._raster->IsEmpty()) {
+    for (l = 0; l < _NoOfViewers; l++) {
+      if (!this->UpdateCheckpoint(generation, yield)) return false;
+      ProfileScope reslice(_profiler, "Reslice selection", l);
+      _selectionTransformFilter[l]->Run();
+      _profiler.Count("Voxels resampled", _selectionImageOutput[l]->GetNumberOfVoxels());
+    }
+  }
   _selectionUpdate = false;
+  if (!this->UpdateCheckpoint(generation, false)) return false;
 
   // Combine target and source image
   for (k = 0; k < _NoOfViewers; k++) {
+    ProfileScope composite(_profiler, "Composite", k);
     ptr1 = _targetImageOutput[k]->GetPointerToVoxels();
     lut1 = _targetLookupTable;
     ptr2 = _sourceImageOutput[k]->GetPointerToVoxels();
@@ -412,6 +711,7 @@ void RView::Update()
     }
 
     if (_DisplaySegmentationLabels) {
+      ProfileScope blend(_profiler, "Blend labels", k);
       ptr3 = _drawable[k];
       // Display segmentation on top of all view modes
       for (j = 0; j < _viewer[k]->GetHeight(); j++) {
@@ -448,11 +748,132 @@ void RView::Update()
       }
     }
   }
+  // Slices of a finer level than the one awaited are not cached, such
+  // that the slices of the same key always look the same
+  if (_CacheSlices && _targetPyramidLevel == 0 && _sourcePyramidLevel == 0) {
+    this->StoreSlices(key);
+  }
+  return true;
+}
+
+void RView::GetSliceCacheKey(SliceCache::Key &key)
+{
+  int i, k;
+
+  key.clear();
+
+  // Time frames and how these are combined
+  key.push_back(_targetFrame);
+  key.push_back(_sourceFrame);
+  key.push_back(_viewMode);
+  key.push_back(_viewMix);
+  key.push_back(_DisplaySegmentationLabels);
+  key.push_back(_voxelContour.Size());
+
+  // Segmentation labels and their colours, transparency and visibility
+  key.push_back(_segmentationVersion);
+  key.push_back(_segmentTable->GetVersion());
+
+  // Intensity rescaling and lookup tables
+  key.push_back(_targetMin);
+  key.push_back(_targetMax);
+  key.push_back(_sourceMin);
+  key.push_back(_sourceMax);
+  key.push_back(_targetLookupTable->_minDisplay);
+  key.push_back(_targetLookupTable->_maxDisplay);
+  key.push_back(_targetLookupTable->_mode);
+  key.push_back(_sourceLookupTable->_minDisplay);
+  key.push_back(_sourceLookupTable->_maxDisplay);
+  key.push_back(_sourceLookupTable->_mode);
+  key.push_back(_subtractionLookupTable->_minDisplay);
+  key.push_back(_subtractionLookupTable->_maxDisplay);
+  key.push_back(_subtractionLookupTable->_mode);
+
+  // Reslicing
+  key.push_back(this->GetTargetInterpolationMode());
+  key.push_back(this->GetSourceInterpolationMode());
+  key.push_back(_Interactive);
+  key.push_back(_UsePyramid);
+  key.push_back(_UsePyramidOfMappedImages);
+  key.push_back(_sourceTransformApply);
+  key.push_back(_sourceTransformInvert);
+  key.push_back(_sourceTransform->NumberOfDOFs());
+  key.push_back(_sourceTransformVersion);
+
+  // Plane geometry of each viewer
+  for (k = 0; k < _NoOfViewers; k++) {
+    const mirtk::ImageAttributes &attr = _targetImageOutput[k]->GetImageAttributes();
+    key.push_back(_isSourceViewer[k]);
+    key.push_back(attr._x);
+    key.push_back(attr._y);
+    key.push_back(attr._dx);
+    key.push_back(attr._dy);
+    key.push_back(attr._xorigin);
+    key.push_back(attr._yorigin);
+    key.push_back(attr._zorigin);
+    for (i = 0; i < 3; i++) {
+      key.push_back(attr._xaxis[i]);
+      key.push_back(attr._yaxis[i]);
+    }
+  }
+}
+
+bool RView::RestoreSlices(const SliceCache::Key &key)
+{
+  int k;
+  size_t n, offset;
+
+  const SliceCache::Buffers *buffers = _sliceCache.Find(key);
+  if (buffers == NULL) return false;
+
+  for (k = 0; k < _NoOfViewers; k++) {
+    const char *buffer = (*buffers)[k].data();
+    n = _targetImageOutput[k]->GetNumberOfVoxels();
+    offset = 0;
+    memcpy(_drawable[k], buffer + offset, n * sizeof(Color));
+    offset += n * sizeof(Color);
+    memcpy(_targetImageOutput[k]->GetPointerToVoxels(), buffer + offset, n * sizeof(mirtk::GreyPixel));
+    offset += n * sizeof(mirtk::GreyPixel);
+    memcpy(_sourceImageOutput[k]->GetPointerToVoxels(), buffer + offset, n * sizeof(mirtk::GreyPixel));
+    offset += n * sizeof(mirtk::GreyPixel);
+    memcpy(_segmentationImageOutput[k]->GetPointerToVoxels(), buffer + offset, n * sizeof(mirtk::GreyPixel));
+    offset += n * sizeof(mirtk::GreyPixel);
+    memcpy(_selectionImageOutput[k]->GetPointerToVoxels(), buffer + offset, n * sizeof(mirtk::GreyPixel));
+  }
+  return true;
+}
+
+void RView::StoreSlices(const SliceCache::Key &key)
+{
+  int k;
+  size_t n, offset;
+
+  // Keep the resliced images as well, these are needed for contours
+  SliceCache::Buffers buffers(_NoOfViewers);
+  for (k = 0; k < _NoOfViewers; k++) {
+    n = _targetImageOutput[k]->GetNumberOfVoxels();
+    buffers[k].resize(n * (sizeof(Color) + 4 * sizeof(mirtk::GreyPixel)));
+    char *buffer = buffers[k].data();
+    offset = 0;
+    memcpy(buffer + offset, _drawable[k], n * sizeof(Color));
+    offset += n * sizeof(Color);
+    memcpy(buffer + offset, _targetImageOutput[k]->GetPointerToVoxels(), n * sizeof(mirtk::GreyPixel));
+    offset += n * sizeof(mirtk::GreyPixel);
+    memcpy(buffer + offset, _sourceImageOutput[k]->GetPointerToVoxels(), n * sizeof(mirtk::GreyPixel));
+    offset += n * sizeof(mirtk::GreyPixel);
+    memcpy(buffer + offset, _segmentationImageOutput[k]->GetPointerToVoxels(), n * sizeof(mirtk::GreyPixel));
+    offset += n * sizeof(mirtk::GreyPixel);
+    memcpy(buffer + offset, _selectionImageOutput[k]->GetPointerToVoxels(), n * sizeof(mirtk::GreyPixel));
+  }
+  _sliceCache.Insert(key, buffers);
 }
 
 void RView::Draw()
 {
   int k;
+  double start;
+
+  start = _profiler.IsEnabled() ? _profiler.Now() : 0;
 
   // Clear window
   glClear( GL_COLOR_BUFFER_BIT);
@@ -462,6 +883,23 @@ void RView::Draw()
     count_view_mode[_viewer[k]->GetViewerMode()] += 1;
   }
 
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+  // Objects displayed before this frame may be discarded when over budget
+  if (_DisplayObject) _Objects.NextFrame();
+#endif
+
+  // Map landmarks once for all viewers, only if landmarks or transformation changed
+  {
+    ProfileScope stage(_profiler, "Index landmarks");
+    _targetLandmarkIndex.Update(_targetLandmarks, _targetLandmarksVersion, NULL, false, 0);
+    if (_sourceTransformApply) {
+      _sourceLandmarkIndex.Update(_sourceLandmarks, _sourceLandmarksVersion,
+                                  _sourceTransform, !_sourceTransformInvert, _sourceTransformVersion);
+    } else {
+      _sourceLandmarkIndex.Update(_sourceLandmarks, _sourceLandmarksVersion, NULL, false, 0);
+    }
+  }
+
   // Draw images
   for (k = 0; k < _NoOfViewers; k++) {
 
@@ -485,21 +923,27 @@ void RView::Draw()
     display_correspondences = false;
 
     // Draw the image
-    _viewer[k]->DrawImage(_drawable[k]);
+    {
+      ProfileScope stage(_profiler, "Draw image", k);
+      _viewer[k]->DrawImage(_drawable[k]);
+    }
 
     // Make sure to clip everything to this viewer
     _viewer[k]->Clip();
 
     // Draw iso-contours in target image if needed
     if (display_target_contour) {
+      ProfileScope stage(_profiler, "Draw isolines", k);
       _viewer[k]->DrawIsolines(_targetImageOutput[k], _targetLookupTable->GetMinDisplayIntensity());
     }
     // Draw iso-contours in source image if needed
     if (display_source_contour) {
+      ProfileScope stage(_profiler, "Draw isolines", k);
       _viewer[k]->DrawIsolines(_sourceImageOutput[k], _sourceLookupTable->GetMinDisplayIntensity());
     }
     // Draw segmentation if needed
     if (display_segmentation_contours) {
+      ProfileScope stage(_profiler, "Draw segmentation", k);
       _viewer[k]->DrawSegmentationContour(_segmentationImageOutput[k]);
     }
     // Draw tag grid if needed
@@ -512,6 +956,7 @@ void RView::Draw()
 
     // Update image viewer if necessary
     if (_DisplayDeformationGrid || _DisplayDeformationPoints || _DisplayDeformationArrows) {
+      ProfileScope stage(_profiler, "Draw deformation", k);
       if (_viewer[k]->Update(_sourceImageOutput[k], _sourceTransform)) {
         // Draw deformation grid if needed
         if (_DisplayDeformationGrid) {
@@ -530,13 +975,18 @@ void RView::Draw()
 
     // Draw landmarks if needed (true: red, false: green)
     if (display_target_landmarks) {
-      _viewer[k]->DrawLandmarks(_targetLandmarks, _selectedTargetLandmarks, _targetImageOutput[k], true, _DisplayLandmarks);
+      ProfileScope stage(_profiler, "Draw landmarks", k);
+      _viewer[k]->DrawLandmarks(_targetLandmarkIndex, _selectedTargetLandmarks, _targetImageOutput[k], true, _DisplayLandmarks);
     }
     if (display_source_landmarks) {
-      _viewer[k]->DrawLandmarks(_sourceLandmarks, _selectedSourceLandmarks, _targetImageOutput[k], false, _DisplayLandmarks);
+      ProfileScope stage(_profiler, "Draw landmarks", k);
+      _viewer[k]->DrawLandmarks(_sourceLandmarkIndex, _selectedSourceLandmarks, _targetImageOutput[k], false, _DisplayLandmarks);
     }
     if (display_correspondences) {
-      _viewer[k]->DrawCorrespondences(_targetLandmarks, _sourceLandmarks,
+      ProfileScope stage(_profiler, "Draw landmarks", k);
+      // Computed by the first viewer only, all others find the positions unchanged
+      _correspondenceIndex.Update(_targetLandmarks, _targetLandmarksVersion, _sourceTransform, true, _sourceTransformVersion);
+      _viewer[k]->DrawCorrespondences(_correspondenceIndex, _sourceLandmarks,
 //                                      _selectedTargetLandmarks,
                                       _targetImageOutput[k]);
     }
@@ -549,16 +999,17 @@ void RView::Draw()
 #if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
     // Draw  object if needed
     if (_DisplayObject) {
+        ProfileScope stage(_profiler, "Draw objects", k);
         if(_ObjectMovie) {
             int _objectFrame = 0;
-            if (_targetFrame > _NoOfObjects - 1){
-                _objectFrame = _NoOfObjects - 1;
+            if (_targetFrame > _Objects.Size() - 1){
+                _objectFrame = _Objects.Size() - 1;
             } else{
                 _objectFrame = _targetFrame;
             }
-            _viewer[k]->DrawObject(_Object[_objectFrame], _targetImageOutput[k]);
+            if (_objectFrame >= 0) _viewer[k]->DrawObject(_Objects.Get(_objectFrame), _targetImageOutput[k]);
         } else{
-          _viewer[k]->DrawObject(_Object, _targetImageOutput[k], _DisplayObjectWarp, _DisplayObjectGrid, _sourceTransform);
+          _viewer[k]->DrawObjects(_Objects, _targetImageOutput[k], _DisplayObjectWarp, _DisplayObjectGrid, _sourceTransform, _sourceTransformVersion);
         }
     }
 #endif
@@ -575,6 +1026,11 @@ void RView::Draw()
 
     this->Clip();
   }
+
+  if (_profiler.IsEnabled()) {
+    _profiler.Record("Draw", -1, start, _profiler.Now());
+    _profiler.EndFrame(_profiler.Now() - start);
+  }
 }
 
 void RView::SetOrigin(int i, int j)
@@ -910,732 +1366,817 @@ void RView::FillContour(int fill, int)
 
   // Update images
   _segmentationUpdate = true;
+  _segmentationVersion++;
   _selectionUpdate = true;
 }
 
-// part of IRTK, but dropped for MIRTK
-static size_t read_line(istream &in, char *buffer1, char *&buffer2)
+namespace {
+
+// Name of an enumeration value in session files
+struct SessionName
 {
-    char c;
+  const char *Name;
+  int         Value;
+};
+
+const SessionName config_mode_names[] = {
+  {"View_XY",         _View_XY},
+  {"View_XZ",         _View_XZ},
+  {"View_YZ",         _View_YZ},
+  {"View_XY_XZ_v",    _View_XY_XZ_v},
+  {"View_XY_YZ_v",    _View_XY_YZ_v},
+  {"View_XZ_YZ_v",    _View_XZ_YZ_v},
+  {"View_XY_XZ_h",    _View_XY_XZ_h},
+  {"View_XY_YZ_h",    _View_XY_YZ_h},
+  {"View_XZ_YZ_h",    _View_XZ_YZ_h},
+  {"View_XY_XZ_YZ",   _View_XY_XZ_YZ},
+  {"View_AB_XY_v",    _View_AB_XY_v},
+  {"View_AB_XZ_v",    _View_AB_XZ_v},
+  {"View_AB_YZ_v",    _View_AB_YZ_v},
+  {"View_AB_XY_h",    _View_AB_XY_h},
+  {"View_AB_XZ_h",    _View_AB_XZ_h},
+  {"View_AB_YZ_h",    _View_AB_YZ_h},
+  {"View_AB_XY_XZ_v", _View_AB_XY_XZ_v},
+  {"View_AB_XY_XZ_h", _View_AB_XY_XZ_h},
+  {nullptr, 0}
+};
+
+// Viewer layouts in the order of ConfigViewerMode
+RViewConfig *const config_modes[] = {
+  View_XY, View_XZ, View_YZ,
+  View_XY_XZ_v, View_XY_YZ_v, View_XZ_YZ_v,
+  View_XY_XZ_h, View_XY_YZ_h, View_XZ_YZ_h,
+  View_XY_XZ_YZ,
+  View_AB_XY_v, View_AB_XZ_v, View_AB_YZ_v,
+  View_AB_XY_h, View_AB_XZ_h, View_AB_YZ_h,
+  View_AB_XY_XZ_v, View_AB_XY_XZ_h
+};
+
+// Names of configuration files of earlier releases are kept for compatibility
+const SessionName interpolation_mode_names[] = {
+  {"mirtk::Interpolation_NN",      mirtk::Interpolation_NN},
+  {"mirtk::Interpolation_Linear",  mirtk::Interpolation_Linear},
+  {"Interpolation_C1Spline",       mirtk::Interpolation_CSpline},
+  {"mirtk::Interpolation_BSpline", mirtk::Interpolation_BSpline},
+  {"mirtk::Interpolation_Sinc",    mirtk::Interpolation_Sinc},
+  {nullptr, 0}
+};
+
+const SessionName view_mode_names[] = {
+  {"View_A",            View_A},
+  {"View_B",            View_B},
+  {"View_Checkerboard", View_Checkerboard},
+  {"View_Subtraction",  View_Subtraction},
+  {"View_HShutter",     View_HShutter},
+  {"View_VShutter",     View_VShutter},
+  {"View_AoverB",       View_AoverB},
+  {"View_BoverA",       View_BoverA},
+  {nullptr, 0}
+};
+
+const SessionName display_mode_names[] = {
+  {"Neurological", Neurological},
+  {"Radiological", Radiological},
+  {"Native",       Native},
+  {nullptr, 0}
+};
+
+const SessionName cursor_mode_names[] = {
+  {"CrossHair", CrossHair},
+  {"CursorX",   CursorX},
+  {"CursorV",   CursorV},
+  {"CursorBar", CursorBar},
+  {nullptr, 0}
+};
+
+const SessionName color_mode_names[] = {
+  {"ColorMode_HotMetal",            ColorMode_HotMetal},
+  {"ColorMode_Red",                 ColorMode_Red},
+  {"ColorMode_Green",               ColorMode_Green},
+  {"ColorMode_Blue",                ColorMode_Blue},
+  {"ColorMode_Jacobian",            ColorMode_Jacobian},
+  {"ColorMode_JacobianExpansion",   ColorMode_JacobianExpansion},
+  {"ColorMode_JacobianContraction", ColorMode_JacobianContraction},
+  {"ColorMode_Luminance",           ColorMode_Luminance},
+  {"ColorMode_InverseLuminance",    ColorMode_InverseLuminance},
+  {"ColorMode_Rainbow",             ColorMode_Rainbow},
+  {nullptr, 0}
+};
+
+// Value of enumeration with given name, -1 if unknown
+int SessionValue(const SessionName *names, const std::string &name)
+{
+  for (; names->Name != nullptr; names++) {
+    if (name == names->Name) return names->Value;
+  }
+  return -1;
+}
 
-    do {
-        if (in.eof()) return 0;
-        in.getline(buffer1, 255);
-        c = buffer1[0];
-    } while ((strlen(buffer1) == 0) || (c == '#') || (c == 13));
+// Name of enumeration value, nullptr if it cannot be written
+const char *SessionNameOf(const SessionName *names, int value)
+{
+  for (; names->Name != nullptr; names++) {
+    if (value == names->Value) return names->Name;
+  }
+  return nullptr;
+}
 
-    if ((buffer2 = strchr(buffer1, '=')) == nullptr) {
-        cerr << "No valid line format\n";
-        exit(1);
-    }
-    do {
-        buffer2++;
-    } while ((*buffer2 == ' ') || (*buffer2 == '\t'));
+// Parse white space separated numbers, returns false if value is malformed
+bool ParseNumbers(const std::string &value, std::vector<double> &numbers)
+{
+  const char *ptr = value.c_str();
+  char       *end;
+  double      number;
+
+  numbers.clear();
+  while (true) {
+    number = strtod(ptr, &end);
+    if (end == ptr) break;
+    numbers.push_back(number);
+    ptr = end;
+  }
+  while (*ptr == ' ' || *ptr == '\t') ptr++;
+  return *ptr == '\0';
+}
+
+// Parse given number of white space separated numbers
+bool ParseNumbers(const std::string &value, double *numbers, int n)
+{
+  std::vector<double> v;
+
+  if (!ParseNumbers(value, v) || static_cast<int>(v.size()) != n) return false;
+  std::copy(v.begin(), v.end(), numbers);
+  return true;
+}
 
-    return strlen(buffer1);
+// Set color scheme of lookup table
+void SetColorMode(LookupTable *lut, int mode)
+{
+  switch (mode) {
+    case ColorMode_HotMetal:            lut->SetColorModeToHotMetal();            break;
+    case ColorMode_Red:                 lut->SetColorModeToRed();                 break;
+    case ColorMode_Green:               lut->SetColorModeToGreen();               break;
+    case ColorMode_Blue:                lut->SetColorModeToBlue();                break;
+    case ColorMode_Jacobian:            lut->SetColorModeToJacobian();            break;
+    case ColorMode_JacobianExpansion:   lut->SetColorModeToJacobianExpansion();   break;
+    case ColorMode_JacobianContraction: lut->SetColorModeToJacobianContraction(); break;
+    case ColorMode_Luminance:           lut->SetColorModeToLuminance();           break;
+    case ColorMode_InverseLuminance:    lut->SetColorModeToInverseLuminance();    break;
+    case ColorMode_Rainbow:             lut->SetColorModeToRainbow();             break;
+    default: break;
+  }
 }
 
-void RView::Read(char *name)
+// Start line of session file with given key
+std::ostream &SessionKey(std::ostream &to, const char *key)
 {
+  return to << std::left << std::setw(34) << key << "= ";
+}
+
+// Write line with name of enumeration value, skipped if it has no name
+void SessionEnum(std::ostream &to, const char *key, const SessionName *names, int value)
+{
+  const char *name = SessionNameOf(names, value);
+  if (name != nullptr) SessionKey(to, key) << name << "\n";
+}
+
+// Whether file exists and can be read
+bool IsReadable(const std::string &name)
+{
+  std::ifstream file(name.c_str());
+  return file.good();
+}
+
+}
+
+bool RView::Read(char *name)
+{
+  size_t pos;
+  int i, n, line, version, value;
+  double v[3];
   bool ok;
-  mirtk::InterpolationMode interpolation;
-  char buffer1[255], *buffer2 = nullptr;
+  std::string text;
+  std::vector<double> numbers;
+
+  // Lines of session file
+  struct Entry
+  {
+    std::string Key;
+    std::string Value;
+    int         Line;
+  };
+  std::vector<Entry> entries;
+
+  // Boolean display flags
+  struct Flag
+  {
+    const char *Key;
+    bool RView::*Member;
+  };
+  static const Flag flags[] = {
+    {"DisplayTargetContour",        &RView::_DisplayTargetContour},
+    {"DisplaySourceContour",        &RView::_DisplaySourceContour},
+    {"DisplayCursor",               &RView::_DisplayCursor},
+    {"DisplayAxisLabels",           &RView::_DisplayAxisLabels},
+    {"DisplayDeformationGrid",      &RView::_DisplayDeformationGrid},
+    {"DisplayDeformationPoints",    &RView::_DisplayDeformationPoints},
+    {"DisplayDeformationArrows",    &RView::_DisplayDeformationArrows},
+    {"DisplayDeformationTotal",     &RView::_DisplayDeformationTotal},
+    {"DisplayLandmarks",            &RView::_DisplayLandmarks},
+    {"DisplayROI",                  &RView::_DisplayROI},
+    {"DisplaySegmentationLabels",   &RView::_DisplaySegmentationLabels},
+    {"DisplaySegmentationContours", &RView::_DisplaySegmentationContours},
+    {"FlipX",                       &RView::_FlipX},
+    {"FlipY",                       &RView::_FlipY},
+    {"FlipZ",                       &RView::_FlipZ},
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+    {"DisplayObject",               &RView::_DisplayObject},
+    {"DisplayObjectWarp",           &RView::_DisplayObjectWarp},
+    {"DisplayObjectGrid",           &RView::_DisplayObjectGrid},
+    {"ObjectMovie",                 &RView::_ObjectMovie},
+#endif
+    {nullptr, nullptr}
+  };
+
+  // Lookup tables by prefix of their keys
+  LookupTable *luts[3] = {_targetLookupTable, _sourceLookupTable, _subtractionLookupTable};
+  const char *lut_names[3] = {"targetLookupTable_", "sourceLookupTable_", "subtractionLookupTable_"};
 
   // Open file
   std::ifstream from(name);
   if (!from) {
-    cerr << "RView::Read: Can't open file " << name << "\n";
-    exit(1);
+    cerr << "RView::Read: Can't open file " << name << endl;
+    return false;
   }
 
-  // Read parameters
-  while (from.peek() != EOF) {
-
-    ok = false;
-    read_line(from, buffer1, buffer2);
-
-    // Config mode (defines NoOfViewers automatically)
-    if (strstr(buffer1, "configMode") != nullptr) {
-      if (strcmp(buffer2, "View_XY") == 0) {
-        _configMode = _View_XY;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XZ") == 0) {
-        _configMode = _View_XZ;
-        ok = true;
-      } else if (strcmp(buffer2, "View_YZ") == 0) {
-        _configMode = _View_YZ;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XY_XZ_v") == 0) {
-        _configMode = _View_XY_XZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XY_YZ_v") == 0) {
-        _configMode = _View_XY_YZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XZ_YZ_v") == 0) {
-        _configMode = _View_XZ_YZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XY_XZ_h") == 0) {
-        _configMode = _View_XY_XZ_h;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XY_YZ_h") == 0) {
-        _configMode = _View_XY_YZ_h;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XZ_YZ_h") == 0) {
-        _configMode = _View_XZ_YZ_h;
-        ok = true;
-      } else if (strcmp(buffer2, "View_XY_XZ_YZ") == 0) {
-        _configMode = _View_XY_XZ_YZ;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_XY_v") == 0) {
-        _configMode = _View_AB_XY_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_XZ_v") == 0) {
-        _configMode = _View_AB_XZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_YZ_v") == 0) {
-        _configMode = _View_AB_YZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_XY_XZ_v") == 0) {
-        _configMode = _View_AB_XY_XZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_XY_h") == 0) {
-        _configMode = _View_AB_XY_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_XZ_h") == 0) {
-        _configMode = _View_AB_XZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_YZ_h") == 0) {
-        _configMode = _View_AB_YZ_v;
-        ok = true;
-      } else if (strcmp(buffer2, "View_AB_XY_XZ_h") == 0) {
-        _configMode = _View_AB_XY_XZ_v;
-        ok = true;
-      }
-    }
-    // Width of viewer (in pixels)
-    if (strstr(buffer1, "screenX") != nullptr) {
-      _screenY = atoi(buffer2);
-      ok = true;
-    }
-    // Height of viewer (in pixels)
-    if (strstr(buffer1, "screenY") != nullptr) {
-      _screenY = atoi(buffer2);
-      ok = true;
-    }
-    // Display origin (in mm)
-    if (strstr(buffer1, "origin_x") != nullptr) {
-      _origin_x = atof(buffer2);
-      ok = true;
-    }
-    // Display origin (in mm)
-    if (strstr(buffer1, "origin_y") != nullptr) {
-      _origin_y = atof(buffer2);
-      ok = true;
-    }
-    // Display origin (in mm)
-    if (strstr(buffer1, "origin_z") != nullptr) {
-      _origin_z = atof(buffer2);
-      ok = true;
-    }
-    // Display resolution
-    if (strstr(buffer1, "resolution") != nullptr) {
-      _resolution = atof(buffer2);
-      ok = true;
-    }
-
-    interpolation = mirtk::Interpolation_NN;
-
-    // Delete old interpolator
-    delete _targetInterpolator;
-    // Interpolation mode for target image
-    if (strstr(buffer1, "targetInterpolationMode") != nullptr) {
-      if (strcmp(buffer2, "mirtk::Interpolation_NN") == 0) {
-        interpolation = mirtk::Interpolation_NN;
-        ok = true;
-      } else if (strcmp(buffer2, "mirtk::Interpolation_Linear") == 0) {
-        interpolation = mirtk::Interpolation_Linear;
-        ok = true;
-      } else if (strcmp(buffer2, "Interpolation_C1Spline") == 0) {
-        interpolation = mirtk::Interpolation_CSpline;
-        ok = true;
-      } else if (strcmp(buffer2, "mirtk::Interpolation_BSpline") == 0) {
-        interpolation = mirtk::Interpolation_BSpline;
-        ok = true;
-      } else if (strcmp(buffer2, "mirtk::Interpolation_Sinc") == 0) {
-        interpolation = mirtk::Interpolation_Sinc;
-        ok = true;
-      } else {
-        cerr << "RView::Read: Unknown interpolation" << endl;
-        exit(1);
-      }
+  // Split lines into keys and values, skipping comments and empty lines
+  line = 0;
+  while (std::getline(from, text)) {
+    line++;
+    if (!text.empty() && text[text.size()-1] == '\r') text.erase(text.size()-1);
+    pos = text.find_first_not_of(" \t");
+    if (pos == std::string::npos || text[pos] == '#') continue;
+    if ((pos = text.find('=')) == std::string::npos) {
+      cerr << "RView::Read: Ignoring line " << line << " without '=': " << text << endl;
+      continue;
     }
-    // Create new interpolator
-    _targetInterpolator = mirtk::InterpolateImageFunction::New(interpolation, _targetImage);
-
-    // Delete old interpolator
-    delete _sourceInterpolator;
-    // Interpolation mode for source image
-    if (strstr(buffer1, "sourceInterpolationMode") != nullptr) {
-      if (strcmp(buffer2, "mirtk::Interpolation_NN") == 0) {
-        interpolation = mirtk::Interpolation_NN;
-        ok = true;
-      } else if (strcmp(buffer2, "mirtk::Interpolation_Linear") == 0) {
-        interpolation = mirtk::Interpolation_Linear;
-        ok = true;
-      } else if (strcmp(buffer2, "Interpolation_C1Spline") == 0) {
-        interpolation = mirtk::Interpolation_CSpline;
-        ok = true;
-      } else if (strcmp(buffer2, "mirtk::Interpolation_BSpline") == 0) {
-        interpolation = mirtk::Interpolation_BSpline;
-        ok = true;
-      } else if (strcmp(buffer2, "mirtk::Interpolation_Sinc") == 0) {
-        interpolation = mirtk::Interpolation_Sinc;
-        ok = true;
-      } else {
-        cerr << "RView::Read: Unknown interpolation" << endl;
-        exit(1);
+    Entry entry;
+    entry.Key   = text.substr(0, text.find_last_not_of(" \t", pos - 1) + 1);
+    entry.Value = text.substr(pos + 1);
+    entry.Value.erase(0, entry.Value.find_first_not_of(" \t"));
+    entry.Value.erase(entry.Value.find_last_not_of(" \t") + 1);
+    entry.Line  = line;
+    entries.push_back(entry);
+  }
+  from.close();
+
+  // Configuration files of earlier releases have no version
+  version = 1;
+  for (i = 0; i < static_cast<int>(entries.size()); i++) {
+    if (entries[i].Key == "sessionVersion") version = atoi(entries[i].Value.c_str());
+  }
+  if (version < 1 || version > SESSION_VERSION) {
+    cerr << "RView::Read: Unsupported session version " << version << " of " << name << endl;
+    return false;
+  }
+
+  // State which is reset when images are read is restored afterwards
+  std::vector<std::string> target, source, objects;
+  std::string segmentation, transformation;
+  std::vector<double> dofs;
+  std::vector<mirtk::Point> target_landmarks, source_landmarks;
+  double target_range[2] = {0, -1}, source_range[2] = {0, -1};
+  double target_display[2], source_display[2], subtraction_display[2];
+  double origin[3], xaxis[3], yaxis[3], zaxis[3], resolution = 0;
+  int target_frame = -1, source_frame = -1, segments = 0;
+  int interpolation[2] = {-1, -1};
+  bool has_origin = false;
+  int has_axes = 0;
+  bool has_target_display = false, has_source_display = false, has_subtraction_display = false;
+
+  Lock();
+  for (i = 0; i < static_cast<int>(entries.size()); i++) {
+    const std::string &key = entries[i].Key;
+    const std::string &arg = entries[i].Value;
+    ok = true;
+
+    if (key == "sessionVersion") {
+      // Checked above
+    } else if (key == "configMode") {
+      ok = ((value = SessionValue(config_mode_names, arg)) != -1);
+      if (ok) _configMode = static_cast<ConfigViewerMode>(value);
+    } else if (key == "screenX") {
+      _screenX = atoi(arg.c_str());
+    } else if (key == "screenY") {
+      _screenY = atoi(arg.c_str());
+    } else if (key == "DisplayMode") {
+      ok = ((value = SessionValue(display_mode_names, arg)) != -1);
+      if (ok) _DisplayMode = static_cast<DisplayMode>(value);
+    } else if (key == "origin") {
+      ok = has_origin = ParseNumbers(arg, origin, 3);
+    } else if (key == "origin_x" || key == "origin_y" || key == "origin_z") {
+      ok = ParseNumbers(arg, &origin[key[7] - 'x'], 1);
+      has_origin = has_origin || ok;
+    } else if (key == "xaxis") {
+      ok = ParseNumbers(arg, xaxis, 3);
+      if (ok) has_axes |= 1;
+    } else if (key == "yaxis") {
+      ok = ParseNumbers(arg, yaxis, 3);
+      if (ok) has_axes |= 2;
+    } else if (key == "zaxis") {
+      ok = ParseNumbers(arg, zaxis, 3);
+      if (ok) has_axes |= 4;
+    } else if (key == "resolution") {
+      ok = ParseNumbers(arg, &resolution, 1) && resolution > 0;
+    } else if (key == "targetInterpolationMode") {
+      ok = ((interpolation[0] = SessionValue(interpolation_mode_names, arg)) != -1);
+    } else if (key == "sourceInterpolationMode") {
+      ok = ((interpolation[1] = SessionValue(interpolation_mode_names, arg)) != -1);
+    } else if (key == "viewMode") {
+      ok = ((value = SessionValue(view_mode_names, arg)) != -1);
+      if (ok) _viewMode = static_cast<RViewMode>(value);
+    } else if (key == "viewMix") {
+      ok = ParseNumbers(arg, &_viewMix, 1);
+    } else if (key == "CursorMode") {
+      ok = ((value = SessionValue(cursor_mode_names, arg)) != -1);
+      if (ok) _CursorMode = static_cast<CursorMode>(value);
+    } else if (key == "DeformationBlending") {
+      ok = ParseNumbers(arg, &_DeformationBlending, 1);
+    } else if (key == "DisplayDeformationGridResolution") {
+      _DisplayDeformationGridResolution = atoi(arg.c_str());
+    } else if (key == "target") {
+      target.push_back(arg);
+    } else if (key == "targetRange") {
+      ok = ParseNumbers(arg, target_range, 2);
+    } else if (key == "targetFrame") {
+      target_frame = atoi(arg.c_str());
+    } else if (key == "targetDisplay") {
+      ok = has_target_display = ParseNumbers(arg, target_display, 2);
+    } else if (key == "source") {
+      source.push_back(arg);
+    } else if (key == "sourceRange") {
+      ok = ParseNumbers(arg, source_range, 2);
+    } else if (key == "sourceFrame") {
+      source_frame = atoi(arg.c_str());
+    } else if (key == "sourceDisplay") {
+      ok = has_source_display = ParseNumbers(arg, source_display, 2);
+    } else if (key == "subtractionDisplay") {
+      ok = has_subtraction_display = ParseNumbers(arg, subtraction_display, 2);
+    } else if (key == "segmentation") {
+      segmentation = arg;
+    } else if (key == "segment") {
+      // Segment: label red green blue transparency visibility name
+      std::istringstream is(arg);
+      int label, r, g, b, visible;
+      double trans;
+      std::string segment_name;
+      ok = static_cast<bool>(is >> label >> r >> g >> b >> trans >> visible);
+      std::getline(is >> std::ws, segment_name);
+      ok = ok && label >= 0 && label < _segmentTable->Size();
+      if (ok) {
+        if (segments++ == 0) _segmentTable->Clear();
+        _segmentTable->Set(label, const_cast<char *>(segment_name.c_str()), r, g, b, trans, visible);
       }
-    }
-    // Create new interpolator
-    _sourceInterpolator = mirtk::InterpolateImageFunction::New(interpolation, _sourceImage);
-
-    // Flag for rview mode
-    if (strstr(buffer1, "viewMode") != nullptr) {
-      if (strcmp(buffer2, "View_A") == 0) {
-        _viewMode = View_A;
-        ok = true;
-      } else if (strcmp(buffer2, "View_B") == 0) {
-        _viewMode = View_B;
-        ok = true;
-      } else if (strcmp(buffer2, "View_Checkerboard") == 0) {
-        _viewMode = View_Checkerboard;
-        ok = true;
-      } else if (strcmp(buffer2, "View_Subtraction") == 0) {
-        _viewMode = View_Subtraction;
-        ok = true;
-      } else if (strcmp(buffer2, "View_HShutter") == 0) {
-        _viewMode = View_HShutter;
-        ok = true;
-      } else if (strcmp(buffer2, "View_VShutter") == 0) {
-        _viewMode = View_VShutter;
-        ok = true;
+    } else if (key == "transformation") {
+      transformation = arg;
+    } else if (key == "transformationDOFs") {
+      ok = ParseNumbers(arg, dofs);
+    } else if (key == "transformationApply") {
+      _sourceTransformApply = (atoi(arg.c_str()) != 0);
+    } else if (key == "transformationInvert") {
+      _sourceTransformInvert = (atoi(arg.c_str()) != 0);
+    } else if (key == "targetLandmark" || key == "sourceLandmark") {
+      ok = ParseNumbers(arg, v, 3);
+      if (ok) (key[0] == 't' ? target_landmarks : source_landmarks).push_back(mirtk::Point(v[0], v[1], v[2]));
+    } else if (key == "object") {
+      objects.push_back(arg);
+    } else {
+      // Display flags
+      for (n = 0; flags[n].Key != nullptr; n++) {
+        if (key == flags[n].Key) break;
       }
-    }
-
-    // Display viewing mix in shutter viewing mode
-    if (strstr(buffer1, "viewMix") != nullptr) {
-      _viewMix = atof(buffer2);
-      ok = true;
-    }
-    // Flag for display of isolines from target image
-    if (strstr(buffer1, "DisplayTargetContour") != nullptr) {
-      _DisplayTargetContour = atoi(buffer2);
-      ok = true;
-    }
-    // Flag for display of isolines from source image
-    if (strstr(buffer1, "DisplaySourceContour") != nullptr) {
-      _DisplaySourceContour = atoi(buffer2);
-      ok = true;
-    }
-    // Flag for display of cross hair
-    if (strstr(buffer1, "DisplayCursor") != nullptr) {
-      _DisplayCursor = atoi(buffer2);
-      ok = true;
-    }
-    // Cursor mode
-    if (strstr(buffer1, "CursorMode") != nullptr) {
-      if (strcmp(buffer2, "CrossHair") == 0) {
-        _CursorMode = CrossHair;
-        ok = true;
-      } else if (strcmp(buffer2, "CursorX") == 0) {
-        _CursorMode = CursorX;
-        ok = true;
-      } else if (strcmp(buffer2, "CursorV") == 0) {
-        _CursorMode = CursorV;
-        ok = true;
-      } else if (strcmp(buffer2, "CursorBar") == 0) {
-        _CursorMode = CursorBar;
-        ok = true;
+      if (flags[n].Key != nullptr) {
+        this->*flags[n].Member = (atoi(arg.c_str()) != 0);
       } else {
-        ok = false;
+        // Lookup tables, where minimum and maximum display intensities of
+        // earlier releases are given in the range [0, 10000] of the table
+        for (n = 0; n < 3; n++) {
+          if (key.compare(0, strlen(lut_names[n]), lut_names[n]) == 0) break;
+        }
+        if (n < 3 && key == std::string(lut_names[n]) + "mode") {
+          ok = ((value = SessionValue(color_mode_names, arg)) != -1);
+          if (ok) SetColorMode(luts[n], value);
+        } else if (n < 3 && key.compare(strlen(lut_names[n]), 3, "min") == 0) {
+          luts[n]->SetMinDisplayIntensity(atoi(arg.c_str()));
+        } else if (n < 3 && key.compare(strlen(lut_names[n]), 3, "max") == 0) {
+          luts[n]->SetMaxDisplayIntensity(atoi(arg.c_str()));
+        } else {
+          cerr << "RView::Read: Ignoring unknown parameter in line " << entries[i].Line << ": " << key << endl;
+        }
       }
     }
-    // Flag for display of deformation grid
-    if (strstr(buffer1, "DisplayDeformationGrid") != nullptr) {
-      _DisplayDeformationGrid = atoi(buffer2);
-      ok = true;
-    }
-    // Flag for display of deformation points
-    if (strstr(buffer1, "DisplayDeformationPoints") != nullptr) {
-      _DisplayDeformationPoints = atoi(buffer2);
-      ok = true;
-    }
-    // Flag for display of deformation arrows
-    if (strstr(buffer1, "DisplayDeformationArrows") != nullptr) {
-      _DisplayDeformationArrows = atoi(buffer2);
-      ok = true;
-    }
-    // Flag for display of landmarks
-    if (strstr(buffer1, "DisplayLandmarks") != nullptr) {
-      _DisplayLandmarks = atoi(buffer2);
-      ok = true;
-    }
-#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
-    // Flag for display of object
-    if (strstr(buffer1, "DisplayObject") != nullptr) {
-      _DisplayObject = atoi(buffer2);
-      ok = true;
-    }
-    // Flag for warping of object
-    if (strstr(buffer1, "DisplayObjectWarp") != nullptr) {
-      _DisplayObjectWarp = atoi(buffer2);
-      ok = true;
-    }
-    // Flag for display of object grid
-    if (strstr(buffer1, "DisplayObjectGrid") != nullptr) {
-      _DisplayObjectGrid = atoi(buffer2);
-      ok = true;
+    if (!ok) {
+      cerr << "RView::Read: Ignoring invalid value in line " << entries[i].Line << ": " << key << " = " << arg << endl;
     }
-#endif
+  }
 
-    // LookupTables - could be replaced by LookupTable stream
-    // targetLookupTable
-    if (strstr(buffer1, "targetLookupTable_min") != nullptr) {
-      _targetLookupTable->SetMinDisplayIntensity(atoi(buffer2));
-      ok = true;
-    }
-    if (strstr(buffer1, "targetLookupTable_max") != nullptr) {
-      _targetLookupTable->SetMaxDisplayIntensity(atoi(buffer2));
-      ok = true;
-    }
-    if (strstr(buffer1, "targetLookupTable_mode") != nullptr) {
-      if (strcmp(buffer2, "ColorMode_Red") == 0) {
-        _targetLookupTable->SetColorModeToRed();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Green") == 0) {
-        _targetLookupTable->SetColorModeToGreen();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Blue") == 0) {
-        _targetLookupTable->SetColorModeToBlue();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Luminance") == 0) {
-        _targetLookupTable->SetColorModeToLuminance();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Rainbow") == 0) {
-        _targetLookupTable->SetColorModeToRainbow();
-        ok = true;
-      }
+  // Read images, using the intensity ranges of the session such that these
+  // do not have to be computed again
+  std::vector<char *> argv;
+  if (target.size() == 1 && IsReadable(target[0])) {
+    mirtk::Image *image = ReadMappedImage(target[0].c_str());
+    if (image == nullptr) image = mirtk::Image::New(target[0].c_str());
+    this->SetTarget(image, target_range[0], target_range[1]);
+    _targetFileName = target;
+  } else if (target.size() > 1) {
+    for (i = 0; i < static_cast<int>(target.size()); i++) argv.push_back(const_cast<char *>(target[i].c_str()));
+    this->ReadTarget(static_cast<int>(argv.size()), argv.data(), true);
+  } else if (!target.empty()) {
+    cerr << "RView::Read: Can't read target image " << target[0] << endl;
+  }
+  argv.clear();
+  if (source.size() == 1 && IsReadable(source[0])) {
+    mirtk::Image *image = ReadMappedImage(source[0].c_str());
+    if (image == nullptr) image = mirtk::Image::New(source[0].c_str());
+    this->SetSource(image, source_range[0], source_range[1]);
+    _sourceFileName = source;
+  } else if (source.size() > 1) {
+    for (i = 0; i < static_cast<int>(source.size()); i++) argv.push_back(const_cast<char *>(source[i].c_str()));
+    this->ReadSource(static_cast<int>(argv.size()), argv.data(), true);
+  } else if (!source.empty()) {
+    cerr << "RView::Read: Can't read source image " << source[0] << endl;
+  }
+  if (!segmentation.empty()) {
+    if (IsReadable(segmentation)) {
+      this->ReadSegmentation(const_cast<char *>(segmentation.c_str()));
+    } else {
+      cerr << "RView::Read: Can't read segmentation " << segmentation << endl;
     }
-    // sourceLookupTable
-    if (strstr(buffer1, "sourceLookupTable_min") != nullptr) {
-      _sourceLookupTable->SetMinDisplayIntensity(atoi(buffer2));
-      ok = true;
-    }
-    if (strstr(buffer1, "sourceLookupTable_max") != nullptr) {
-      _sourceLookupTable->SetMaxDisplayIntensity(atoi(buffer2));
-      ok = true;
-    }
-    if (strstr(buffer1, "sourceLookupTable_mode") != nullptr) {
-      if (strcmp(buffer2, "ColorMode_Red") == 0) {
-        _sourceLookupTable->SetColorModeToRed();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Green") == 0) {
-        _sourceLookupTable->SetColorModeToGreen();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Blue") == 0) {
-        _sourceLookupTable->SetColorModeToBlue();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Luminance") == 0) {
-        _sourceLookupTable->SetColorModeToLuminance();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Rainbow") == 0) {
-        _sourceLookupTable->SetColorModeToRainbow();
-        ok = true;
-      }
+  }
+
+  // Read transformation and restore its parameters, which may have been
+  // changed since it was read, e.g., by a landmark fit
+  if (!transformation.empty()) {
+    if (IsReadable(transformation)) {
+      this->ReadTransformation(const_cast<char *>(transformation.c_str()));
+    } else {
+      cerr << "RView::Read: Can't read transformation " << transformation << endl;
     }
-    // subtractionLookupTable
-    if (strstr(buffer1, "subtractionLookupTable_min") != nullptr) {
-      _subtractionLookupTable->SetMinDisplayIntensity(atoi(buffer2));
-      ok = true;
-    }
-    if (strstr(buffer1, "subtractionLookupTable_max") != nullptr) {
-      _subtractionLookupTable->SetMaxDisplayIntensity(atoi(buffer2));
-      ok = true;
-    }
-    if (strstr(buffer1, "subtractionLookupTable_mode") != nullptr) {
-      if (strcmp(buffer2, "ColorMode_Red") == 0) {
-        _subtractionLookupTable->SetColorModeToRed();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Green") == 0) {
-        _subtractionLookupTable->SetColorModeToGreen();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Blue") == 0) {
-        _subtractionLookupTable->SetColorModeToBlue();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Luminance") == 0) {
-        _subtractionLookupTable->SetColorModeToLuminance();
-        ok = true;
-      } else if (strcmp(buffer2, "ColorMode_Rainbow") == 0) {
-        _subtractionLookupTable->SetColorModeToRainbow();
-        ok = true;
-      }
+  }
+  if (!dofs.empty()) {
+    if (_sourceTransform != nullptr && _sourceTransform->NumberOfDOFs() == static_cast<int>(dofs.size())) {
+      for (i = 0; i < static_cast<int>(dofs.size()); i++) _sourceTransform->Put(i, dofs[i]);
+      this->SourceTransformModified();
+    } else {
+      cerr << "RView::Read: Number of transformation parameters does not match transformation" << endl;
     }
+  }
 
-    // Check if we parse every line
-#ifdef DEBUG
-    if (!ok) {
-      cerr << "RView::Read() : Ignoring line " << buffer1 << endl;
-    }
-    // Avoid "set but not used" warning
-#else
-    do { ; } while(ok == !ok);
+  // Landmarks and objects of a session replace those loaded before, also if
+  // it has none, whereas configuration files (version 1) keep them unless
+  // they list some
+  if (version >= 2 || !target_landmarks.empty()) {
+    _targetLandmarks.Clear();
+    for (i = 0; i < static_cast<int>(target_landmarks.size()); i++) _targetLandmarks.Add(target_landmarks[i]);
+    _targetLandmarksVersion++;
+    _selectedTargetLandmarks.clear();
+  }
+  if (version >= 2 || !source_landmarks.empty()) {
+    _sourceLandmarks.Clear();
+    for (i = 0; i < static_cast<int>(source_landmarks.size()); i++) _sourceLandmarks.Add(source_landmarks[i]);
+    _sourceLandmarksVersion++;
+    _selectedSourceLandmarks.clear();
+  }
+
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+  // Objects are only read when first displayed
+  if (version >= 2 || !objects.empty()) {
+    this->RemoveObject();
+    for (i = 0; i < static_cast<int>(objects.size()); i++) this->ReadObject(objects[i].c_str());
+  }
 #endif
 
+  // Restore geometry after images were read, which resets it
+  if (has_origin) {
+    _origin_x = origin[0];
+    _origin_y = origin[1];
+    _origin_z = origin[2];
+  }
+  if (has_axes == 7) {
+    for (i = 0; i < 3; i++) {
+      _xaxis[i] = xaxis[i];
+      _yaxis[i] = yaxis[i];
+      _zaxis[i] = zaxis[i];
+    }
   }
+  if (resolution > 0) _resolution = resolution;
 
   // Configure in the end to take all changed parameters into account
-  switch (_configMode) {
-    case _View_XY:
-      this->Configure(View_XY);
-      break;
-    case _View_XZ:
-      this->Configure(View_XZ);
-      break;
-    case _View_YZ:
-      this->Configure(View_YZ);
-      break;
-    case _View_XY_XZ_v:
-      this->Configure(View_XY_XZ_v);
-      break;
-    case _View_XY_YZ_v:
-      this->Configure(View_XY_YZ_v);
-      break;
-    case _View_XZ_YZ_v:
-      this->Configure(View_XZ_YZ_v);
-      break;
-    case _View_XY_XZ_h:
-      this->Configure(View_XY_XZ_h);
-      break;
-    case _View_XY_YZ_h:
-      this->Configure(View_XY_YZ_h);
-      break;
-    case _View_XZ_YZ_h:
-      this->Configure(View_XZ_YZ_h);
-      break;
-    case _View_XY_XZ_YZ:
-      this->Configure(View_XY_XZ_YZ);
-      break;
-    case _View_AB_XY_v:
-      this->Configure(View_AB_XY_v);
-      break;
-    case _View_AB_XZ_v:
-      this->Configure(View_AB_XZ_v);
-      break;
-    case _View_AB_YZ_v:
-      this->Configure(View_AB_YZ_v);
-      break;
-    case _View_AB_XY_XZ_v:
-      this->Configure(View_AB_XY_XZ_v);
-      break;
-    case _View_AB_XY_h:
-      this->Configure(View_AB_XY_h);
-      break;
-    case _View_AB_XZ_h:
-      this->Configure(View_AB_XZ_h);
-      break;
-    case _View_AB_YZ_h:
-      this->Configure(View_AB_YZ_h);
-      break;
-    case _View_AB_XY_XZ_h:
-      this->Configure(View_AB_XY_XZ_h);
-      break;
+  this->Configure(config_modes[_configMode]);
+
+  // Restore state which depends on the images and viewers
+  if (interpolation[0] != -1) this->SetTargetInterpolationMode(static_cast<mirtk::InterpolationMode>(interpolation[0]));
+  if (interpolation[1] != -1) this->SetSourceInterpolationMode(static_cast<mirtk::InterpolationMode>(interpolation[1]));
+  if (has_target_display) {
+    this->SetDisplayMinTarget(target_display[0]);
+    this->SetDisplayMaxTarget(target_display[1]);
+  }
+  if (has_source_display) {
+    this->SetDisplayMinSource(source_display[0]);
+    this->SetDisplayMaxSource(source_display[1]);
+  }
+  if (has_subtraction_display) {
+    this->SetDisplayMinSubtraction(subtraction_display[0]);
+    this->SetDisplayMaxSubtraction(subtraction_display[1]);
   }
+  if (target_frame >= 0 && target_frame < _targetImage->GetT()) this->SetTargetFrame(target_frame);
+  if (source_frame >= 0 && source_frame < _sourceImage->GetT()) this->SetSourceFrame(source_frame);
+  Unlock();
 
-  // Close file
-  from.close();
+  return true;
 }
 
-void RView::Write(char *name)
+bool RView::Write(char *name)
 {
+  int i, j;
+  unsigned char r, g, b;
+  double trans;
+  int visible;
+
   // Open file
   std::ofstream to(name);
   if (!to) {
-    cerr << "RView::Write: Can't open file " << name << "\n";
-    exit(1);
+    cerr << "RView::Write: Can't open file " << name << endl;
+    return false;
   }
 
-  to << "\n#\n# RView configuration\n#\n\n";
-  // Write out configuration mode (contains number of viewers)
-  switch (_configMode) {
-    case _View_XY:
-      to << "configMode                        = View_XY\n";
-      break;
-    case _View_XZ:
-      to << "configMode                        = View_XZ\n";
-      break;
-    case _View_YZ:
-      to << "configMode                        = View_YZ\n";
-      break;
-    case _View_XY_XZ_v:
-      to << "configMode                        = View_XY_XZ_v\n";
-      break;
-    case _View_XY_YZ_v:
-      to << "configMode                        = View_XY_YZ_v\n";
-      break;
-    case _View_XZ_YZ_v:
-      to << "configMode                        = View_XZ_YZ_v\n";
-      break;
-    case _View_XY_XZ_h:
-      to << "configMode                        = View_XY_XZ_h\n";
-      break;
-    case _View_XY_YZ_h:
-      to << "configMode                        = View_XY_YZ_h\n";
-      break;
-    case _View_XZ_YZ_h:
-      to << "configMode                        = View_XZ_YZ_h\n";
-      break;
-    case _View_XY_XZ_YZ:
-      to << "configMode                        = View_XY_XZ_YZ\n";
-      break;
-    case _View_AB_XY_v:
-      to << "configMode                        = View_AB_XY_v\n";
-      break;
-    case _View_AB_XZ_v:
-      to << "configMode                        = View_AB_XZ_v\n";
-      break;
-    case _View_AB_YZ_v:
-      to << "configMode                        = View_AB_YZ_v\n";
-      break;
-    case _View_AB_XY_XZ_v:
-      to << "configMode                        = View_AB_XY_XZ_v\n";
-      break;
-    case _View_AB_XY_h:
-      to << "configMode                        = View_AB_XY_h\n";
-      break;
-    case _View_AB_XZ_h:
-      to << "configMode                        = View_AB_XZ_h\n";
-      break;
-    case _View_AB_YZ_h:
-      to << "configMode                        = View_AB_YZ_h\n";
-      break;
-    case _View_AB_XY_XZ_h:
-      to << "configMode                        = View_AB_XY_XZ_h\n";
-      break;
+  // Numbers are written such that they are read back exactly
+  to.precision(std::numeric_limits<double>::max_digits10);
+
+  Lock();
+  to << "\n#\n# RView session\n#\n\n";
+  SessionKey(to, "sessionVersion") << SESSION_VERSION << "\n";
+
+  // Images, the intensity ranges are restored instead of being recomputed
+  to << "\n#\n# Images\n#\n\n";
+  for (i = 0; i < static_cast<int>(_targetFileName.size()); i++) {
+    SessionKey(to, "target") << _targetFileName[i] << "\n";
   }
-  // Width of viewer  (in pixels)
-  to << "screenX                           = " << _screenX << endl;
-  // Height of viewer (in pixels)
-  to << "screenY                           = " << _screenY << endl;
-  // Display origin (in mm)
-  to << "origin_x                          = " << _origin_x << endl;
-  // Display origin (in mm)
-  to << "origin_y                          = " << _origin_y << endl;
-  // Display origin (in mm)
-  to << "origin_z                          = " << _origin_z << endl;
-  // Display resolution
-  to << "resolution                        = " << _resolution << endl;
-
-  // Interpolation mode for target image
-  switch (this->GetTargetInterpolationMode()) {
-    case mirtk::Interpolation_NN:
-      to << "targetInterpolationMode           = mirtk::Interpolation_NN\n";
-      break;
-    case mirtk::Interpolation_Linear:
-      to << "targetInterpolationMode           = mirtk::Interpolation_Linear\n";
-      break;
-    case mirtk::Interpolation_CSpline:
-      to << "targetInterpolationMode           = Interpolation_C1Spline\n";
-      break;
-    case mirtk::Interpolation_BSpline:
-      to << "targetInterpolationMode           = mirtk::Interpolation_BSpline\n";
-      break;
-    case mirtk::Interpolation_Sinc:
-      to << "targetInterpolationMode           = mirtk::Interpolation_Sinc\n";
-      break;
-    default:
-      break;
+  if (!_targetFileName.empty() && _targetRangeVoxel == -1) {
+    SessionKey(to, "targetRange") << _targetMin << " " << _targetMax << "\n";
   }
-  // Interpolation mode for source image
-  switch (this->GetSourceInterpolationMode()) {
-    case mirtk::Interpolation_NN:
-      to << "sourceInterpolationMode           = mirtk::Interpolation_NN\n";
-      break;
-    case mirtk::Interpolation_Linear:
-      to << "sourceInterpolationMode           = mirtk::Interpolation_Linear\n";
-      break;
-    case mirtk::Interpolation_CSpline:
-      to << "sourceInterpolationMode           = Interpolation_C1Spline\n";
-      break;
-    case mirtk::Interpolation_BSpline:
-      to << "sourceInterpolationMode           = mirtk::Interpolation_BSpline\n";
-      break;
-    case mirtk::Interpolation_Sinc:
-      to << "sourceInterpolationMode           = mirtk::Interpolation_Sinc\n";
-      break;
-    default:
-      break;
+  SessionKey(to, "targetFrame") << _targetFrame << "\n";
+  for (i = 0; i < static_cast<int>(_sourceFileName.size()); i++) {
+    SessionKey(to, "source") << _sourceFileName[i] << "\n";
+  }
+  if (!_sourceFileName.empty() && _sourceRangeVoxel == -1) {
+    SessionKey(to, "sourceRange") << _sourceMin << " " << _sourceMax << "\n";
+  }
+  SessionKey(to, "sourceFrame") << _sourceFrame << "\n";
+  if (!_segmentationFileName.empty()) {
+    SessionKey(to, "segmentation") << _segmentationFileName << "\n";
+  }
+
+  // Transformation, including parameters which may differ from its file
+  if (_sourceTransform != nullptr) {
+    to << "\n#\n# Transformation\n#\n\n";
+    if (!_transformationFileName.empty()) {
+      SessionKey(to, "transformation") << _transformationFileName << "\n";
+    }
+    SessionKey(to, "transformationDOFs");
+    for (i = 0; i < _sourceTransform->NumberOfDOFs(); i++) {
+      to << ((i > 0) ? " " : "") << _sourceTransform->Get(i);
+    }
+    to << "\n";
+    SessionKey(to, "transformationApply") << _sourceTransformApply << "\n";
+    SessionKey(to, "transformationInvert") << _sourceTransformInvert << "\n";
   }
 
+  // Viewer geometry
+  to << "\n#\n# Viewer configuration\n#\n\n";
+  SessionEnum(to, "configMode", config_mode_names, _configMode);
+  SessionKey(to, "screenX") << _screenX << "\n";
+  SessionKey(to, "screenY") << _screenY << "\n";
+  SessionEnum(to, "DisplayMode", display_mode_names, _DisplayMode);
+  SessionKey(to, "origin") << _origin_x << " " << _origin_y << " " << _origin_z << "\n";
+  SessionKey(to, "xaxis") << _xaxis[0] << " " << _xaxis[1] << " " << _xaxis[2] << "\n";
+  SessionKey(to, "yaxis") << _yaxis[0] << " " << _yaxis[1] << " " << _yaxis[2] << "\n";
+  SessionKey(to, "zaxis") << _zaxis[0] << " " << _zaxis[1] << " " << _zaxis[2] << "\n";
+  SessionKey(to, "resolution") << _resolution << "\n";
+  SessionEnum(to, "targetInterpolationMode", interpolation_mode_names, this->GetTargetInterpolationMode());
+  SessionEnum(to, "sourceInterpolationMode", interpolation_mode_names, this->GetSourceInterpolationMode());
+
   // Display configuration
   to << "\n#\n# Display configuration\n#\n\n";
+  SessionEnum(to, "viewMode", view_mode_names, _viewMode);
+  SessionKey(to, "viewMix") << _viewMix << "\n";
+  SessionEnum(to, "CursorMode", cursor_mode_names, _CursorMode);
+  SessionKey(to, "DisplayTargetContour") << _DisplayTargetContour << "\n";
+  SessionKey(to, "DisplaySourceContour") << _DisplaySourceContour << "\n";
+  SessionKey(to, "DisplayCursor") << _DisplayCursor << "\n";
+  SessionKey(to, "DisplayAxisLabels") << _DisplayAxisLabels << "\n";
+  SessionKey(to, "DisplayDeformationGrid") << _DisplayDeformationGrid << "\n";
+  SessionKey(to, "DisplayDeformationGridResolution") << _DisplayDeformationGridResolution << "\n";
+  SessionKey(to, "DisplayDeformationPoints") << _DisplayDeformationPoints << "\n";
+  SessionKey(to, "DisplayDeformationArrows") << _DisplayDeformationArrows << "\n";
+  SessionKey(to, "DisplayDeformationTotal") << _DisplayDeformationTotal << "\n";
+  SessionKey(to, "DeformationBlending") << _DeformationBlending << "\n";
+  SessionKey(to, "DisplayLandmarks") << _DisplayLandmarks << "\n";
+  SessionKey(to, "DisplayROI") << _DisplayROI << "\n";
+  SessionKey(to, "DisplaySegmentationLabels") << _DisplaySegmentationLabels << "\n";
+  SessionKey(to, "DisplaySegmentationContours") << _DisplaySegmentationContours << "\n";
+  SessionKey(to, "FlipX") << _FlipX << "\n";
+  SessionKey(to, "FlipY") << _FlipY << "\n";
+  SessionKey(to, "FlipZ") << _FlipZ << "\n";
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+  SessionKey(to, "DisplayObject") << _DisplayObject << "\n";
+  SessionKey(to, "DisplayObjectWarp") << _DisplayObjectWarp << "\n";
+  SessionKey(to, "DisplayObjectGrid") << _DisplayObjectGrid << "\n";
+  SessionKey(to, "ObjectMovie") << _ObjectMovie << "\n";
+  for (i = 0; i < _Objects.Size(); i++) {
+    SessionKey(to, "object") << _Objects.GetFileName(i) << "\n";
+  }
+#endif
 
-  // Flag for rview mode
-  switch (_viewMode) {
-    case View_A:
-      to << "viewMode                          = View_A\n";
-      break;
-    case View_B:
-      to << "viewMode                          = View_B\n";
-      break;
-    case View_Checkerboard:
-      to << "viewMode                          = View_Checkerboard\n";
-      break;
-    case View_Subtraction:
-      to << "viewMode                          = View_Subtraction\n";
-      break;
-    case View_HShutter:
-      to << "viewMode                          = View_HShutter\n";
-      break;
-    case View_VShutter:
-      to << "viewMode                         = View_VShutter\n";
-      break;
-    default:
-      break;
+  // Lookup tables
+  to << "\n#\n# Lookup tables\n#\n\n";
+  SessionKey(to, "targetDisplay") << _targetDisplayMin << " " << _targetDisplayMax << "\n";
+  SessionEnum(to, "targetLookupTable_mode", color_mode_names, _targetLookupTable->GetColorMode());
+  SessionKey(to, "sourceDisplay") << _sourceDisplayMin << " " << _sourceDisplayMax << "\n";
+  SessionEnum(to, "sourceLookupTable_mode", color_mode_names, _sourceLookupTable->GetColorMode());
+  SessionKey(to, "subtractionDisplay") << _subtractionDisplayMin << " " << _subtractionDisplayMax << "\n";
+  SessionEnum(to, "subtractionLookupTable_mode", color_mode_names, _subtractionLookupTable->GetColorMode());
+
+  // Segment table: label red green blue transparency visibility name
+  to << "\n#\n# Segments\n#\n\n";
+  for (i = 0; i < _segmentTable->Size(); i++) {
+    if (_segmentTable->IsValid(i)) {
+      char *label = _segmentTable->Get(i, &r, &g, &b, &trans, &visible);
+      SessionKey(to, "segment") << i << " " << int(r) << " " << int(g) << " " << int(b)
+                                << " " << trans << " " << visible << " " << label << "\n";
+    }
   }
-  // Display viewing mix in shutter viewing mode
-  to << "viewMix                           = " << _viewMix << endl;
-  // Flag for display of isolines from target image
-  to << "DisplayTargetContour              = " << _DisplayTargetContour << endl;
-  // Flag for display of isolines from source image
-  to << "DisplaySourceContour              = " << _DisplaySourceContour << endl;
-  // Flag for display of cross hair
-  to << "DisplayCursor                     = " << _DisplayCursor << endl;
-  // cursor mode
-  switch (_CursorMode) {
-    case CrossHair:
-      to << "CursorMode                        = CrossHair\n";
-      break;
-    case CursorX:
-      to << "CursorMode                        = CursorX\n";
-      break;
-    case CursorV:
-      to << "CursorMode                        = CursorV\n";
-      break;
-    case CursorBar:
-      to << "CursorMode                        = CursorBar\n";
-      break;
+
+  // Landmarks
+  to << "\n#\n# Landmarks\n#\n\n";
+  for (i = 0; i < _targetLandmarks.Size(); i++) {
+    const mirtk::Point &p = _targetLandmarks(i);
+    SessionKey(to, "targetLandmark") << p._x << " " << p._y << " " << p._z << "\n";
   }
-  // Flag for display of deformation grid
-  to << "DisplayDeformationGrid            = " << _DisplayDeformationGrid
-  << endl;
-  // Flag for display of deformation points
-  to << "DisplayDeformationPoints          = " << _DisplayDeformationPoints
-  << endl;
-  // Flag for display of deformation arrows
-  to << "DisplayDeformationArrows          = " << _DisplayDeformationArrows
-  << endl;
-  // Flag for display of landmarks
-  to << "DisplayLandmarks                  = " << _DisplayLandmarks << endl;
-#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
-  // Flag for display of object
-  to << "DisplayObject                     = " << _DisplayObject << endl;
-  // Flag for warping of object
-  to << "DisplayObjectWarp                 = " << _DisplayObjectWarp << endl;
-  // Flag for display of object grid
-  to << "DisplayObjectGrid                 = " << _DisplayObjectGrid << endl;
-#endif
-  // Lookup tables (could be replaced by LookupTable stream)
-  to << "\n#\n# LookupTables\n#\n\n";
-
-  // targetLookupTable
-  to << "targetLookupTable_minDisplay      = "
-  << _targetLookupTable->GetMinDisplayIntensity() << endl;
-  to << "targetLookupTable_maxDisplay      = "
-  << _targetLookupTable->GetMaxDisplayIntensity() << endl;
-  switch (_targetLookupTable->GetColorMode()) {
-    case ColorMode_Red:
-      to << "targetLookupTable_mode            = ColorMode_Red\n";
-      break;
-    case ColorMode_Green:
-      to << "targetLookupTable_mode            = ColorMode_Green\n";
-      break;
-    case ColorMode_Blue:
-      to << "targetLookupTable_mode            = ColorMode_Blue\n";
-      break;
-    case ColorMode_Luminance:
-      to << "targetLookupTable_mode            = ColorMode_Luminance\n";
-      break;
-    case ColorMode_Rainbow:
-      to << "targetLookupTable_mode            = ColorMode_Rainbow\n";
-      break;
-    default:
-      break;
+  for (j = 0; j < _sourceLandmarks.Size(); j++) {
+    const mirtk::Point &p = _sourceLandmarks(j);
+    SessionKey(to, "sourceLandmark") << p._x << " " << p._y << " " << p._z << "\n";
+  }
+  Unlock();
+
+  // Close file
+  to.close();
+  return !to.fail();
+}
+
+namespace {
+
+// Read frames of an image sequence directly into the 4D image
+struct ReadImageFrames
+{
+  char                  **_FileName;
+  mirtk::Image           *_Sequence;
+  mirtk::ImageAttributes  _Attributes;
+  std::atomic<int>       *_Failed;
+
+  void operator ()(const mirtk::blocked_range<int> &re) const
+  {
+    int i, x, y, z;
+
+    for (i = re.begin(); i != re.end(); i++) {
+      mirtk::Image *frame = mirtk::Image::New(_FileName[i]);
+      mirtk::ImageAttributes attr = frame->GetImageAttributes();
+      attr._torigin = 0;
+      attr._dt      = 1;
+      if (attr != _Attributes) {
+        *_Failed = i;
+      } else if (frame->GetDataType() == _Sequence->GetDataType()) {
+        memcpy(_Sequence->GetScalarPointer(0, 0, 0, i), frame->GetScalarPointer(),
+               frame->NumberOfVoxels() * frame->GetDataTypeSize());
+      } else {
+        for (z = 0; z < frame->GetZ(); z++) {
+          for (y = 0; y < frame->GetY(); y++) {
+            for (x = 0; x < frame->GetX(); x++) {
+              _Sequence->PutAsDouble(x, y, z, i, frame->GetAsDouble(x, y, z));
+            }
+          }
+        }
+      }
+      delete frame;
+    }
+  }
+};
+
+// Read image sequence of given volumes of identical geometry, where only
+// the first m volumes are read and the remaining frames are left blank
+mirtk::Image *ReadImageSequence(int n, char **argv, const char *caller, int m)
+{
+  int i;
+
+  // Read first volume, which determines type and geometry
+  cout << "Reading " << argv[0] << endl;
+  mirtk::Image *first = mirtk::Image::New(argv[0]);
+  mirtk::ImageAttributes refattr = first->GetImageAttributes();
+  refattr._torigin = 0;
+  refattr._dt      = 1;
+
+  // Allocate image sequence of same type
+  mirtk::ImageAttributes attr = first->GetImageAttributes();
+  attr._t = n;
+  attr._dt = 1;
+  mirtk::Image *image = mirtk::Image::New(first->GetDataType());
+  if (image == nullptr) {
+    cerr << caller << ": Cannot convert image to desired type" << endl;
+    exit(1);
   }
-  // sourceLookupTable
-  to << "sourceLookupTable_minDisplay      = "
-  << _sourceLookupTable->GetMinDisplayIntensity() << endl;
-  to << "sourceLookupTable_maxDisplay      = "
-  << _sourceLookupTable->GetMaxDisplayIntensity() << endl;
-  switch (_sourceLookupTable->GetColorMode()) {
-    case ColorMode_Red:
-      to << "sourceLookupTable_mode            = ColorMode_Red\n";
-      break;
-    case ColorMode_Green:
-      to << "sourceLookupTable_mode            = ColorMode_Green\n";
-      break;
-    case ColorMode_Blue:
-      to << "sourceLookupTable_mode            = ColorMode_Blue\n";
-      break;
-    case ColorMode_Luminance:
-      to << "sourceLookupTable_mode            = ColorMode_Luminance\n";
-      break;
-    case ColorMode_Rainbow:
-      to << "sourceLookupTable_mode            = ColorMode_Rainbow\n";
-      break;
-    default:
-      break;
+  image->Initialize(attr);
+  memcpy(image->GetScalarPointer(), first->GetScalarPointer(),
+         first->NumberOfVoxels() * first->GetDataTypeSize());
+  delete first;
+
+  // Read remaining volumes in parallel, keeping only one temporary
+  // volume per thread in memory at a time
+  for (i = 1; i < m; i++) {
+    cout << "Reading " << argv[i] << endl;
   }
-  // subtractionLookupTable
-  to << "subtractionLookupTable_minDisplay = "
-  << _subtractionLookupTable->GetMinDisplayIntensity() << endl;
-  to << "subtractionLookupTable_maxDisplay = "
-  << _subtractionLookupTable->GetMaxDisplayIntensity() << endl;
-  switch (_subtractionLookupTable->GetColorMode()) {
-    case ColorMode_Red:
-      to << "subtractionLookupTable_mode       = ColorMode_Red\n";
-      break;
-    case ColorMode_Green:
-      to << "subtractionLookupTable_mode       = ColorMode_Green\n";
-      break;
-    case ColorMode_Blue:
-      to << "subtractionLookupTable_mode       = ColorMode_Blue\n";
-      break;
-    case ColorMode_Luminance:
-      to << "subtractionLookupTable_mode       = ColorMode_Luminance\n";
-      break;
-    case ColorMode_Rainbow:
-      to << "subtractionLookupTable_mode       = ColorMode_Rainbow\n";
-      break;
-    default:
-      break;
+  std::atomic<int> failed(0);
+  ReadImageFrames body;
+  body._FileName   = argv;
+  body._Sequence   = image;
+  body._Attributes = refattr;
+  body._Failed     = &failed;
+  mirtk::parallel_for(mirtk::blocked_range<int>(1, m), body);
+  if (failed != 0) {
+    cerr << "Mismatch of image geometry in sequence: " << argv[failed] << endl;
+    exit(1);
   }
 
-  // Close file
-  to.close();
+  return image;
+}
+
 }
 
 void RView::ReadTarget(char *name)
 {
+  // Stop reading frames of previous image
+  _targetLoader.Stop();
+
   // Read target image
-  if (_targetImage != nullptr) delete _targetImage;
-  _targetImage = mirtk::Image::New(name);
+  mirtk::Image *image = ReadMappedImage(name);
+  if (image == nullptr) image = mirtk::Image::New(name);
+  this->SetTarget(image);
+  _targetFileName.push_back(name);
+}
+
+void RView::SetTarget(mirtk::Image *image, double min, double max)
+{
+  // Stop reading frames of previous image
+  _targetLoader.Stop();
+  this->StopIntensityRange();
+  _sliceCache.Clear();
+
+  // Replace target image
+  LockResources();
+  // Stop downsampling the previous image in the background
+  _targetPyramid.Clear();
+  if (_targetImage != nullptr && _targetImage != image) delete _targetImage;
+  _targetImage = image;
+  _targetFileName.clear();
   if (!_targetImage->GetTSize()) _targetImage->PutTSize(1.0);
 
-  // Find min and max values and initialize lookup table
-  _targetImage->GetMinMaxAsDouble(&_targetMin, &_targetMax);
+  // Downsampled images are computed on demand
+  _targetPyramid.Initialize(_targetImage, IsLabelImage(_targetImage, this->GetTargetInterpolationMode()));
+  UnlockResources();
+
+  // Find min and max values and initialize lookup table. For memory-mapped
+  // images, estimate these from a sample and refine them later on such that
+  // only the displayed slices have to be read from disk initially. A given
+  // range, e.g., of a session file, is used as is and statistics are
+  // computed only when needed (cf. GetTargetStatistics).
+  if (min <= max) {
+    _targetMin = min;
+    _targetMax = max;
+    _targetRangeVoxel = -1;
+    _targetStatistics.Invalidate();
+  } else if (IsMappedImage(_targetImage)) {
+    EstimateMinMaxAsDouble(_targetImage, &_targetMin, &_targetMax);
+    _targetRangeMin   = _targetMin;
+    _targetRangeMax   = _targetMax;
+    _targetRangeVoxel = 0;
+    _targetStatistics.Invalidate();
+  } else {
+    _targetStatistics.Compute(_targetImage);
+    _targetMin = _targetStatistics.Min();
+    _targetMax = _targetStatistics.Max();
+    _targetRangeVoxel = -1;
+  }
   _targetLookupTable->Initialize(0, 10000);
-  _targetDisplayMin = _targetMin;
-  _targetDisplayMax = _targetMax;
+  this->InitializeDisplayRange(_targetStatistics, _targetMin, _targetMax, _targetDisplayMin, _targetDisplayMax);
   _RegionGrowingThresholdMin = _targetMin;
   _RegionGrowingThresholdMax = _targetMax;
 
@@ -1664,85 +2205,44 @@ void RView::ReadTarget(char *name)
   this->Reset();
 }
 
-void RView::ReadTarget(int argc, char **argv)
+void RView::ReadTarget(int argc, char **argv, bool async)
 {
-  mirtk::Image **nimages;
-  int i, n, x, y, z;
+  // Stop reading frames of previous image
+  _targetLoader.Stop();
+  this->StopIntensityRange();
+  _sliceCache.Clear();
 
-  // Determine how many volumes we have
-  n = argc;
-
-  // Allocate memory
-  nimages = new mirtk::Image *[n];
-
-  // Read images
-  cout << "Reading " << argv[0] << endl;
-  nimages[0] = mirtk::Image::New(argv[0]);
-
-  mirtk::ImageAttributes refattr = nimages[0]->GetImageAttributes();
-  refattr._torigin = 0;
-  refattr._dt      = 1;
-  for (i = 1; i < n; i++) {
-    cout << "Reading " << argv[i] << endl;
-    nimages[i] = mirtk::Image::New(argv[i]);
-    mirtk::ImageAttributes attr = nimages[i]->GetImageAttributes();
-    attr._torigin = 0;
-    attr._dt      = 1;
-    if (attr != refattr) {
-      cerr << "Mismatch of image geometry in sequence" << endl;
-      nimages[0]->Print();
-      nimages[i]->Print();
-      exit(1);
-    }
-  }
+  // Read image sequence, or only its first frame when the
+  // remaining frames are read in the background
+  mirtk::Image *image = ReadImageSequence(argc, argv, "RView::ReadTarget", async ? 1 : argc);
 
   // Delete old image
+  LockResources();
+  // Stop downsampling the previous image in the background
+  _targetPyramid.Clear();
   if (_targetImage != nullptr)
     delete _targetImage;
+  _targetImage = image;
+  _targetFileName.assign(argv, argv + argc);
 
-  // Initialize image attributes
-  mirtk::ImageAttributes attr = nimages[0]->GetImageAttributes();
-  attr._t = n;
-  attr._dt = 1;
+  // Downsampled images are computed on demand
+  _targetPyramid.Initialize(_targetImage, IsLabelImage(_targetImage, this->GetTargetInterpolationMode()));
+  UnlockResources();
 
-  // Allocate new image
-  if (dynamic_cast<mirtk::GenericImage<char> *> (nimages[0]) != nullptr) {
-    _targetImage = new mirtk::GenericImage<char> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<unsigned char> *> (nimages[0])
-             != nullptr) {
-    _targetImage = new mirtk::GenericImage<unsigned char> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<short> *> (nimages[0]) != nullptr) {
-    _targetImage = new mirtk::GenericImage<short> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<unsigned short> *> (nimages[0])
-             != nullptr) {
-    _targetImage = new mirtk::GenericImage<unsigned short> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<float> *> (nimages[0]) != nullptr) {
-    _targetImage = new mirtk::GenericImage<float> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<double> *> (nimages[0]) != nullptr) {
-    _targetImage = new mirtk::GenericImage<double> (attr);
+  // Find min and max values and initialize lookup table
+  if (async) {
+    _targetMin = _targetMax = _targetImage->GetAsDouble(0);
+    RefineMinMaxAsDouble(_targetImage, &_targetMin, &_targetMax, 0,
+                         _targetImage->GetX() * _targetImage->GetY() * _targetImage->GetZ());
+    _targetStatistics.Invalidate();
   } else {
-    cerr << "RView::ReadTarget: Cannot convert image to desired type"
-    << endl;
-    exit(1);
-  }
-
-  for (i = 0; i < _targetImage->GetT(); i++) {
-    for (z = 0; z < _targetImage->GetZ(); z++) {
-      for (y = 0; y < _targetImage->GetY(); y++) {
-        for (x = 0; x < _targetImage->GetX(); x++) {
-          _targetImage->PutAsDouble(x, y, z, i,
-                                    nimages[i]->GetAsDouble(x, y, z));
-        }
-      }
-    }
+    _targetStatistics.Compute(_targetImage);
+    _targetMin = _targetStatistics.Min();
+    _targetMax = _targetStatistics.Max();
   }
-  delete[] nimages;
-
-  // Find min and max values and initialize lookup table
-  _targetImage->GetMinMaxAsDouble(&_targetMin, &_targetMax);
+  _targetRangeVoxel = -1;
   _targetLookupTable->Initialize(0, 10000);
-  _targetDisplayMin = _targetMin;
-  _targetDisplayMax = _targetMax;
+  this->InitializeDisplayRange(_targetStatistics, _targetMin, _targetMax, _targetDisplayMin, _targetDisplayMax);
   _RegionGrowingThresholdMin = _targetMin;
   _RegionGrowingThresholdMax = _targetMax;
 
@@ -1769,20 +2269,63 @@ void RView::ReadTarget(int argc, char **argv)
 
   // Reslice
   this->Reset();
+
+  // Read remaining frames in the background
+  if (async) _targetLoader.Start(_targetImage, argc, argv);
 }
 
 void RView::ReadSource(char *name)
 {
+  // Stop reading frames of previous image
+  _sourceLoader.Stop();
+
   // Read source image
-  if (_sourceImage != nullptr) delete _sourceImage;
-  _sourceImage = mirtk::Image::New(name);
+  mirtk::Image *image = ReadMappedImage(name);
+  if (image == nullptr) image = mirtk::Image::New(name);
+  this->SetSource(image);
+  _sourceFileName.push_back(name);
+}
+
+void RView::SetSource(mirtk::Image *image, double min, double max)
+{
+  // Stop reading frames of previous image
+  _sourceLoader.Stop();
+  this->StopIntensityRange();
+  _sliceCache.Clear();
+
+  // Replace source image
+  LockResources();
+  // Stop downsampling the previous image in the background
+  _sourcePyramid.Clear();
+  if (_sourceImage != nullptr && _sourceImage != image) delete _sourceImage;
+  _sourceImage = image;
+  _sourceFileName.clear();
   if (!_sourceImage->GetTSize()) _sourceImage->PutTSize(1.0);
 
-  // Find min and max values and initialize lookup table
-  _sourceImage->GetMinMaxAsDouble(&_sourceMin, &_sourceMax);
+  // Downsampled images are computed on demand
+  _sourcePyramid.Initialize(_sourceImage, IsLabelImage(_sourceImage, this->GetSourceInterpolationMode()));
+  UnlockResources();
+
+  // Find min and max values and initialize lookup table (cf. SetTarget)
+  if (min <= max) {
+    _sourceMin = min;
+    _sourceMax = max;
+    _sourceRangeVoxel = -1;
+    _sourceStatistics.Invalidate();
+  } else if (IsMappedImage(_sourceImage)) {
+    EstimateMinMaxAsDouble(_sourceImage, &_sourceMin, &_sourceMax);
+    _sourceRangeMin   = _sourceMin;
+    _sourceRangeMax   = _sourceMax;
+    _sourceRangeVoxel = 0;
+    _sourceStatistics.Invalidate();
+  } else {
+    _sourceStatistics.Compute(_sourceImage);
+    _sourceMin = _sourceStatistics.Min();
+    _sourceMax = _sourceStatistics.Max();
+    _sourceRangeVoxel = -1;
+  }
   _sourceLookupTable->Initialize(0, 10000);
-  _sourceDisplayMin = _sourceMin;
-  _sourceDisplayMax = _sourceMax;
+  this->InitializeDisplayRange(_sourceStatistics, _sourceMin, _sourceMax, _sourceDisplayMin, _sourceDisplayMax);
 
   // Initialize lookup table for subtraction
   _subtractionMin = _targetMin - _sourceMax;
@@ -1799,82 +2342,44 @@ void RView::ReadSource(char *name)
   this->Initialize();
 }
 
-void RView::ReadSource(int argc, char **argv)
+void RView::ReadSource(int argc, char **argv, bool async)
 {
-  mirtk::Image **nimages;
-  int i, n, x, y, z;
-
-  // Determine how many volumes we have
-  n = argc;
-
-  // Allocate memory
-  nimages = new mirtk::Image *[n];
-
-  cout << "Reading " << argv[0] << endl;
-  nimages[0] = mirtk::Image::New(argv[0]);
-  mirtk::ImageAttributes refattr = nimages[0]->GetImageAttributes();
-  refattr._torigin = 0;
-  refattr._dt      = 1;
+  // Stop reading frames of previous image
+  _sourceLoader.Stop();
+  this->StopIntensityRange();
+  _sliceCache.Clear();
 
-  for (i = 1; i < n; i++) {
-    cout << "Reading " << argv[i] << endl;
-    nimages[i] = mirtk::Image::New(argv[i]);
-    mirtk::ImageAttributes attr = nimages[i]->GetImageAttributes();
-    attr._torigin = 0;
-    attr._dt      = 1;
-    if (attr != refattr) {
-      cerr << "Mismatch of image geometry in sequence" << endl;
-      exit(1);
-    }
-  }
+  // Read image sequence, or only its first frame when the
+  // remaining frames are read in the background
+  mirtk::Image *image = ReadImageSequence(argc, argv, "RView::ReadSource", async ? 1 : argc);
 
   // Delete old image
+  LockResources();
+  // Stop downsampling the previous image in the background
+  _sourcePyramid.Clear();
   if (_sourceImage != nullptr)
     delete _sourceImage;
+  _sourceImage = image;
+  _sourceFileName.assign(argv, argv + argc);
 
-  // Initialize image attributes
-  mirtk::ImageAttributes attr = nimages[0]->GetImageAttributes();
-  attr._t = n;
-  attr._dt = 1;
+  // Downsampled images are computed on demand
+  _sourcePyramid.Initialize(_sourceImage, IsLabelImage(_sourceImage, this->GetSourceInterpolationMode()));
+  UnlockResources();
 
-  // Allocate new image
-  if (dynamic_cast<mirtk::GenericImage<char> *> (nimages[0]) != nullptr) {
-    _sourceImage = new mirtk::GenericImage<char> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<unsigned char> *> (nimages[0])
-             != nullptr) {
-    _sourceImage = new mirtk::GenericImage<unsigned char> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<short> *> (nimages[0]) != nullptr) {
-    _sourceImage = new mirtk::GenericImage<short> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<unsigned short> *> (nimages[0])
-             != nullptr) {
-    _sourceImage = new mirtk::GenericImage<unsigned short> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<float> *> (nimages[0]) != nullptr) {
-    _sourceImage = new mirtk::GenericImage<float> (attr);
-  } else if (dynamic_cast<mirtk::GenericImage<double> *> (nimages[0]) != nullptr) {
-    _sourceImage = new mirtk::GenericImage<double> (attr);
+  // Find min and max values and initialize lookup table
+  if (async) {
+    _sourceMin = _sourceMax = _sourceImage->GetAsDouble(0);
+    RefineMinMaxAsDouble(_sourceImage, &_sourceMin, &_sourceMax, 0,
+                         _sourceImage->GetX() * _sourceImage->GetY() * _sourceImage->GetZ());
+    _sourceStatistics.Invalidate();
   } else {
-    cerr << "RView::ReadSource: Cannot convert image to desired type"
-    << endl;
-    exit(1);
-  }
-
-  for (i = 0; i < _sourceImage->GetT(); i++) {
-    for (z = 0; z < _sourceImage->GetZ(); z++) {
-      for (y = 0; y < _sourceImage->GetY(); y++) {
-        for (x = 0; x < _sourceImage->GetX(); x++) {
-          _sourceImage->PutAsDouble(x, y, z, i,
-                                    nimages[i]->GetAsDouble(x, y, z));
-        }
-      }
-    }
+    _sourceStatistics.Compute(_sourceImage);
+    _sourceMin = _sourceStatistics.Min();
+    _sourceMax = _sourceStatistics.Max();
   }
-  delete[] nimages;
-
-  // Find min and max values and initialize lookup table
-  _sourceImage->GetMinMaxAsDouble(&_sourceMin, &_sourceMax);
+  _sourceRangeVoxel = -1;
   _sourceLookupTable->Initialize(0, 10000);
-  _sourceDisplayMin = _sourceMin;
-  _sourceDisplayMax = _sourceMax;
+  this->InitializeDisplayRange(_sourceStatistics, _sourceMin, _sourceMax, _sourceDisplayMin, _sourceDisplayMax);
 
   // Initialize lookup table for subtraction
   _subtractionMin = _targetMin - _sourceMax;
@@ -1889,12 +2394,243 @@ void RView::ReadSource(int argc, char **argv)
 
   // Initialize
   this->Initialize();
+
+  // Read remaining frames in the background
+  if (async) _sourceLoader.Start(_sourceImage, argc, argv);
+}
+
+void RView::SetTargetRange(double min, double max)
+{
+  bool full_range;
+
+  // Keep user defined display range, but extend default one
+  full_range = (_targetDisplayMin == _targetMin && _targetDisplayMax == _targetMax);
+  if (_RegionGrowingThresholdMin == int(_targetMin)) _RegionGrowingThresholdMin = min;
+  if (_RegionGrowingThresholdMax == int(_targetMax)) _RegionGrowingThresholdMax = max;
+  _targetMin = min;
+  _targetMax = max;
+  if (full_range) {
+    _targetDisplayMin = min;
+    _targetDisplayMax = max;
+  }
+  this->SetDisplayMinTarget(_targetDisplayMin);
+  this->SetDisplayMaxTarget(_targetDisplayMax);
+
+  // Update subtraction range
+  _subtractionMin = _targetMin - _sourceMax;
+  _subtractionMax = _targetMax - _sourceMin;
+
+  // Update intensity rescaling of transformation filters
+  this->Initialize(false);
+}
+
+void RView::SetSourceRange(double min, double max)
+{
+  bool full_range;
+
+  // Keep user defined display range, but extend default one
+  full_range = (_sourceDisplayMin == _sourceMin && _sourceDisplayMax == _sourceMax);
+  _sourceMin = min;
+  _sourceMax = max;
+  if (full_range) {
+    _sourceDisplayMin = min;
+    _sourceDisplayMax = max;
+  }
+  this->SetDisplayMinSource(_sourceDisplayMin);
+  this->SetDisplayMaxSource(_sourceDisplayMax);
+
+  // Update subtraction range
+  _subtractionMin = _targetMin - _sourceMax;
+  _subtractionMax = _targetMax - _sourceMin;
+
+  // Update intensity rescaling of transformation filters
+  this->Initialize(false);
+}
+
+void RView::InitializeDisplayRange(const ImageStatistics &stats, double min, double max,
+                                   double &display_min, double &display_max)
+{
+  // Default display window excludes single outliers
+  if (stats.IsValid()) {
+    display_min = stats.Percentile(DISPLAY_PERCENTILE_MIN);
+    display_max = stats.Percentile(DISPLAY_PERCENTILE_MAX);
+    if (display_max > display_min) return;
+  }
+  display_min = min;
+  display_max = max;
+}
+
+const ImageStatistics &RView::GetTargetStatistics()
+{
+  if (!_targetStatistics.IsValid() && !_targetLoader.IsLoading()) {
+    _targetStatistics.Compute(_targetImage);
+  }
+  return _targetStatistics;
+}
+
+const ImageStatistics &RView::GetSourceStatistics()
+{
+  if (!_sourceStatistics.IsValid() && !_sourceLoader.IsLoading()) {
+    _sourceStatistics.Compute(_sourceImage);
+  }
+  return _sourceStatistics;
+}
+
+bool RView::RefineIntensityRange(long n)
+{
+  if (_targetRangeVoxel >= 0) {
+    _targetRangeVoxel = RefineMinMaxAsDouble(_targetImage, &_targetRangeMin, &_targetRangeMax, _targetRangeVoxel, n);
+    if (_targetRangeVoxel < 0 && (_targetRangeMin != _targetMin || _targetRangeMax != _targetMax)) {
+      this->SetTargetRange(_targetRangeMin, _targetRangeMax);
+    }
+    return true;
+  }
+  if (_sourceRangeVoxel >= 0) {
+    _sourceRangeVoxel = RefineMinMaxAsDouble(_sourceImage, &_sourceRangeMin, &_sourceRangeMax, _sourceRangeVoxel, n);
+    if (_sourceRangeVoxel < 0 && (_sourceRangeMin != _sourceMin || _sourceRangeMax != _sourceMax)) {
+      this->SetSourceRange(_sourceRangeMin, _sourceRangeMax);
+    }
+    return true;
+  }
+  return false;
+}
+
+bool RView::RefineIntensityRangeAsync()
+{
+  long target_voxel, source_voxel;
+  const mirtk::Image *target, *source;
+
+  // Apply ranges once all voxels were processed
+  if (_rangeThread.joinable()) {
+    if (!_rangeDone) return true;
+    _rangeThread.join();
+    if (_targetRangeVoxel >= 0) {
+      _targetRangeMin   = _rangeResult[0];
+      _targetRangeMax   = _rangeResult[1];
+      _targetRangeVoxel = -1;
+      if (_targetRangeMin != _targetMin || _targetRangeMax != _targetMax) {
+        this->SetTargetRange(_targetRangeMin, _targetRangeMax);
+      }
+    }
+    if (_sourceRangeVoxel >= 0) {
+      _sourceRangeMin   = _rangeResult[2];
+      _sourceRangeMax   = _rangeResult[3];
+      _sourceRangeVoxel = -1;
+      if (_sourceRangeMin != _sourceMin || _sourceRangeMax != _sourceMax) {
+        this->SetSourceRange(_sourceRangeMin, _sourceRangeMax);
+      }
+    }
+    return false;
+  }
+  if (_targetRangeVoxel < 0 && _sourceRangeVoxel < 0) return false;
+
+  // Read voxels in the background, the images are only replaced after
+  // the thread was stopped (cf. StopIntensityRange)
+  target         = _targetImage;
+  source         = _sourceImage;
+  target_voxel   = _targetRangeVoxel;
+  source_voxel   = _sourceRangeVoxel;
+  _rangeResult[0] = _targetRangeMin;
+  _rangeResult[1] = _targetRangeMax;
+  _rangeResult[2] = _sourceRangeMin;
+  _rangeResult[3] = _sourceRangeMax;
+  _rangeStop     = false;
+  _rangeDone     = false;
+  _rangeThread   = std::thread([this, target, source, target_voxel, source_voxel] {
+    long t = target_voxel, s = source_voxel;
+    while (t >= 0 && !_rangeStop) t = RefineMinMaxAsDouble(target, &_rangeResult[0], &_rangeResult[1], t, 16777216);
+    while (s >= 0 && !_rangeStop) s = RefineMinMaxAsDouble(source, &_rangeResult[2], &_rangeResult[3], s, 16777216);
+    _rangeDone = true;
+  });
+  return true;
+}
+
+void RView::StopIntensityRange()
+{
+  // Voxels processed so far are discarded, the next call of
+  // RefineIntensityRangeAsync starts over for images which were kept
+  if (_rangeThread.joinable()) {
+    _rangeStop = true;
+    _rangeThread.join();
+  }
+}
+
+bool RView::UpdatePyramids(bool wait)
+{
+  bool update = false;
+
+  if (_targetPyramidLevel > 0) {
+    if (wait) _targetPyramid.Wait(_targetPyramidLevel);
+    if (_targetPyramid.IsReady(_targetPyramidLevel)) {
+      _targetPyramidLevel = 0;
+      _targetUpdate = true;
+      update = true;
+    }
+  }
+  if (_sourcePyramidLevel > 0) {
+    if (wait) _sourcePyramid.Wait(_sourcePyramidLevel);
+    if (_sourcePyramid.IsReady(_sourcePyramidLevel)) {
+      _sourcePyramidLevel = 0;
+      _sourceUpdate = true;
+      update = true;
+    }
+  }
+  return update;
+}
+
+bool RView::LoadFrames()
+{
+  bool full_range;
+  int failed;
+
+  if (_targetLoader.IsLoading() && _targetLoader.IsDone()) {
+    failed = _targetLoader.Finish();
+    if (failed != 0) {
+      cerr << "Mismatch of image geometry in sequence: " << _targetLoader.FileName(failed) << endl;
+      exit(1);
+    }
+    LockResources();
+    _targetPyramid.Initialize(_targetImage, IsLabelImage(_targetImage, this->GetTargetInterpolationMode()));
+    UnlockResources();
+    _targetStatistics.Compute(_targetImage);
+    full_range = (_targetDisplayMin == _targetMin && _targetDisplayMax == _targetMax);
+    this->SetTargetRange(_targetStatistics.Min(), _targetStatistics.Max());
+    if (full_range) {
+      // Replace default display window of first frame by that of all frames
+      this->InitializeDisplayRange(_targetStatistics, _targetMin, _targetMax, _targetDisplayMin, _targetDisplayMax);
+      this->SetDisplayMinTarget(_targetDisplayMin);
+      this->SetDisplayMaxTarget(_targetDisplayMax);
+    }
+    _targetUpdate = true;
+  }
+  if (_sourceLoader.IsLoading() && _sourceLoader.IsDone()) {
+    failed = _sourceLoader.Finish();
+    if (failed != 0) {
+      cerr << "Mismatch of image geometry in sequence: " << _sourceLoader.FileName(failed) << endl;
+      exit(1);
+    }
+    LockResources();
+    _sourcePyramid.Initialize(_sourceImage, IsLabelImage(_sourceImage, this->GetSourceInterpolationMode()));
+    UnlockResources();
+    _sourceStatistics.Compute(_sourceImage);
+    full_range = (_sourceDisplayMin == _sourceMin && _sourceDisplayMax == _sourceMax);
+    this->SetSourceRange(_sourceStatistics.Min(), _sourceStatistics.Max());
+    if (full_range) {
+      // Replace default display window of first frame by that of all frames
+      this->InitializeDisplayRange(_sourceStatistics, _sourceMin, _sourceMax, _sourceDisplayMin, _sourceDisplayMax);
+      this->SetDisplayMinSource(_sourceDisplayMin);
+      this->SetDisplayMaxSource(_sourceDisplayMax);
+    }
+    _sourceUpdate = true;
+  }
+  return _targetLoader.IsLoading() || _sourceLoader.IsLoading();
 }
 
 void RView::ReadSegmentation(char *name)
 {
-  // Read target image
+  // Read segmentation image
   _segmentationImage->Read(name);
+  _segmentationFileName = name;
 
   // Find bounding box
   _x1 = 0;
@@ -1908,6 +2644,7 @@ void RView::ReadSegmentation(char *name)
 
   // Update of target is required
   _segmentationUpdate = true;
+  _segmentationVersion++;
 }
 
 void RView::WriteTarget(char *name)
@@ -1927,7 +2664,9 @@ void RView::WriteSource(char *name)
       transformFilter.Transformation(_sourceTransform);
       transformFilter.Output(&transformedSource);
       transformFilter.Interpolator(_sourceInterpolator);
+      LockResources();
       transformFilter.Run();
+      UnlockResources();
       // Write transformed source image
       transformedSource.Write(name);
     } else {
@@ -1942,48 +2681,55 @@ void RView::WriteSegmentation(char *name)
 }
 
 void RView::ReadTransformation(char *name)
+{
+  // Swap in the new transformation, keeping the transformation filters,
+  // output images and displacement cache of the current one
+  this->SwapTransformation(TransformationSequence::Read(name));
+  _transformationFileName = name;
+}
+
+void RView::SwapTransformation(mirtk::Transformation *transform)
 {
   int i;
+  mirtk::ImageAttributes attr;
 
-  // Delete the old transformation
-  if (_sourceTransform) delete _sourceTransform;
+  if (transform == NULL || transform == _sourceTransform) return;
 
-  // Allocate and read the new transformation
-  _sourceTransform = mirtk::Transformation::New(name);
+  LockResources();
 
-  // If transformation is rigid convert it to affine
-  if (strcmp(_sourceTransform->NameOfClass(), "mirtk::RigidTransformation") == 0) {
-    mirtk::AffineTransformation *tmpTransform = new mirtk::AffineTransformation;
-    for (i = 0; i < _sourceTransform->NumberOfDOFs(); i++) {
-      tmpTransform->Put(i, _sourceTransform->Get(i));
-    }
-    delete _sourceTransform;
-    _sourceTransform = tmpTransform;
-  }
-  _sourceUpdate = true;
+  // Replace the old transformation
+  delete _sourceTransform;
+  _sourceTransform = transform;
+  _sourceTransformVersion++;
+  _transformationFileName.clear();
 
-  // Set up the filters
+  // Re-target the existing filters
   for (i = 0; i < _NoOfViewers; i++) {
-    // Delete the old transformation filter
-    delete _sourceTransformFilter[i];
-
-    // Allocate the new transformation filter
-    _sourceTransformFilter[i] = new mirtk::ImageTransformation;
-
-    // Set inputs and outputs for the transformation filter
-    _sourceTransformFilter[i]->Input (_sourceImage);
-    _sourceTransformFilter[i]->Output(_sourceImageOutput[i]);
-    _sourceTransformFilter[i]->Cache (&_sourceTransformCache);
     if (_sourceTransformApply) {
       _sourceTransformFilter[i]->Transformation(_sourceTransform);
     } else {
       _sourceTransformFilter[i]->Transformation(_targetTransform);
     }
-    _sourceTransformFilter[i]->Interpolator(_sourceInterpolator);
-    _sourceTransformFilter[i]->SourcePaddingValue(_sourceMin - 1);
-    _sourceTransformFilter[i]->Invert(_sourceTransformInvert);
   }
-  this->Initialize();
+
+  // Displacements need to be recomputed, but the cache lattice only depends
+  // on the images and is reallocated only if it differs from the current one
+  if (_sourceImage && _sourceTransform->RequiresCachingOfDisplacements() && _CacheDisplacements) {
+    if (_targetImage) {
+      attr = _targetImage->GetImageAttributes();
+    } else {
+      attr = _sourceImage->GetImageAttributes();
+    }
+    if (_sourceTransformCache.IsEmpty() || !attr.EqualInSpace(_sourceTransformCache.GetImageAttributes())) {
+      _sourceTransformCache.Initialize(attr, 3);
+    }
+    _sourceTransformCache.Modified(true);
+  } else {
+    _sourceTransformCache.Clear();
+  }
+  _sourceUpdate = true;
+
+  UnlockResources();
 }
 
 void RView::WriteTransformation(char *name)
@@ -1998,6 +2744,7 @@ void RView::ReadTargetLandmarks(char *name)
 {
   // Read target landmarks
   _targetLandmarks.ReadVTK(name);
+  _targetLandmarksVersion++;
   _selectedTargetLandmarks.clear();
 }
 
@@ -2005,6 +2752,7 @@ void RView::ReadSourceLandmarks(char *name)
 {
   // Read source landmarks
   _sourceLandmarks.ReadVTK(name);
+  _sourceLandmarksVersion++;
   _selectedSourceLandmarks.clear();
 }
 
@@ -2021,31 +2769,15 @@ void RView::WriteSourceLandmarks(char *name)
 }
 
 #if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
-void RView::ReadObject(const char *name)
+bool RView::ReadObject(const char *name)
 {
-  if (_NoOfObjects >= MAX_NUMBER_OF_OBJECTS) {
-    cerr << "RView::ReadObject(): maximum number of objects reached!\n";
-    return;
-  }
-
-  vtkSmartPointer<vtkPolyData> object = mirtk::ReadPolyData(name);
-  _Object[_NoOfObjects] = object.GetPointer();
-  _Object[_NoOfObjects]->Register(_Object[_NoOfObjects]);
-
-  // Increment objects counter
-  _NoOfObjects++;
+  // Object is read when first displayed, only its file is checked now
+  return _Objects.Add(name);
 }
 
 void RView::RemoveObject()
 {
-    int i;
-
-    for (i = 0; i < MAX_NUMBER_OF_OBJECTS; i++) {
-        if (_Object[i]) _Object[i]->Delete();
-        _Object[i] = nullptr;
-    }
-
-    _NoOfObjects = 0;
+    _Objects.Clear();
 }
 
 #endif
@@ -2330,6 +3062,7 @@ void RView::Resize(int w, int h)
 {
   int i;
 
+  Lock();
   if ((w != _screenX) || (h != _screenY)) {
     _screenX = w;
     _screenY = h;
@@ -2343,29 +3076,31 @@ void RView::Resize(int w, int h)
   _segmentationUpdate = true;
   _selectionUpdate = true;
 
+  // Drawables are (re-)assigned from the buffer pool by Initialize
   this->Clip();
   this->Initialize();
 
-  // Delete old drawables
-  for (i = 0; i < _NoOfViewers; i++) {
-    if (_drawable[i])
-      delete[] _drawable[i];
-  }
-
-  // Allocate new drawables
-  for (i = 0; i < _NoOfViewers; i++) {
-    int n = _targetImageOutput[i]->GetNumberOfVoxels();
-    _drawable[i] = new Color[n];
+  // Reslice now unless the update thread is reslicing, in which case the
+  // viewers are blank until it completed the update requested instead
+  if (_resliceMutex.try_lock()) {
+    this->Update();
+    _resliceMutex.unlock();
+  } else {
+    for (i = 0; i < _NoOfViewers; i++) {
+      memset(_drawable[i], 0, _viewer[i]->GetWidth() * _viewer[i]->GetHeight() * sizeof(Color));
+    }
+    this->UpdateAsync();
   }
-
-  this->Update();
+  Unlock();
 }
 
 void RView::Configure(RViewConfig config[])
 {
   int i;
 
-  // Delete transformation filter, images and viewers
+  // Delete transformation filter, images and viewers, the memory of the
+  // output images and drawables is kept in the buffer pool for reuse
+  Lock();
   for (i = 0; i < _NoOfViewers; i++) {
     delete   _targetTransformFilter[i];
     delete   _sourceTransformFilter[i];
@@ -2376,7 +3111,6 @@ void RView::Configure(RViewConfig config[])
     delete   _segmentationImageOutput[i];
     delete   _selectionImageOutput[i];
     delete   _viewer[i];
-    delete[] _drawable[i];
   }
 
   // Delete array for transformation filter, images and viewers
@@ -2479,16 +3213,12 @@ void RView::Configure(RViewConfig config[])
     }
   }
 
-  for (i = 0; i < _NoOfViewers; i++) {
-    // Configure OpenGL
-    _drawable[i] = new Color[_targetImageOutput[i]->GetNumberOfVoxels()];
-  }
-
   // Update of target and source is required
   _targetUpdate = true;
   _sourceUpdate = true;
   _segmentationUpdate = true;
   _selectionUpdate = true;
+  Unlock();
 }
 
 void RView::GetInfoText(char *buffer1, char *buffer2, char *buffer3, char *buffer4, char *buffer5)
@@ -2788,9 +3518,12 @@ void RView::GetTransformationText(std::list<char *> &text)
 
 void RView::Initialize(bool initialize_cache)
 {
-  int i;
+  int i, n;
+  long allocations;
   mirtk::ImageAttributes attr;
 
+  Lock();
+  allocations = _buffers.NumberOfAllocations();
   for (i = 0; i < _NoOfViewers; i++) {
     attr._x = _viewer[i]->GetWidth();
     attr._y = _viewer[i]->GetHeight();
@@ -2855,14 +3588,20 @@ void RView::Initialize(bool initialize_cache)
     _sourceTransformFilter[i]->ScaleFactor(10000.0 / (_sourceMax - _sourceMin));
     _sourceTransformFilter[i]->Offset(-_sourceMin * 10000.0 / (_sourceMax - _sourceMin));
     _sourceTransformFilter[i]->OutputTimeOffset(_targetImage->ImageToTime(_targetFrame) - _sourceImage->ImageToTime(_sourceFrame));
+
+    // Wrap pooled memory instead of allocating new voxels, such that
+    // resizing, zooming or panning reuses the buffers of the previous call
+    n = attr._x * attr._y;
     attr._torigin = _targetImage->ImageToTime(_targetFrame);
-    _targetImageOutput[i]->Initialize(attr);
+    _targetImageOutput[i]->Initialize(attr, 1, PooledBuffer(_buffers, i, TARGET_BUFFER, n));
     attr._torigin = _sourceImage->ImageToTime(_sourceFrame);
-    _sourceImageOutput[i]->Initialize(attr);
+    _sourceImageOutput[i]->Initialize(attr, 1, PooledBuffer(_buffers, i, SOURCE_BUFFER, n));
     attr._torigin = 0; // TODO
-    _segmentationImageOutput[i]->Initialize(attr);
-    _selectionImageOutput[i]->Initialize(attr);
+    _segmentationImageOutput[i]->Initialize(attr, 1, PooledBuffer(_buffers, i, SEGMENTATION_BUFFER, n));
+    _selectionImageOutput[i]->Initialize(attr, 1, PooledBuffer(_buffers, i, SELECTION_BUFFER, n));
+    _drawable[i] = _buffers.Get<Color>(NUMBER_OF_BUFFERS * i + DRAWABLE_BUFFER, n);
   }
+  _profiler.Count("Buffer allocations", _buffers.NumberOfAllocations() - allocations);
 
   // Update of target and source is required
   _targetUpdate = true;
@@ -2900,12 +3639,20 @@ void RView::Initialize(bool initialize_cache)
       } else {
         attr = _sourceImage->GetImageAttributes();
       }
-      _sourceTransformCache.Initialize(attr, 3);
-      _sourceTransformCache.Modified(true);
-    } else {
+      // Keep lattice when only the viewers changed, e.g., on resize
+      if (_sourceTransformCache.IsEmpty() || !attr.EqualInSpace(_sourceTransformCache.GetImageAttributes())) {
+        LockResources();
+        _sourceTransformCache.Initialize(attr, 3);
+        _sourceTransformCache.Modified(true);
+        UnlockResources();
+      }
+    } else if (!_sourceTransformCache.IsEmpty()) {
+      LockResources();
       _sourceTransformCache.Clear();
+      UnlockResources();
     }
   }
+  Unlock();
 }
 
 void RView::SetTargetFrame(int t)
@@ -2913,6 +3660,11 @@ void RView::SetTargetFrame(int t)
   int i;
   double xorigin, yorigin, zorigin, torigin;
 
+  // Only frames which have been read already can be displayed
+  if (_targetLoader.IsLoading() && t >= _targetLoader.NumberOfLoadedFrames()) {
+    t = _targetLoader.NumberOfLoadedFrames() - 1;
+  }
+
   // Update target frame
   _targetFrame = t;
 
@@ -2927,6 +3679,11 @@ void RView::SetTargetFrame(int t)
   // Update of target is required
   _targetUpdate = true;
   if (_sourceTransformApply) _sourceUpdate = true;
+
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+  // Read objects of the next frames while this one is displayed
+  if (_DisplayObject && _ObjectMovie) _Objects.Prefetch(t);
+#endif
 }
 
 int RView::GetTargetFrame()
@@ -2934,12 +3691,18 @@ int RView::GetTargetFrame()
   return _targetFrame;
 }
 
+int RView::GetNumberOfTargetFrames()
+{
+  if (_targetLoader.IsLoading()) return _targetLoader.NumberOfLoadedFrames();
+  return _targetImage->GetT();
+}
+
 void RView::SetSourceFrame(int t)
 {
   int i;
   double xorigin, yorigin, zorigin, torigin;
 
-  if (t >= _sourceImage->GetT()) t = _sourceImage->GetT() - 1;
+  if (t >= this->GetNumberOfSourceFrames()) t = this->GetNumberOfSourceFrames() - 1;
 
   // Update source frame
   _sourceFrame = t;
@@ -2961,15 +3724,29 @@ int RView::GetSourceFrame()
   return _sourceFrame;
 }
 
+int RView::GetNumberOfSourceFrames()
+{
+  if (_sourceLoader.IsLoading()) return _sourceLoader.NumberOfLoadedFrames();
+  return _sourceImage->GetT();
+}
+
 void RView::SetTargetInterpolationMode(mirtk::InterpolationMode value)
 {
   int i;
+  mirtk::InterpolationMode mode;
 
+  LockResources();
+  mode = this->GetTargetInterpolationMode();
   delete _targetInterpolator;
   _targetInterpolator = mirtk::InterpolateImageFunction::New(value, _targetImage);
   for (i = 0; i < _NoOfViewers; i++) {
     _targetTransformFilter[i]->Interpolator(_targetInterpolator);
   }
+  // Labels are downsampled by their mode rather than average
+  if (IsLabelImage(_targetImage, value) != IsLabelImage(_targetImage, mode)) {
+    _targetPyramid.Initialize(_targetImage, IsLabelImage(_targetImage, value));
+  }
+  UnlockResources();
   _targetUpdate = true;
 }
 
@@ -2996,12 +3773,20 @@ mirtk::InterpolationMode RView::GetTargetInterpolationMode()
 void RView::SetSourceInterpolationMode(mirtk::InterpolationMode value)
 {
   int i;
+  mirtk::InterpolationMode mode;
 
+  LockResources();
+  mode = this->GetSourceInterpolationMode();
   delete _sourceInterpolator;
   _sourceInterpolator = mirtk::InterpolateImageFunction::New(value, _sourceImage);
   for (i = 0; i < _NoOfViewers; i++) {
     _sourceTransformFilter[i]->Interpolator(_sourceInterpolator);
   }
+  // Labels are downsampled by their mode rather than average
+  if (IsLabelImage(_sourceImage, value) != IsLabelImage(_sourceImage, mode)) {
+    _sourcePyramid.Initialize(_sourceImage, IsLabelImage(_sourceImage, value));
+  }
+  UnlockResources();
   _sourceUpdate = true;
 }
 
@@ -3025,6 +3810,27 @@ mirtk::InterpolationMode RView::GetSourceInterpolationMode()
   return mirtk::Interpolation_NN;
 }
 
+void RView::BeginInteraction()
+{
+  _Interactive = _Progressive;
+}
+
+void RView::EndInteraction()
+{
+  if (!_Interactive) return;
+  _Interactive = false;
+
+  // Re-render images which were resliced with fast interpolation
+  if (this->GetTargetInterpolationMode() != mirtk::Interpolation_NN &&
+      this->GetTargetInterpolationMode() != mirtk::Interpolation_Linear) {
+    _targetUpdate = true;
+  }
+  if (this->GetSourceInterpolationMode() != mirtk::Interpolation_NN &&
+      this->GetSourceInterpolationMode() != mirtk::Interpolation_Linear) {
+    _sourceUpdate = true;
+  }
+}
+
 void RView::SetSourceTransformInvert(bool value)
 {
   int i;
@@ -3063,13 +3869,10 @@ bool RView::GetSourceTransformApply()
   return _sourceTransformApply;
 }
 
-void RView::DrawOffscreen(char *filename)
+void RView::DrawOffscreen(unsigned char *buffer)
 {
-  int i, n, index;
-  unsigned char *buffer, *ptr;
-
-  // Allocate memory
-  buffer = new unsigned char[_screenX * _screenY * 3];
+  int j, w, h;
+  std::vector<unsigned char> row;
 
   // Make sure everything is setup correctly (this may be the first time
   // something is drawn into the window)
@@ -3079,14 +3882,34 @@ void RView::DrawOffscreen(char *filename)
   // Force framebuffer to flush
   glFlush();
 
-  // Allocate RGB image
-  mirtk::GenericImage<unsigned char> image(this->GetWidth(), this->GetHeight(), 3, 1);
-
   // Read pixels from framebuffer
+  w = this->GetWidth();
+  h = this->GetHeight();
   glPixelStorei(GL_PACK_ALIGNMENT, 1);
-  glReadPixels(0, 0, this->GetWidth(), this->GetHeight(), GL_RGB, GL_UNSIGNED_BYTE, buffer);
+  glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, buffer);
+
+  // Framebuffer rows are bottom-up, swap them in place
+  row.resize(3 * w);
+  for (j = 0; j < h / 2; j++) {
+    memcpy(row.data(), buffer + 3 * j * w, 3 * w);
+    memcpy(buffer + 3 * j * w, buffer + 3 * (h - j - 1) * w, 3 * w);
+    memcpy(buffer + 3 * (h - j - 1) * w, row.data(), 3 * w);
+  }
+}
+
+void RView::DrawOffscreen(char *filename)
+{
+  int i, n, index;
+  unsigned char *buffer, *ptr;
+
+  // Allocate memory
+  buffer = new unsigned char[_screenX * _screenY * 3];
+
+  // Render and read pixels from framebuffer
+  this->DrawOffscreen(buffer);
 
   // Convert to RGB image
+  mirtk::GenericImage<unsigned char> image(this->GetWidth(), this->GetHeight(), 3, 1);
   n = image.GetX() * image.GetY();
   index = 0;
   ptr = image.GetPointerToVoxels();
@@ -3096,8 +3919,6 @@ void RView::DrawOffscreen(char *filename)
     ptr[i+2*n] = buffer[index++];
   }
 
-  image.ReflectY();
-
   // Write file
   image.Write(filename);
 
@@ -3106,53 +3927,75 @@ void RView::DrawOffscreen(char *filename)
 
 double RView::FitLandmarks()
 {
-  int i, n;
-  double error;
-  mirtk::PointSet target_pts, source_pts;
+  int i, j;
+  double applied[3][4], difference;
 
   // Check whether landmarks numbers agree
   if (this->GetNumberOfTargetLandmarks() != this->GetNumberOfSourceLandmarks()) {
-    return 0;
+    return -1;
   }
 
-  // Initialize
-  n = this->GetNumberOfTargetLandmarks();
-  for (i = 0; i < n; i++) {
-    target_pts.Add(this->_targetLandmarks(i));
-    source_pts.Add(this->_sourceLandmarks(i));
+  // Linear transformation to fit, for FFDs the global transformation
+  mirtk::HomogeneousTransformation *transformation = dynamic_cast<mirtk::HomogeneousTransformation *>(_sourceTransform);
+  mirtk::MultiLevelTransformation  *mffd           = dynamic_cast<mirtk::MultiLevelTransformation  *>(_sourceTransform);
+  if (transformation == NULL && mffd != NULL) transformation = mffd->GetGlobalTransformation();
+  if (transformation == NULL) {
+    cerr << "RView::FitLandmarks: Transformation has no linear part to fit" << endl;
+    return -1;
   }
 
-  // Set transformation
-  mirtk::RigidTransformation transformation;
+  // Fit transformation mapping target onto source landmarks
+  if (!_landmarkFit.Run(_targetLandmarks, _sourceLandmarks)) return -1;
 
-#if 0
-  // Set input and output for the registration filter
-  mirtk::PointRigidRegistration registration;
-  registration.SetInput (&target_pts, &source_pts);
-  registration.SetOutput(&transformation);
+  mirtk::Matrix matrix(4, 4);
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < 4; j++) matrix(i, j) = _landmarkFit.Get(i, j);
+  }
+  Lock();
+  transformation->PutMatrix(matrix);
+  this->SourceTransformModified();
+
+  // Transformations whose parameters cannot represent the model, e.g., a rigid
+  // transformation given a similarity or affine fit, drop the scaling and shearing
+  // when the matrix is put, report the residuals of what was actually applied
+  mirtk::Matrix m = transformation->GetMatrix();
+  difference = 0;
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 4; j++) {
+      applied[i][j] = m(i, j);
+      difference = std::max(difference, fabs(m(i, j) - matrix(i, j)));
+    }
+  }
+  Unlock();
+  if (difference > 1e-6) {
+    cerr << "RView::FitLandmarks: " << transformation->NameOfClass()
+         << " cannot represent the fitted model, residuals are those of the applied transformation" << endl;
+    _landmarkFit.Evaluate(_targetLandmarks, _sourceLandmarks, applied);
+  }
 
-  // Run registration filter
-  registration.Run();
-#endif
+  return _landmarkFit.MeanResidual();
+}
 
-  // Calculate residual error
-  transformation.Transform(source_pts);
+bool RView::FetchTransformation()
+{
+  int i, n;
 
-  error = 0;
-  for (i = 0; i < target_pts.Size(); i++) {
-    mirtk::Point p1 = target_pts(i);
-    mirtk::Point p2 = source_pts(i);
-    error += sqrt(pow(p1._x - p2._x, 2.0) + pow(p1._y - p2._y, 2.0) + pow(p1._z
-                  - p2._z, 2.0));
-  }
-  error /= target_pts.Size();
+  if (!_sourceTransformMailbox.Fetch()) return false;
+  const std::vector<double> &dofs = _sourceTransformMailbox.Snapshot();
+  n = static_cast<int>(dofs.size());
 
-  // Copy dofs
-  for (i = 0; i < 6; i++) {
-    _sourceTransform->Put(i, transformation.Get(i));
+  Lock();
+  if (_sourceTransform == NULL || _sourceTransform->NumberOfDOFs() != n) {
+    cerr << "RView::FetchTransformation: Snapshot has " << n << " DOFs, but transformation has "
+         << ((_sourceTransform) ? _sourceTransform->NumberOfDOFs() : 0) << endl;
+    Unlock();
+    return false;
   }
+  for (i = 0; i < n; i++) _sourceTransform->Put(i, dofs[i]);
+  this->SourceTransformModified();
+  Unlock();
 
-  return error;
+  return true;
 }
 
 void RView::cb_special(int key, int, int, int target_delta, int source_delta)
@@ -3497,6 +4340,7 @@ void RView::cb_keyboard_info()
   cerr << "\t'+'                              Increase deformation level\n";
   cerr << "\t'-'                              Decrease deformation level\n";
   cerr << "\t'L'                              Landmarks on/off\n";
+  cerr << "\t'P'                              Stage timings on/off (view only)\n";
 #if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
   cerr << "\t'O'                              Object display on/off\n";
   cerr << "\t'W'                              Object vectors warp on/off\n";
@@ -21,6 +21,7 @@
 
 SegmentTable::SegmentTable()
 {
+  _version = 0;
 }
 
 SegmentTable::~SegmentTable()
@@ -29,6 +30,7 @@ SegmentTable::~SegmentTable()
 
 void SegmentTable::Set(int id, char* label, unsigned char r, unsigned char g, unsigned char b, double trans, int vis)
 {
+  _version++;
   _entry[id].setLabel(label);
   _entry[id].setColor(r, g, b);
   _entry[id].setTrans(trans);
@@ -37,21 +39,25 @@ void SegmentTable::Set(int id, char* label, unsigned char r, unsigned char g, un
 
 void SegmentTable::SetLabel(int id, char* label)
 {
+  _version++;
   _entry[id].setLabel(label);
 }
 
 void SegmentTable::SetColor(int id, unsigned char red, unsigned char green, unsigned char blue)
 {
+  _version++;
   _entry[id].setColor(red, green, blue);
 }
 
 void SegmentTable::SetTrans(int id, double t)
 {
+  _version++;
   _entry[id].setTrans(t);
 }
 
 void SegmentTable::SetVisibility(int id, int vis)
 {
+  _version++;
   _entry[id].setVisibility(vis);
 }
 
@@ -80,6 +86,7 @@ void SegmentTable::Clear()
 
 void SegmentTable::Clear(int id)
 {
+  _version++;
   _entry[id].setLabel(NULL);
   _entry[id].setColor(0, 0, 0);
   _entry[id].setTrans(0);
@@ -127,6 +134,7 @@ void SegmentTable::Read(char *name)
     _entry[id].setTrans(trans);
     _entry[id].setVisibility(vis);
   }
+  _version++;
 }
 
 void SegmentTable::Write(char *name)
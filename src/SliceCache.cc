@@ -0,0 +1,90 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mirtk/SliceCache.h>
+
+
+namespace {
+
+// Total size of buffers in bytes
+size_t SizeOf(const SliceCache::Buffers &buffers)
+{
+  size_t i, size = 0;
+
+  for (i = 0; i < buffers.size(); i++) size += buffers[i].size();
+  return size;
+}
+
+}
+
+
+SliceCache::SliceCache(size_t budget)
+{
+  _Budget = budget;
+  _Size   = 0;
+}
+
+void SliceCache::SetBudget(size_t budget)
+{
+  _Budget = budget;
+  this->Evict();
+}
+
+void SliceCache::Clear()
+{
+  _Entries.clear();
+  _Index.clear();
+  _Size = 0;
+}
+
+void SliceCache::Evict()
+{
+  while (!_Entries.empty() && _Size > _Budget) {
+    _Size -= SizeOf(_Entries.back().second);
+    _Index.erase(_Entries.back().first);
+    _Entries.pop_back();
+  }
+}
+
+const SliceCache::Buffers *SliceCache::Find(const Key &key)
+{
+  std::map<Key, std::list<std::pair<Key, Buffers> >::iterator>::iterator it;
+
+  it = _Index.find(key);
+  if (it == _Index.end()) return NULL;
+  _Entries.splice(_Entries.begin(), _Entries, it->second);
+  return &_Entries.front().second;
+}
+
+void SliceCache::Insert(const Key &key, Buffers &buffers)
+{
+  std::map<Key, std::list<std::pair<Key, Buffers> >::iterator>::iterator it;
+
+  if (SizeOf(buffers) > _Budget) return;
+  it = _Index.find(key);
+  if (it != _Index.end()) {
+    _Size -= SizeOf(it->second->second);
+    _Entries.erase(it->second);
+    _Index.erase(it);
+  }
+  _Entries.push_front(std::make_pair(key, Buffers()));
+  _Entries.front().second.swap(buffers);
+  _Index[key] = _Entries.begin();
+  _Size += SizeOf(_Entries.front().second);
+  this->Evict();
+}
@@ -0,0 +1,306 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mirtk/SurfaceCutter.h>
+
+#if MIRTK_IO_WITH_VTK && defined(HAVE_VTK)
+
+#include <algorithm>
+#include <cmath>
+
+#include <mirtk/Parallel.h>
+
+#include <vtkCell.h>
+#include <vtkGenericCell.h>
+#include <vtkIdList.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+
+// Maximum number of plane orientations for which triangles are kept in buckets
+#define MAX_SURFACE_BUCKETS 6
+
+// Maximum number of cached cuts, e.g., one per viewer and object frame
+#define MAX_SURFACE_CUTS 16
+
+
+namespace {
+
+// Map points of object by transformation
+struct TransformPoints
+{
+  const mirtk::Transformation *_Transformation;
+  double                      *_Point;
+
+  void operator ()(const mirtk::blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); i++) {
+      _Transformation->Transform(_Point[3*i], _Point[3*i+1], _Point[3*i+2]);
+    }
+  }
+};
+
+}
+
+
+SurfaceCutter::SurfaceCutter(vtkPointSet *object)
+{
+  _Object = NULL;
+  _MTime  = 0;
+  this->Initialize(object);
+}
+
+void SurfaceCutter::Initialize(vtkPointSet *object)
+{
+  _Object = object;
+  _MTime  = 0;
+  // Release memory, e.g., when the object of a sequence is discarded
+  std::vector<double>().swap(_Point);
+  std::vector<double>().swap(_WarpedPoint);
+  std::vector<double>().swap(_WarpKey);
+  std::vector<int>().swap(_Index);
+  std::vector<Buckets>().swap(_Buckets);
+  std::vector<Cut>().swap(_Cuts);
+}
+
+size_t SurfaceCutter::MemorySize() const
+{
+  size_t i, size;
+
+  size  = (_Point.capacity() + _WarpedPoint.capacity()) * sizeof(double);
+  size += _Index.capacity() * sizeof(int);
+  for (i = 0; i < _Buckets.size(); i++) {
+    size += (_Buckets[i].Offset.capacity() + _Buckets[i].Triangle.capacity()) * sizeof(int);
+  }
+  for (i = 0; i < _Cuts.size(); i++) {
+    size += _Cuts[i].Segments.capacity() * sizeof(double);
+  }
+  return size;
+}
+
+void SurfaceCutter::Triangulate()
+{
+  int i, f;
+  vtkIdType n;
+
+  _Point.clear();
+  _WarpedPoint.clear();
+  _WarpKey.clear();
+  _Index.clear();
+  _Buckets.clear();
+  _Cuts.clear();
+  if (_Object == NULL) return;
+  _MTime = _Object->GetMTime();
+
+  n = _Object->GetNumberOfPoints();
+  _Point.resize(3 * n);
+  for (i = 0; i < n; i++) _Object->GetPoint(i, &_Point[3*i]);
+
+  // Triangulation of polygons, strips and of the faces of volumetric cells,
+  // where the cell type determines the order of points (e.g., pixels, strips)
+  vtkSmartPointer<vtkGenericCell> cell = vtkSmartPointer<vtkGenericCell>::New();
+  vtkSmartPointer<vtkIdList>      ids  = vtkSmartPointer<vtkIdList>::New();
+  vtkSmartPointer<vtkPoints>      pts  = vtkSmartPointer<vtkPoints>::New();
+  for (i = 0; i < _Object->GetNumberOfCells(); i++) {
+    _Object->GetCell(i, cell);
+    if (cell->GetCellDimension() == 2) {
+      this->AddTriangles(cell, ids, pts);
+    } else if (cell->GetCellDimension() == 3) {
+      for (f = 0; f < cell->GetNumberOfFaces(); f++) {
+        this->AddTriangles(cell->GetFace(f), ids, pts);
+      }
+    }
+  }
+}
+
+void SurfaceCutter::AddTriangles(vtkCell *cell, vtkIdList *ids, vtkPoints *pts)
+{
+  vtkIdType j;
+
+  ids->Reset();
+  pts->Reset();
+  if (cell->Triangulate(0, ids, pts) == 0) return;
+  for (j = 0; j + 2 < ids->GetNumberOfIds(); j += 3) {
+    _Index.push_back(static_cast<int>(ids->GetId(j)));
+    _Index.push_back(static_cast<int>(ids->GetId(j+1)));
+    _Index.push_back(static_cast<int>(ids->GetId(j+2)));
+  }
+}
+
+void SurfaceCutter::Warp(const mirtk::Transformation *transform, unsigned long version)
+{
+  int i;
+  std::vector<double> key;
+
+  key.push_back(static_cast<double>(reinterpret_cast<size_t>(transform)));
+  key.push_back(transform->NumberOfDOFs());
+  key.push_back(version);
+  if (key == _WarpKey) return;
+
+  // Buckets of previously warped points are no longer valid
+  for (i = static_cast<int>(_Buckets.size()) - 1; i >= 0; i--) {
+    if (_Buckets[i].Warped) _Buckets.erase(_Buckets.begin() + i);
+  }
+
+  _WarpKey     = key;
+  _WarpedPoint = _Point;
+  if (!_WarpedPoint.empty()) {
+    TransformPoints body;
+    body._Transformation = transform;
+    body._Point          = _WarpedPoint.data();
+    mirtk::parallel_for(mirtk::blocked_range<int>(0, static_cast<int>(_WarpedPoint.size() / 3)), body);
+  }
+}
+
+const SurfaceCutter::Buckets &SurfaceCutter::GetBuckets(const double *normal, bool warped)
+{
+  int i, j, t, n, nbuckets, first, last;
+  double d, min, max;
+  std::vector<double> lo, hi;
+
+  const std::vector<double> &points = warped ? _WarpedPoint : _Point;
+  for (i = 0; i < static_cast<int>(_Buckets.size()); i++) {
+    if (_Buckets[i].Warped    == warped    &&
+        _Buckets[i].Normal[0] == normal[0] &&
+        _Buckets[i].Normal[1] == normal[1] &&
+        _Buckets[i].Normal[2] == normal[2]) return _Buckets[i];
+  }
+  if (_Buckets.size() >= MAX_SURFACE_BUCKETS) _Buckets.erase(_Buckets.begin());
+
+  // Extent of triangles along normal
+  n = this->NumberOfTriangles();
+  lo.resize(n);
+  hi.resize(n);
+  min = max = 0;
+  for (t = 0; t < n; t++) {
+    for (j = 0; j < 3; j++) {
+      const double *p = &points[3*_Index[3*t+j]];
+      d = p[0] * normal[0] + p[1] * normal[1] + p[2] * normal[2];
+      if (j == 0 || d < lo[t]) lo[t] = d;
+      if (j == 0 || d > hi[t]) hi[t] = d;
+    }
+    if (t == 0 || lo[t] < min) min = lo[t];
+    if (t == 0 || hi[t] > max) max = hi[t];
+  }
+
+  // For closed surfaces, O(sqrt(n)) buckets such that most triangles fall
+  // into only a few buckets and each bucket holds O(sqrt(n)) triangles
+  Buckets buckets;
+  buckets.Warped    = warped;
+  buckets.Normal[0] = normal[0];
+  buckets.Normal[1] = normal[1];
+  buckets.Normal[2] = normal[2];
+  nbuckets = 2 * static_cast<int>(sqrt(static_cast<double>(n))) + 1;
+  buckets.Min   = min;
+  buckets.Max   = max;
+  buckets.Width = (max > min) ? (max - min) / nbuckets : 1.0;
+  buckets.Offset.assign(nbuckets + 1, 0);
+  for (t = 0; t < n; t++) {
+    first = std::min(nbuckets - 1, static_cast<int>((lo[t] - min) / buckets.Width));
+    last  = std::min(nbuckets - 1, static_cast<int>((hi[t] - min) / buckets.Width));
+    for (i = first; i <= last; i++) buckets.Offset[i+1]++;
+  }
+  for (i = 0; i < nbuckets; i++) buckets.Offset[i+1] += buckets.Offset[i];
+  buckets.Triangle.resize(buckets.Offset[nbuckets]);
+  std::vector<int> next(buckets.Offset.begin(), buckets.Offset.end() - 1);
+  for (t = 0; t < n; t++) {
+    first = std::min(nbuckets - 1, static_cast<int>((lo[t] - min) / buckets.Width));
+    last  = std::min(nbuckets - 1, static_cast<int>((hi[t] - min) / buckets.Width));
+    for (i = first; i <= last; i++) buckets.Triangle[next[i]++] = t;
+  }
+  _Buckets.push_back(buckets);
+  return _Buckets.back();
+}
+
+const std::vector<double> &SurfaceCutter::Run(const double *origin, const double *normal,
+                                              const mirtk::Transformation *transform, unsigned long version)
+{
+  int i, j, a, b, t, bucket;
+  double n[3], norm, d, s[3], w;
+  std::vector<double> key;
+
+  // Triangulate object once and again after it was modified
+  if (_Object != NULL && (_Point.empty() || _Object->GetMTime() != _MTime)) {
+    this->Triangulate();
+  }
+
+  // Unit normal and distance of plane from origin
+  norm = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+  if (norm > 0) {
+    n[0] = normal[0] / norm;
+    n[1] = normal[1] / norm;
+    n[2] = normal[2] / norm;
+  } else {
+    n[0] = n[1] = 0;
+    n[2] = 1;
+  }
+  d = origin[0] * n[0] + origin[1] * n[1] + origin[2] * n[2];
+
+  // Reuse cut of same plane and transformation
+  key.push_back(n[0]);
+  key.push_back(n[1]);
+  key.push_back(n[2]);
+  key.push_back(d);
+  key.push_back(static_cast<double>(reinterpret_cast<size_t>(transform)));
+  key.push_back(transform ? transform->NumberOfDOFs() : 0);
+  key.push_back(transform ? version : 0);
+  for (i = 0; i < static_cast<int>(_Cuts.size()); i++) {
+    if (_Cuts[i].Key == key) {
+      // Move to back as most recently used
+      std::rotate(_Cuts.begin() + i, _Cuts.begin() + i + 1, _Cuts.end());
+      return _Cuts.back().Segments;
+    }
+  }
+  if (_Cuts.size() >= MAX_SURFACE_CUTS) _Cuts.erase(_Cuts.begin());
+  _Cuts.push_back(Cut());
+  Cut &cut = _Cuts.back();
+  cut.Key = key;
+  if (_Index.empty()) return cut.Segments;
+
+  // Warp vertices once per transformation rather than the points of each cut
+  if (transform != NULL) this->Warp(transform, version);
+  const std::vector<double> &points = (transform != NULL) ? _WarpedPoint : _Point;
+
+  // Intersect candidate triangles with plane, each triangle with vertices
+  // on both sides contributes one line segment
+  const Buckets &buckets = this->GetBuckets(n, transform != NULL);
+  if (d < buckets.Min || d > buckets.Max) return cut.Segments;
+  bucket = std::min(static_cast<int>(buckets.Offset.size()) - 2, static_cast<int>((d - buckets.Min) / buckets.Width));
+  for (i = buckets.Offset[bucket]; i < buckets.Offset[bucket+1]; i++) {
+    t = buckets.Triangle[i];
+    for (j = 0; j < 3; j++) {
+      const double *p = &points[3*_Index[3*t+j]];
+      s[j] = p[0] * n[0] + p[1] * n[1] + p[2] * n[2] - d;
+    }
+    if ((s[0] >= 0) == (s[1] >= 0) && (s[1] >= 0) == (s[2] >= 0)) continue;
+    for (j = 0; j < 3; j++) {
+      a = j;
+      b = (j + 1) % 3;
+      if ((s[a] >= 0) == (s[b] >= 0)) continue;
+      const double *p = &points[3*_Index[3*t+a]];
+      const double *q = &points[3*_Index[3*t+b]];
+      w = s[a] / (s[a] - s[b]);
+      cut.Segments.push_back(p[0] + w * (q[0] - p[0]));
+      cut.Segments.push_back(p[1] + w * (q[1] - p[1]));
+      cut.Segments.push_back(p[2] + w * (q[2] - p[2]));
+    }
+  }
+
+  return cut.Segments;
+}
+
+#endif
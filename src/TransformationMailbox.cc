@@ -0,0 +1,211 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <mirtk/TransformationMailbox.h>
+
+#ifndef _WIN32
+  #include <sys/types.h>
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/un.h>
+  #include <poll.h>
+  #include <unistd.h>
+#endif
+
+// Flag of middle slot marking a snapshot which was not yet fetched
+#define SNAPSHOT_FRESH 4
+
+// Time in milliseconds after which the listener checks whether to stop
+#define LISTEN_TIMEOUT 100
+
+
+TransformationMailbox::TransformationMailbox()
+:
+  _Back(0), _Front(2), _Middle(1), _Published(0), _Attached(false), _Socket(-1), _Stop(false)
+{
+}
+
+TransformationMailbox::~TransformationMailbox()
+{
+  this->Close();
+}
+
+bool TransformationMailbox::Attach()
+{
+  bool attached = false;
+  return _Attached.compare_exchange_strong(attached, true);
+}
+
+void TransformationMailbox::Detach()
+{
+  _Attached = false;
+}
+
+void TransformationMailbox::Swap()
+{
+  _Back = _Middle.exchange(_Back | SNAPSHOT_FRESH, std::memory_order_acq_rel) & 3;
+  _Published++;
+}
+
+void TransformationMailbox::Publish(const double *dofs, int n)
+{
+  _Slot[_Back].assign(dofs, dofs + n);
+  this->Swap();
+}
+
+void TransformationMailbox::Publish(const mirtk::Transformation *transform)
+{
+  int i;
+
+  _Slot[_Back].resize(transform->NumberOfDOFs());
+  for (i = 0; i < transform->NumberOfDOFs(); i++) {
+    _Slot[_Back][i] = transform->Get(i);
+  }
+  this->Swap();
+}
+
+bool TransformationMailbox::Fetch()
+{
+  if ((_Middle.load(std::memory_order_acquire) & SNAPSHOT_FRESH) == 0) return false;
+  _Front = _Middle.exchange(_Front, std::memory_order_acq_rel) & 3;
+  return true;
+}
+
+bool TransformationMailbox::Listen(const char *path)
+{
+#ifdef _WIN32
+  std::cerr << "TransformationMailbox::Listen: Local sockets not supported on this platform" << std::endl;
+  return false;
+#else
+  struct sockaddr_un addr;
+  struct stat st;
+
+  this->Close();
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    std::cerr << "TransformationMailbox::Listen: Socket path too long: " << path << std::endl;
+    return false;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  // Remove stale socket of a previous session, but no other kind of file
+  if (lstat(path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      std::cerr << "TransformationMailbox::Listen: Refusing to replace " << path << ", which is not a socket" << std::endl;
+      return false;
+    }
+    unlink(path);
+  }
+
+  _Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (_Socket == -1) {
+    std::cerr << "TransformationMailbox::Listen: Failed to create socket " << path << std::endl;
+    return false;
+  }
+  if (bind(_Socket, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || listen(_Socket, 1) != 0) {
+    std::cerr << "TransformationMailbox::Listen: Failed to bind socket " << path << std::endl;
+    close(_Socket);
+    _Socket = -1;
+    return false;
+  }
+  _SocketPath = path;
+  _Stop = false;
+  _Listener = std::thread(&TransformationMailbox::Serve, this);
+  return true;
+#endif
+}
+
+void TransformationMailbox::Serve()
+{
+#ifndef _WIN32
+  int client;
+  size_t pos;
+  ssize_t n;
+  char buffer[4096], *end;
+  const char *ptr;
+  double value;
+  std::string line;
+  std::vector<double> dofs;
+  struct pollfd fd;
+
+  while (!_Stop) {
+
+    // Wait for a registration to connect
+    fd.fd     = _Socket;
+    fd.events = POLLIN;
+    if (poll(&fd, 1, LISTEN_TIMEOUT) <= 0) continue;
+    client = accept(_Socket, NULL, NULL);
+    if (client == -1) continue;
+
+    // Only one publisher at a time, e.g., not while the registration
+    // panel of the viewer or another client is running
+    if (!this->Attach()) {
+      std::cerr << "TransformationMailbox: Rejected connection to " << _SocketPath
+                << ", another registration is publishing already" << std::endl;
+      close(client);
+      continue;
+    }
+
+    // Publish one snapshot per line until the registration disconnects
+    line.clear();
+    while (!_Stop) {
+      fd.fd     = client;
+      fd.events = POLLIN;
+      if (poll(&fd, 1, LISTEN_TIMEOUT) <= 0) continue;
+      n = read(client, buffer, sizeof(buffer));
+      if (n <= 0) break;
+      line.append(buffer, n);
+      while ((pos = line.find('\n')) != std::string::npos) {
+        dofs.clear();
+        ptr = line.c_str();
+        while (true) {
+          value = strtod(ptr, &end);
+          if (end == ptr || end > line.c_str() + pos) break;
+          dofs.push_back(value);
+          ptr = end;
+        }
+        if (!dofs.empty()) this->Publish(dofs.data(), static_cast<int>(dofs.size()));
+        line.erase(0, pos + 1);
+      }
+    }
+    close(client);
+    this->Detach();
+  }
+#endif
+}
+
+void TransformationMailbox::Close()
+{
+#ifndef _WIN32
+  if (_Listener.joinable()) {
+    _Stop = true;
+    _Listener.join();
+  }
+  if (_Socket != -1) {
+    close(_Socket);
+    unlink(_SocketPath.c_str());
+    _Socket = -1;
+  }
+  _SocketPath.clear();
+#endif
+}
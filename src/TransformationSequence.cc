@@ -0,0 +1,207 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <iostream>
+
+#include <mirtk/TransformationSequence.h>
+#include <mirtk/Transformations.h>
+
+
+TransformationSequence::TransformationSequence(int prefetch, int threads)
+{
+  _Prefetch        = (prefetch > 0) ? prefetch : 0;
+  _NumberOfThreads = (threads  > 0) ? threads  : 1;
+  _Stop            = false;
+}
+
+TransformationSequence::~TransformationSequence()
+{
+  this->Clear();
+}
+
+mirtk::Transformation *TransformationSequence::Read(const char *name)
+{
+  int i;
+
+  mirtk::Transformation *transform = mirtk::Transformation::New(name);
+
+  // If transformation is rigid convert it to affine
+  if (strcmp(transform->NameOfClass(), "mirtk::RigidTransformation") == 0) {
+    mirtk::AffineTransformation *tmpTransform = new mirtk::AffineTransformation;
+    for (i = 0; i < transform->NumberOfDOFs(); i++) {
+      tmpTransform->Put(i, transform->Get(i));
+    }
+    delete transform;
+    transform = tmpTransform;
+  }
+  return transform;
+}
+
+void TransformationSequence::Run()
+{
+  int i;
+  std::string name;
+
+  std::unique_lock<std::mutex> lock(_Mutex);
+  while (true) {
+    _QueueCondition.wait(lock, [this] { return _Stop || !_Queue.empty(); });
+    if (_Stop) break;
+    i = _Queue.front();
+    _Queue.pop_front();
+    name = _FileName[i];
+
+    // Read transformation without holding the lock
+    lock.unlock();
+    mirtk::Transformation *transform = Read(name.c_str());
+    lock.lock();
+
+    _Transformation[i] = transform;
+    _Pending[i] = false;
+    _ReadyCondition.notify_all();
+  }
+}
+
+void TransformationSequence::Start()
+{
+  int i;
+
+  if (!_Worker.empty()) return;
+  _Stop = false;
+  for (i = 0; i < _NumberOfThreads; i++) {
+    _Worker.push_back(std::thread(&TransformationSequence::Run, this));
+  }
+}
+
+void TransformationSequence::Stop()
+{
+  size_t i;
+
+  {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Stop = true;
+    while (!_Queue.empty()) {
+      _Pending[_Queue.front()] = false;
+      _Queue.pop_front();
+    }
+  }
+  _QueueCondition.notify_all();
+  for (i = 0; i < _Worker.size(); i++) _Worker[i].join();
+  _Worker.clear();
+}
+
+void TransformationSequence::Enqueue(int i)
+{
+  int j, n;
+
+  // Forget about transformations which have not been started yet,
+  // the viewer has moved on and needs those following i first
+  while (!_Queue.empty()) {
+    _Pending[_Queue.front()] = false;
+    _Queue.pop_front();
+  }
+
+  n = static_cast<int>(_FileName.size());
+  for (j = i + 1; j <= i + _Prefetch && j < n; j++) {
+    if (_Transformation[j] == NULL && !_Pending[j]) {
+      _Pending[j] = true;
+      _Queue.push_back(j);
+    }
+  }
+  if (!_Queue.empty()) _QueueCondition.notify_all();
+}
+
+void TransformationSequence::Add(const char *name)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _FileName.push_back(name);
+  _Transformation.push_back(NULL);
+  _Pending.push_back(false);
+}
+
+void TransformationSequence::Clear()
+{
+  size_t i;
+
+  this->Stop();
+  for (i = 0; i < _Transformation.size(); i++) delete _Transformation[i];
+  _FileName.clear();
+  _Transformation.clear();
+  _Pending.clear();
+}
+
+int TransformationSequence::Size() const
+{
+  return static_cast<int>(_FileName.size());
+}
+
+void TransformationSequence::SetPrefetch(int n)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _Prefetch = (n > 0) ? n : 0;
+}
+
+void TransformationSequence::Prefetch(int i)
+{
+  if (_Prefetch == 0) return;
+  this->Start();
+  std::lock_guard<std::mutex> lock(_Mutex);
+  this->Enqueue(i);
+}
+
+mirtk::Transformation *TransformationSequence::Get(int i)
+{
+  mirtk::Transformation *transform;
+
+  if ((i < 0) || (i >= this->Size())) {
+    std::cerr << "TransformationSequence::Get: Invalid transformation: " << i << std::endl;
+    return NULL;
+  }
+  if (_Prefetch > 0) this->Start();
+
+  std::unique_lock<std::mutex> lock(_Mutex);
+
+  // Wait for worker thread if it is currently reading this transformation
+  if (_Pending[i]) {
+    std::deque<int>::iterator it;
+    for (it = _Queue.begin(); it != _Queue.end(); ++it) {
+      if (*it == i) break;
+    }
+    if (it != _Queue.end()) {
+      // Not started yet, read it ourselves below
+      _Queue.erase(it);
+      _Pending[i] = false;
+    } else {
+      _ReadyCondition.wait(lock, [this, i] { return !_Pending[i]; });
+    }
+  }
+
+  // Take ownership of read ahead transformation
+  transform = _Transformation[i];
+  _Transformation[i] = NULL;
+
+  // Continue reading ahead while the caller displays this one
+  this->Enqueue(i);
+
+  if (transform == NULL) {
+    std::string name = _FileName[i];
+    lock.unlock();
+    transform = Read(name.c_str());
+  }
+  return transform;
+}
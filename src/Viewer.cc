@@ -76,8 +76,6 @@ static double _BeforeTagGridZ[MaxNumberOfCP][MaxNumberOfCP];
 #ifdef HAVE_VTK
 
 // vtk includes
-#include <vtkPlane.h>
-#include <vtkCutter.h>
 #include <vtkPointData.h>
 #include <vtkFloatArray.h>
 #include <vtkCell.h>
@@ -621,6 +619,7 @@ void Viewer::DrawCursor(CursorMode mode)
 void Viewer::DrawIsolines(mirtk::GreyImage *image, int value)
 {
 	int i, j;
+	long n = 0;
 
 	// Set color
 	COLOR_ISOLINES;
@@ -634,23 +633,26 @@ void Viewer::DrawIsolines(mirtk::GreyImage *image, int value)
 							&& (image->Get(i + 1, j, 0) <= value))) {
 				glVertex2f(_screenX1 + i + 0.5, _screenY1 + j - 0.5);
 				glVertex2f(_screenX1 + i + 0.5, _screenY1 + j + 0.5);
-
+				n += 2;
 			}
 			if (((image->Get(i, j, 0) <= value) && (image->Get(i, j + 1, 0) > value))
 					|| ((image->Get(i, j, 0) > value)
 							&& (image->Get(i, j + 1, 0) <= value))) {
 				glVertex2f(_screenX1 + i + 0.5, _screenY1 + j + 0.5);
 				glVertex2f(_screenX1 + i - 0.5, _screenY1 + j + 0.5);
+				n += 2;
 			}
 		}
 	}
 	glEnd();
 	glLineWidth(1);
+	_rview->_profiler.Count("GL vertices", n);
 }
 
 void Viewer::DrawSegmentationContour(mirtk::GreyImage *image)
 {
 	int i, j;
+	long n = 0;
 	unsigned char r, g, b;
 	glLineWidth(_rview->GetLineThickness());
 
@@ -666,6 +668,7 @@ void Viewer::DrawSegmentationContour(mirtk::GreyImage *image)
 					glVertex2f(_screenX1 + i, _screenY1 + j - 0.5);
 					glVertex2f(_screenX1 + i, _screenY1 + j + 0.5);
 					glEnd();
+					n += 2;
 				}
 				if (image->Get(i, j, 0) != image->Get(i - 1, j, 0)) {
 					glColor3ub(r, g, b);
@@ -673,6 +676,7 @@ void Viewer::DrawSegmentationContour(mirtk::GreyImage *image)
 					glVertex2f(_screenX1 + i, _screenY1 + j - 0.5);
 					glVertex2f(_screenX1 + i, _screenY1 + j + 0.5);
 					glEnd();
+					n += 2;
 				}
 				if (image->Get(i, j, 0) != image->Get(i, j + 1, 0)) {
 					glColor3ub(r, g, b);
@@ -680,6 +684,7 @@ void Viewer::DrawSegmentationContour(mirtk::GreyImage *image)
 					glVertex2f(_screenX1 + i + 0.5, _screenY1 + j);
 					glVertex2f(_screenX1 + i - 0.5, _screenY1 + j);
 					glEnd();
+					n += 2;
 				}
 				if (image->Get(i, j, 0) != image->Get(i, j - 1, 0)) {
 					glColor3ub(r, g, b);
@@ -687,11 +692,13 @@ void Viewer::DrawSegmentationContour(mirtk::GreyImage *image)
 					glVertex2f(_screenX1 + i + 0.5, _screenY1 + j);
 					glVertex2f(_screenX1 + i - 0.5, _screenY1 + j);
 					glEnd();
+					n += 2;
 				}
 			}
 		}
 	}
 	glLineWidth(1);
+	_rview->_profiler.Count("GL vertices", n);
 }
 
 void Viewer::DrawTagGrid()
@@ -807,112 +814,86 @@ void Viewer::DrawPoints()
 	glEnd();
 }
 
-void Viewer::DrawLandmarks(mirtk::PointSet &landmarks, std::set<int> &ids, mirtk::GreyImage *image, int bTarget, int bAll)
+void Viewer::DrawLandmarks(LandmarkIndex &landmarks, std::set<int> &ids, mirtk::GreyImage *image, int bTarget, int bAll)
 {
+  size_t i;
+  mirtk::Point p;
+  std::vector<int> visible;
+  std::vector<GLfloat> unselected, selected;
+
+  // Landmarks within the slab of this slice
+  landmarks.Find(image, visible);
+  if (visible.empty()) return;
+
+  // Crosses of all landmarks, drawn with one call per colour
+  for (i = 0; i < visible.size(); i++) {
+    p = landmarks.Position(visible[i]);
+    image->WorldToImage(p);
+    std::vector<GLfloat> &lines = (ids.find(visible[i]) != ids.end()) ? selected : unselected;
+    lines.push_back(_screenX1 + p._x - 8); lines.push_back(_screenY1 + p._y);
+    lines.push_back(_screenX1 + p._x + 8); lines.push_back(_screenY1 + p._y);
+    lines.push_back(_screenX1 + p._x);     lines.push_back(_screenY1 + p._y - 8);
+    lines.push_back(_screenX1 + p._x);     lines.push_back(_screenY1 + p._y + 8);
+  }
+
   glLineWidth(1.0);
+  glEnableClientState(GL_VERTEX_ARRAY);
   // Draw unselected landmarks first
-  if (bAll) {
-    for (int i = 0; i < landmarks.Size(); ++i) {
-      // Skip selected landmarks
-      if (ids.find(i) != ids.end()) continue;
-      // Adjust colour
-      if (bTarget) COLOR_TARGET_LANDMARKS;
-      else         COLOR_SOURCE_LANDMARKS;
-      // Get landmark point
-      mirtk::Point p = landmarks(i);
-      // Transform point
-      if (!bTarget && _rview->GetSourceTransformApply()) {
-        const bool inv = !_rview->GetSourceTransformInvert();
-        if (inv) _rview->_sourceTransform->Inverse  (p);
-        else     _rview->_sourceTransform->Transform(p);
-      }
-      // Draw point
-      if (image->IsInFOV(p._x, p._y, p._z)) {
-        image->WorldToImage(p);
-        glBegin(GL_LINES);
-        glVertex2f(_screenX1 + p._x - 8, _screenY1 + p._y);
-        glVertex2f(_screenX1 + p._x + 8, _screenY1 + p._y);
-        glVertex2f(_screenX1 + p._x, _screenY1 + p._y - 8);
-        glVertex2f(_screenX1 + p._x, _screenY1 + p._y + 8);
-        glEnd();
-      }
-    }
+  if (bAll && !unselected.empty()) {
+    if (bTarget) COLOR_TARGET_LANDMARKS;
+    else         COLOR_SOURCE_LANDMARKS;
+    glVertexPointer(2, GL_FLOAT, 0, unselected.data());
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(unselected.size() / 2));
   }
   // Draw selected landmarks on top
-  for (std::set<int>::const_iterator i = ids.begin(); i != ids.end(); ++i) {
-    if (*i < 0 || *i >= landmarks.Size()) continue;
-    // Adjust colour
+  if (!selected.empty()) {
     if (bTarget) COLOR_SELECTED_TARGET_LANDMARKS;
     else         COLOR_SELECTED_SOURCE_LANDMARKS;
-    // Get landmark point
-    mirtk::Point p = landmarks(*i);
-    // Transform point
-    if (!bTarget && _rview->GetSourceTransformApply()) {
-      const bool inv = !_rview->GetSourceTransformInvert();
-      if (inv) _rview->_sourceTransform->Inverse  (p);
-      else     _rview->_sourceTransform->Transform(p);
-    }
-    // Draw point
-    if (image->IsInFOV(p._x, p._y, p._z)) {
-      image->WorldToImage(p);
-      glBegin(GL_LINES);
-      glVertex2f(_screenX1 + p._x - 8, _screenY1 + p._y);
-      glVertex2f(_screenX1 + p._x + 8, _screenY1 + p._y);
-      glVertex2f(_screenX1 + p._x, _screenY1 + p._y - 8);
-      glVertex2f(_screenX1 + p._x, _screenY1 + p._y + 8);
-      glEnd();
-    }
+    glVertexPointer(2, GL_FLOAT, 0, selected.data());
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(selected.size() / 2));
   }
+  glDisableClientState(GL_VERTEX_ARRAY);
+  _rview->_profiler.Count("GL vertices", static_cast<long>(((bAll ? unselected.size() : 0) + selected.size()) / 2));
 }
 
-void Viewer::DrawCorrespondences(mirtk::PointSet &target, mirtk::PointSet &source, mirtk::GreyImage *image)
+void Viewer::DrawCorrespondences(LandmarkIndex &target, mirtk::PointSet &source, mirtk::GreyImage *image)
 {
-  // Adjust colour
-  glLineWidth(1.0);
-  glColor3f(0, 1, 0);
+  std::vector<int> ids;
 
-  // Draw lines connecting corresponding landmarks
-  mirtk::Point p1, p2;
-  for (int i = 0; i < target.Size(); ++i) {
-    if (i >= source.Size()) continue;
-    p1 = target(i);
-    p2 = source(i);
-    _rview->_sourceTransform->Inverse(p1._x, p1._y, p1._z);
-    if (image->IsInFOV(p1._x, p1._y, p1._z) &&
-        image->IsInFOV(p2._x, p2._y, p2._z)) {
-      image->WorldToImage(p1);
-      image->WorldToImage(p2);
-      glBegin (GL_LINES);
-      glVertex2f(_screenX1 + p1._x, _screenY1 + p1._y);
-      glVertex2f(_screenX1 + p2._x, _screenY1 + p2._y);
-      glEnd();
-    }
-  }
+  // Only target landmarks within the slab of this slice can be connected
+  target.Find(image, ids);
+  std::set<int> visible(ids.begin(), ids.end());
+  this->DrawCorrespondences(target, source, visible, image);
 }
 
-void Viewer::DrawCorrespondences(mirtk::PointSet &target, mirtk::PointSet &source, std::set<int> &ids, mirtk::GreyImage *image)
+void Viewer::DrawCorrespondences(LandmarkIndex &target, mirtk::PointSet &source, std::set<int> &ids, mirtk::GreyImage *image)
 {
-  // Adjust colour
-  glLineWidth(1.0);
-  glColor3f(0, 1, 0);
-
-  // Draw lines connecting corresponding landmarks
   mirtk::Point p1, p2;
+  std::vector<GLfloat> lines;
+
+  // Lines connecting corresponding landmarks
   for (std::set<int>::const_iterator id = ids.begin(); id != ids.end(); ++id) {
     if (*id < 0 || *id >= target.Size() || *id >= source.Size()) continue;
-    p1 = target(*id);
+    p1 = target.Position(*id);
     p2 = source(*id);
-    _rview->_sourceTransform->Inverse(p1._x, p1._y, p1._z);
     if (image->IsInFOV(p1._x, p1._y, p1._z) &&
         image->IsInFOV(p2._x, p2._y, p2._z)) {
       image->WorldToImage(p1);
       image->WorldToImage(p2);
-      glBegin (GL_LINES);
-      glVertex2f(_screenX1 + p1._x, _screenY1 + p1._y);
-      glVertex2f(_screenX1 + p2._x, _screenY1 + p2._y);
-      glEnd();
+      lines.push_back(_screenX1 + p1._x); lines.push_back(_screenY1 + p1._y);
+      lines.push_back(_screenX1 + p2._x); lines.push_back(_screenY1 + p2._y);
     }
   }
+  if (lines.empty()) return;
+
+  // Draw them with a single call
+  glLineWidth(1.0);
+  glColor3f(0, 1, 0);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(2, GL_FLOAT, 0, lines.data());
+  glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(lines.size() / 2));
+  glDisableClientState(GL_VERTEX_ARRAY);
+  _rview->_profiler.Count("GL vertices", static_cast<long>(lines.size() / 2));
 }
 
 void Viewer::DrawImage(Color *drawable)
@@ -958,14 +939,15 @@ void Viewer::DrawROI(mirtk::GreyImage *image, double x1, double y1, double z1,
 
 #ifdef HAVE_VTK
 
-void Viewer::DrawObject(vtkPointSet **object, mirtk::GreyImage *image,
+void Viewer::DrawObjects(ObjectSequence &objects, mirtk::GreyImage *image,
 		int _DisplayObjectWarp,
 		int _DisplayObjectGrid,
-		mirtk::Transformation *transformation)
+		mirtk::Transformation *transformation,
+		unsigned long version)
 {
 	int i;
 
-	for (i = 0; i < _rview->_NoOfObjects; i++) {
+	for (i = 0; i < objects.Size(); i++) {
 		switch (i) {
 			case 0:
 			COLOR_CONTOUR_1;
@@ -985,95 +967,61 @@ void Viewer::DrawObject(vtkPointSet **object, mirtk::GreyImage *image,
 		}
 
         glLineWidth(_rview->GetLineThickness());
-		this->DrawObject(object[i], image, _DisplayObjectWarp, _DisplayObjectGrid, transformation);
+		this->DrawObject(objects.Get(i), image, _DisplayObjectWarp, _DisplayObjectGrid, transformation, version);
 	}
 }
 
-void Viewer::DrawObject(vtkPointSet *points, mirtk::GreyImage *image, int warp, int grid, mirtk::Transformation *transformation)
+void Viewer::DrawObject(SurfaceCutter *object, mirtk::GreyImage *image, int warp, int, mirtk::Transformation *transformation, unsigned long version)
 {
-	int i, j;
-	double p1[3], p2[3], p3[3], v1[3], v2[3], point[3], normal[3];
-	mirtk::Point p;
-	static vtkPlane *plane = vtkPlane::New();
-	static vtkCutter *cutter = vtkCutter::New();
-
-	if (points != NULL) {
-		p1[0] = 0;
-		p1[1] = 0;
-		p1[2] = 0;
-		p2[0] = image->GetX();
-		p2[1] = 0;
-		p2[2] = 0;
-		p3[0] = 0;
-		p3[1] = image->GetY();
-		p3[2] = 0;
-		image->ImageToWorld(p1[0], p1[1], p1[2]);
-		image->ImageToWorld(p2[0], p2[1], p2[2]);
-		image->ImageToWorld(p3[0], p3[1], p3[2]);
-		v1[0] = p2[0] - p1[0];
-		v1[1] = p2[1] - p1[1];
-		v1[2] = p2[2] - p1[2];
-		v2[0] = p3[0] - p1[0];
-		v2[1] = p3[1] - p1[1];
-		v2[2] = p3[2] - p1[2];
-		normal[0] = v1[1] * v2[2] - v1[2] * v2[1];
-		normal[1] = v1[2] * v2[0] - v1[0] * v2[2];
-		normal[2] = v1[0] * v2[1] - v1[1] * v2[0];
-
-		// Set up plane and cutter
-		plane->SetOrigin(p1);
-		plane->SetNormal(normal);
-		cutter->SetCutFunction(plane);
-		cutter->SetInputData(points);
-
-		// Reslice object
-		cutter->Modified();
-		cutter->Update();
-
-		// Loop over cells
-		for (i = 0; i < cutter->GetOutput()->GetNumberOfCells(); i++) {
-			// Get pointIds from cell
-			vtkIdList *ids = cutter->GetOutput()->GetCell(i)->GetPointIds();
-			mirtk::PointSet pset;
-			for (j = 0; j < ids->GetNumberOfIds(); j++) {
-
-				// Get point from cell
-				cutter->GetOutput()->GetPoints()->GetPoint(ids->GetId(j), point);
-
-				// Transform the point if warp is on
-				if(warp && transformation != NULL) {
-					transformation->Transform(point[0], point[1], point[2]);
-				}
-
-				// Get point in image coordinates
-				image->WorldToImage(point[0], point[1], point[2]);
-				switch (_viewerMode) {
-					case Viewer_XY:
-					p = mirtk::Point(point[0], point[1], 0);
-					break;
-					case Viewer_YZ:
-					p = mirtk::Point(point[0], point[1], 0);
-					break;
-					case Viewer_XZ:
-					p = mirtk::Point(point[0], point[1], 0);
-					break;
-					default:
-					break;
-				}
-				pset.Add(p);
-			}
-
-			// Now draw
-			for (j = 0; j < pset.Size(); j++) {
-				glBegin(GL_LINES);
-				glVertex2f(_screenX1+pset(j)._x,
-						_screenY1+pset(j)._y);
-				glVertex2f(_screenX1+pset((j+1)%pset.Size())._x,
-						_screenY1+pset((j+1)%pset.Size())._y);
-				glEnd();
-			}
-		}
+	size_t i;
+	double origin[3], p1[3], p2[3], v1[3], v2[3], normal[3], point[3];
+	std::vector<GLfloat> lines;
+
+	if (object == NULL || object->GetObject() == NULL) return;
+
+	// Plane of the slice
+	origin[0] = 0;
+	origin[1] = 0;
+	origin[2] = 0;
+	p1[0] = image->GetX();
+	p1[1] = 0;
+	p1[2] = 0;
+	p2[0] = 0;
+	p2[1] = image->GetY();
+	p2[2] = 0;
+	image->ImageToWorld(origin[0], origin[1], origin[2]);
+	image->ImageToWorld(p1[0], p1[1], p1[2]);
+	image->ImageToWorld(p2[0], p2[1], p2[2]);
+	v1[0] = p1[0] - origin[0];
+	v1[1] = p1[1] - origin[1];
+	v1[2] = p1[2] - origin[2];
+	v2[0] = p2[0] - origin[0];
+	v2[1] = p2[1] - origin[1];
+	v2[2] = p2[2] - origin[2];
+	normal[0] = v1[1] * v2[2] - v1[2] * v2[1];
+	normal[1] = v1[2] * v2[0] - v1[0] * v2[2];
+	normal[2] = v1[0] * v2[1] - v1[1] * v2[0];
+
+	// Cut object, only recomputed if plane or transformation changed
+	if (!warp) transformation = NULL;
+	const std::vector<double> &segments = object->Run(origin, normal, transformation, version);
+	if (segments.empty()) return;
+
+	// Draw line segments with a single call
+	lines.resize(2 * (segments.size() / 3));
+	for (i = 0; i < segments.size() / 3; i++) {
+		point[0] = segments[3*i];
+		point[1] = segments[3*i+1];
+		point[2] = segments[3*i+2];
+		image->WorldToImage(point[0], point[1], point[2]);
+		lines[2*i]   = _screenX1 + point[0];
+		lines[2*i+1] = _screenY1 + point[1];
 	}
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, lines.data());
+	glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(lines.size() / 2));
+	glDisableClientState(GL_VERTEX_ARRAY);
+	_rview->_profiler.Count("GL vertices", static_cast<long>(lines.size() / 2));
 }
 
 #endif
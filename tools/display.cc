@@ -17,10 +17,28 @@
  */
 
 #include <mirtk/Transformation.h>
+#include <mirtk/Transformations.h>
 #include <mirtk/Registration.h>
 
 #include <mirtk/OpenGl.h>
 #include <mirtk/RView.h>
+#include <mirtk/MappedImage.h>
+#include <mirtk/TransformationSequence.h>
+
+#include <deque>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+  #include <csignal>
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/un.h>
+  #include <unistd.h>
+#endif
 
 #ifdef __APPLE__
   #include <glut.h>
@@ -31,6 +49,9 @@
 RView *rview;
 
 char *offscreen_file;
+char *batch_file;
+int batch_threads;
+char *server_socket;
 int target_min, target_max, target_delta;
 int source_min, source_max, source_delta;
 
@@ -39,7 +60,7 @@ void usage ()
 {
   cerr << "Usage: display [target] <source <dofin>> <options>\n";
   cerr << "Where <options> can be one or more of the following:\n";
-  cerr << "\t<-config           file.cnf>     Rview configuration file\n";
+  cerr << "\t<-config           file.cnf>     Rview session or configuration file\n";
   cerr << "\t<-target_landmarks file.vtk>     Target Landmarks (vtkPolyData)\n";
   cerr << "\t<-source_landmarks file.vtk>     Source Landmarks (vtkPolyData)\n";
   cerr << "\t<-target_isolines>               Target isolines\n";
@@ -62,6 +83,7 @@ void usage ()
   cerr << "\t<-arrow>                         Deformation arrows on\n";
   cerr << "\t<-level value>                   Deformation level\n";
   cerr << "\t<-res   value>                   Resolution factor\n";
+  cerr << "\t<-pyramid>                       Downsample memory-mapped images when zoomed out\n";
   cerr << "\t<-nn>                            Nearest neighbour interpolation (default)\n";
   cerr << "\t<-linear>                        Linear interpolation\n";
   cerr << "\t<-c1spline>                      C1-spline interpolation\n";
@@ -90,7 +112,16 @@ void usage ()
   cerr << "\tDisplay specific options:\n";
   cerr << "\t<-x value>                       Width\n";
   cerr << "\t<-y value>                       Height\n";
-  cerr << "\t<-offscreen>                     Offscreen rendering\n\n";
+  cerr << "\t<-offscreen>                     Offscreen rendering\n";
+  cerr << "\t<-batch           file.txt>     Offscreen rendering of each job in file, one per line:\n";
+  cerr << "\t                                target source dofin x y z view lut output\n";
+  cerr << "\t                                where view is e.g. xy_xz_v and lut e.g. red, and '-' selects\n";
+  cerr << "\t                                no source or dofin, the image center, or the current view or lut\n";
+  cerr << "\t<-threads value>                 Number of threads reading and writing batch images\n";
+#ifndef _WIN32
+  cerr << "\t<-server          socket>       Serve render requests on local socket, see serve()\n";
+#endif
+  cerr << "\n";
   cerr << "\tMouse events:\n";
   cerr << "\tLeft mouse click :               Reslice\n\n";
   rview->cb_special_info();
@@ -118,6 +149,7 @@ void mouse(int button, int state, int x, int y)
   if (button == GLUT_LEFT_BUTTON) {
     rview->SetOrigin(x, y);
     rview->Update();
+    if (rview->UpdatePyramids(true)) rview->Update();
     rview->Draw();
     glutSwapBuffers();
 
@@ -143,6 +175,410 @@ void keyboard(unsigned char key, int, int)
   return;
 }
 
+/// Snapshot to be rendered in batch mode
+struct SnapshotJob
+{
+  std::string target, source, dofin, view, lut, output;
+  double x, y, z;
+  bool origin;
+};
+
+/// Read image of batch job, called by reader threads
+mirtk::Image *read_image(std::string name)
+{
+  if (name == "-") return new mirtk::GreyImage;
+  mirtk::Image *image = ReadMappedImage(name.c_str());
+  if (image == nullptr) image = mirtk::Image::New(name.c_str());
+  return image;
+}
+
+/// Write snapshot of batch job, called by writer threads
+void write_snapshot(std::vector<unsigned char> buffer, int width, int height, std::string name)
+{
+  int i, n;
+  unsigned char *ptr;
+
+  // Convert to planar RGB image
+  mirtk::GenericImage<unsigned char> image(width, height, 3, 1);
+  n = width * height;
+  ptr = image.GetPointerToVoxels();
+  for (i = 0; i < n; i++) {
+    ptr[i]     = buffer[3*i];
+    ptr[i+n]   = buffer[3*i+1];
+    ptr[i+2*n] = buffer[3*i+2];
+  }
+  image.Write(name.c_str());
+}
+
+/// Viewer configuration of given name, NULL if unknown
+RViewConfig *view_config(const std::string &name)
+{
+  if (name == "xy")          return View_XY;
+  if (name == "xz")          return View_XZ;
+  if (name == "yz")          return View_YZ;
+  if (name == "xy_xz_v")     return View_XY_XZ_v;
+  if (name == "xy_yz_v")     return View_XY_YZ_v;
+  if (name == "xz_yz_v")     return View_XZ_YZ_v;
+  if (name == "xy_xz_h")     return View_XY_XZ_h;
+  if (name == "xy_yz_h")     return View_XY_YZ_h;
+  if (name == "xz_yz_h")     return View_XZ_YZ_h;
+  if (name == "ab_xy_v")     return View_AB_XY_v;
+  if (name == "ab_xz_v")     return View_AB_XZ_v;
+  if (name == "ab_yz_v")     return View_AB_YZ_v;
+  if (name == "ab_xy_xz_v")  return View_AB_XY_XZ_v;
+  if (name == "ab_xy_h")     return View_AB_XY_h;
+  if (name == "ab_xz_h")     return View_AB_XZ_h;
+  if (name == "ab_yz_h")     return View_AB_YZ_h;
+  if (name == "ab_xy_xz_h")  return View_AB_XY_XZ_h;
+  return NULL;
+}
+
+/// Set color mode of lookup table, returns false if name is unknown
+bool set_color_mode(LookupTable *lut, const std::string &name)
+{
+  if (name == "luminance") {
+    lut->SetColorModeToLuminance();
+  } else if (name == "inverse") {
+    lut->SetColorModeToInverseLuminance();
+  } else if (name == "red") {
+    lut->SetColorModeToRed();
+  } else if (name == "green") {
+    lut->SetColorModeToGreen();
+  } else if (name == "blue") {
+    lut->SetColorModeToBlue();
+  } else if (name == "rainbow") {
+    lut->SetColorModeToRainbow();
+  } else if (name == "hotmetal") {
+    lut->SetColorModeToHotMetal();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/// Read batch jobs, one per line, ignoring empty lines and comments
+std::vector<SnapshotJob> read_jobs(const char *name)
+{
+  int line;
+  std::string buffer, x, y, z;
+  std::vector<SnapshotJob> jobs;
+  LookupTable lut;
+
+  std::ifstream from(name);
+  if (!from) {
+    cerr << "display: Can't open file " << name << endl;
+    exit(1);
+  }
+  for (line = 1; std::getline(from, buffer); line++) {
+    if (buffer.find_first_not_of(" \t\r") == std::string::npos || buffer[0] == '#') continue;
+    SnapshotJob job;
+    std::istringstream is(buffer);
+    if (!(is >> job.target >> job.source >> job.dofin >> x >> y >> z >> job.view >> job.lut >> job.output)) {
+      cerr << "display: Invalid job in line " << line << " of file " << name << endl;
+      exit(1);
+    }
+    if (job.view != "-" && view_config(job.view) == NULL) {
+      cerr << "display: Unknown view " << job.view << " in line " << line << " of file " << name << endl;
+      exit(1);
+    }
+    if (job.lut != "-" && !set_color_mode(&lut, job.lut)) {
+      cerr << "display: Unknown lookup table " << job.lut << " in line " << line << " of file " << name << endl;
+      exit(1);
+    }
+    job.origin = (x != "-" && y != "-" && z != "-");
+    if (job.origin) {
+      job.x = atof(x.c_str());
+      job.y = atof(y.c_str());
+      job.z = atof(z.c_str());
+    }
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+/// Render snapshots of all batch jobs
+///
+/// Jobs are rendered one after another as there is only one GL context,
+/// but images which are used by consecutive jobs are only read once, the
+/// images and transformations of the next jobs are read ahead by reader
+/// threads, and snapshots are written by writer threads.
+void batch()
+{
+  int i, j, n, w, h, next;
+  double x, y, z;
+
+  std::vector<SnapshotJob> jobs = read_jobs(batch_file);
+  n = static_cast<int>(jobs.size());
+
+  // Images and transformations which differ from those of the previous job
+  std::vector<bool> new_target(n), new_source(n), new_dofin(n);
+  std::vector<int> dofin(n, -1);
+  TransformationSequence sequence(batch_threads, batch_threads);
+  for (i = 0; i < n; i++) {
+    new_target[i] = (i == 0 || jobs[i].target != jobs[i-1].target);
+    new_source[i] = (i == 0 || jobs[i].source != jobs[i-1].source);
+    new_dofin [i] = (i == 0 || jobs[i].dofin  != jobs[i-1].dofin);
+    if (new_dofin[i] && jobs[i].dofin != "-") {
+      dofin[i] = sequence.Size();
+      sequence.Add(jobs[i].dofin.c_str());
+    }
+  }
+
+  std::vector<std::future<mirtk::Image *> > target(n), source(n);
+  std::deque<std::future<void> > writer;
+  std::vector<unsigned char> buffer;
+
+  next = 0;
+  for (i = 0; i < n; i++) {
+
+    // Read images of upcoming jobs in the background
+    for (; next < n && next <= i + batch_threads; next++) {
+      if (new_target[next]) {
+        target[next] = std::async(std::launch::async, read_image, jobs[next].target);
+      }
+      if (new_source[next]) {
+        source[next] = std::async(std::launch::async, read_image, jobs[next].source);
+      }
+    }
+
+    // Replace images and transformation which differ from previous job.
+    // The exact intensity range of memory-mapped images is computed before
+    // rendering, such that snapshots do not depend on the voxels sampled.
+    if (new_target[i]) rview->SetTarget(target[i].get());
+    if (new_source[i]) rview->SetSource(source[i].get());
+    if (new_target[i] || new_source[i]) {
+      while (rview->RefineIntensityRange());
+    }
+    if (new_dofin[i]) {
+      if (dofin[i] >= 0) {
+        rview->SwapTransformation(sequence.Get(dofin[i]));
+      } else {
+        rview->SwapTransformation(new mirtk::AffineTransformation);
+      }
+    }
+
+    // Configure viewer, keeping the current view and lookup table otherwise
+    if (jobs[i].view != "-") rview->Configure(view_config(jobs[i].view));
+    if (jobs[i].lut  != "-") set_color_mode(rview->GetTargetLookupTable(), jobs[i].lut);
+    if (jobs[i].origin) {
+      rview->SetOrigin(jobs[i].x, jobs[i].y, jobs[i].z);
+    } else {
+      mirtk::Image *image = rview->GetTarget();
+      x = (image->GetX() - 1) / 2.0;
+      y = (image->GetY() - 1) / 2.0;
+      z = (image->GetZ() - 1) / 2.0;
+      image->ImageToWorld(x, y, z);
+      rview->SetOrigin(x, y, z);
+    }
+
+    // Render snapshot from the pyramid level matching the resolution
+    rview->Update();
+    if (rview->UpdatePyramids(true)) rview->Update();
+    w = rview->GetWidth();
+    h = rview->GetHeight();
+    buffer.resize(3 * w * h);
+    rview->DrawOffscreen(buffer.data());
+
+    // Write snapshot in the background, waiting for the oldest writer
+    // when too many snapshots are pending
+    while (static_cast<int>(writer.size()) >= batch_threads) {
+      writer.front().get();
+      writer.pop_front();
+    }
+    writer.push_back(std::async(std::launch::async, write_snapshot, buffer, w, h, jobs[i].output));
+  }
+  for (j = 0; j < static_cast<int>(writer.size()); j++) writer[j].get();
+}
+
+#ifndef _WIN32
+
+/// Send reply to client
+bool send_reply(int fd, const void *data, size_t n)
+{
+  ssize_t m;
+  const char *ptr = static_cast<const char *>(data);
+
+  while (n > 0) {
+    m = send(fd, ptr, n, 0);
+    if (m <= 0) return false;
+    ptr += m;
+    n   -= m;
+  }
+  return true;
+}
+
+/// Send text reply to client
+bool send_reply(int fd, const std::string &reply)
+{
+  return send_reply(fd, reply.data(), reply.size());
+}
+
+/// Whether file can be opened for reading
+bool readable(const std::string &name)
+{
+  std::ifstream from(name.c_str());
+  return static_cast<bool>(from);
+}
+
+/// Execute command of render client, returns false if the session ends
+bool serve_command(int fd, const std::string &line, std::vector<unsigned char> &buffer, bool &shutdown)
+{
+  int w, h, t;
+  double x, y, z;
+  std::string command, arg;
+
+  std::istringstream is(line);
+  if (!(is >> command)) return true;
+
+  if (command == "target" || command == "source") {
+    if (!(is >> arg) || !readable(arg)) return send_reply(fd, "ERROR Cannot read image\n");
+    if (command == "target") {
+      rview->SetTarget(read_image(arg));
+    } else {
+      rview->SetSource(read_image(arg));
+    }
+    // Exact intensity range, such that snapshots do not depend on the voxels
+    // sampled for the initial estimate of memory-mapped images
+    while (rview->RefineIntensityRange());
+  } else if (command == "dofin") {
+    if (!(is >> arg)) return send_reply(fd, "ERROR Missing transformation\n");
+    if (arg == "-") {
+      rview->SwapTransformation(new mirtk::AffineTransformation);
+    } else {
+      if (!readable(arg)) return send_reply(fd, "ERROR Cannot read transformation\n");
+      std::vector<char> name(arg.begin(), arg.end());
+      name.push_back('\0');
+      rview->ReadTransformation(name.data());
+    }
+  } else if (command == "origin") {
+    if (!(is >> x >> y >> z)) return send_reply(fd, "ERROR Invalid origin\n");
+    rview->SetOrigin(x, y, z);
+  } else if (command == "frame") {
+    if (!(is >> t) || t < 0 || t >= rview->GetTarget()->GetT()) {
+      return send_reply(fd, "ERROR Invalid frame\n");
+    }
+    if (!rview->GetSource()->IsEmpty() && t >= rview->GetSource()->GetT()) {
+      return send_reply(fd, "ERROR Invalid source frame\n");
+    }
+    rview->SetTargetFrame(t);
+    rview->SetSourceFrame(t);
+  } else if (command == "view") {
+    if (!(is >> arg) || view_config(arg) == NULL) return send_reply(fd, "ERROR Unknown view\n");
+    rview->Configure(view_config(arg));
+  } else if (command == "mode") {
+    is >> arg;
+    if      (arg == "target")   rview->SetViewMode(View_A);
+    else if (arg == "source")   rview->SetViewMode(View_B);
+    else if (arg == "mix")      rview->SetViewMode(View_Checkerboard);
+    else if (arg == "diff")     rview->SetViewMode(View_Subtraction);
+    else if (arg == "hshutter") rview->SetViewMode(View_HShutter);
+    else if (arg == "vshutter") rview->SetViewMode(View_VShutter);
+    else return send_reply(fd, "ERROR Unknown view mode\n");
+  } else if (command == "lut") {
+    if (!(is >> arg) || !set_color_mode(rview->GetTargetLookupTable(), arg)) {
+      return send_reply(fd, "ERROR Unknown lookup table\n");
+    }
+  } else if (command == "snapshot") {
+    rview->Update();
+    if (rview->UpdatePyramids(true)) rview->Update();
+    w = rview->GetWidth();
+    h = rview->GetHeight();
+    buffer.resize(3 * w * h);
+    rview->DrawOffscreen(buffer.data());
+
+    // Binary PPM image, preceded by its size in bytes
+    std::ostringstream header;
+    header << "P6\n" << w << " " << h << "\n255\n";
+    std::ostringstream reply;
+    reply << "IMAGE " << header.str().size() + buffer.size() << "\n" << header.str();
+    return send_reply(fd, reply.str()) && send_reply(fd, buffer.data(), buffer.size());
+  } else if (command == "quit") {
+    send_reply(fd, "OK\n");
+    return false;
+  } else if (command == "shutdown") {
+    send_reply(fd, "OK\n");
+    shutdown = true;
+    return false;
+  } else {
+    return send_reply(fd, "ERROR Unknown command " + command + "\n");
+  }
+  return send_reply(fd, "OK\n");
+}
+
+/// Serve render requests on local socket
+///
+/// Clients send one command per line and receive a reply line for each,
+/// "OK" or "ERROR <message>". The commands are
+///
+///   target <file>, source <file>, dofin <file | ->, origin <x> <y> <z>,
+///   frame <t>, view <name>, mode <target | source | mix | diff | hshutter |
+///   vshutter>, lut <name>, snapshot, quit, shutdown
+///
+/// where view and lut take the names of the batch mode. The reply to
+/// snapshot is "IMAGE <n>" followed by n bytes of a binary PPM image.
+/// Sessions are served one after another by the same viewer, such that
+/// images and settings of a previous session remain loaded. The
+/// display_client tool sends commands and saves the snapshots.
+void serve()
+{
+  int server, client;
+  bool session, shutdown;
+  char data[4096];
+  ssize_t n;
+  size_t pos;
+  std::string pending;
+  std::vector<unsigned char> buffer;
+  struct sockaddr_un addr;
+  struct stat st;
+
+  if (strlen(server_socket) >= sizeof(addr.sun_path)) {
+    cerr << "display: Socket name too long: " << server_socket << endl;
+    exit(1);
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, server_socket);
+
+  // Remove stale socket of a previous server, but no other kind of file
+  if (lstat(server_socket, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      cerr << "display: Refusing to replace " << server_socket << ", which is not a socket" << endl;
+      exit(1);
+    }
+    unlink(server_socket);
+  }
+
+  server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server == -1 || bind(server, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      listen(server, 4) != 0) {
+    cerr << "display: Cannot listen on socket " << server_socket << endl;
+    exit(1);
+  }
+
+  // Clients which disconnect early must not terminate the server
+  signal(SIGPIPE, SIG_IGN);
+
+  shutdown = false;
+  while (!shutdown) {
+    client = accept(server, NULL, NULL);
+    if (client == -1) continue;
+    pending.clear();
+    session = true;
+    while (session && (n = recv(client, data, sizeof(data), 0)) > 0) {
+      pending.append(data, n);
+      while (session && (pos = pending.find('\n')) != std::string::npos) {
+        session = serve_command(client, pending.substr(0, pos), buffer, shutdown);
+        pending.erase(0, pos + 1);
+      }
+    }
+    close(client);
+  }
+  close(server);
+  unlink(server_socket);
+}
+
+#endif
+
 int main(int argc, char** argv)
 {
   int i, x, y;
@@ -153,6 +589,9 @@ int main(int argc, char** argv)
   x = 512;
   y = 512;
   offscreen = false;
+  batch_file = NULL;
+  server_socket = NULL;
+  batch_threads = 2;
   for (i = 0; i < argc-1; i++) {
     if (strcmp(argv[i], "-x") == 0) {
       x = atoi(argv[i+1]);
@@ -235,7 +674,7 @@ int main(int argc, char** argv)
     if (!ok && strcmp(argv[1], "-config") == 0) {
       argc--;
       argv++;
-      rview->Read(argv[1]);
+      if (!rview->Read(argv[1])) exit(1);
       argc--;
       argv++;
       ok = true;
@@ -275,7 +714,7 @@ int main(int argc, char** argv)
       argc--;
       argv++;
       do {
-        rview->ReadObject(argv[1]);
+        if (!rview->ReadObject(argv[1])) exit(1);
         argc--;
         argv++;
       } while ((argc > 1) && (argv[1][0] != '-'));
@@ -485,6 +924,12 @@ int main(int argc, char** argv)
       argv++;
       ok = true;
     }
+    if (!ok && (strcmp(argv[1], "-pyramid") == 0)) {
+      argc--;
+      argv++;
+      rview->PyramidOn();
+      ok = true;
+    }
     if (!ok && (strcmp(argv[1], "-grid_res") == 0)) {
       argc--;
       argv++;
@@ -697,6 +1142,33 @@ int main(int argc, char** argv)
       argv++;
       ok = true;
     }
+    if (!ok && (strcmp(argv[1], "-batch") == 0)) {
+      argv++;
+      argc--;
+      batch_file = argv[1];
+      argv++;
+      argc--;
+      ok = true;
+    }
+#ifndef _WIN32
+    if (!ok && (strcmp(argv[1], "-server") == 0)) {
+      argv++;
+      argc--;
+      server_socket = argv[1];
+      argv++;
+      argc--;
+      ok = true;
+    }
+#endif
+    if (!ok && (strcmp(argv[1], "-threads") == 0)) {
+      argv++;
+      argc--;
+      batch_threads = atoi(argv[1]);
+      if (batch_threads < 1) batch_threads = 1;
+      argv++;
+      argc--;
+      ok = true;
+    }
     if (!ok && (strcmp(argv[1], "-offscreen") == 0)) {
       offscreen = true;
       argv++;
@@ -712,6 +1184,9 @@ int main(int argc, char** argv)
     }
   }
 
+  // Exact intensity range of memory-mapped images
+  while (rview->RefineIntensityRange());
+
   // Initilaize min/max/delta values for special function keys
   target_min   = rview->GetTargetMin();
   target_max   = rview->GetTargetMax();
@@ -727,7 +1202,19 @@ int main(int argc, char** argv)
   glutInitWindowPosition(0, 0);
   glutCreateWindow("MIRTK Viewer");
 
-  if (offscreen) {
+  if (batch_file != NULL) {
+
+    // Render each job to file
+    batch();
+
+#ifndef _WIN32
+  } else if (server_socket != NULL) {
+
+    // Render on request of clients
+    serve();
+
+#endif
+  } else if (offscreen) {
 
     // Start rendering to file
     rview->DrawOffscreen(offscreen_file);
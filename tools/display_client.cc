@@ -0,0 +1,161 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+int server;
+std::string pending;
+
+
+void usage()
+{
+  cerr << "Usage: display_client <socket> <commands>\n";
+  cerr << "Sends commands to a render server started with display -server <socket>\n";
+  cerr << "and prints the reply to each. Every argument is sent as one command line,\n";
+  cerr << "e.g., \"target image.nii.gz\" \"view xy\" snapshot. Snapshots are saved as\n";
+  cerr << "binary PPM images named snapshot_<n>.ppm unless preceded by the option:\n";
+  cerr << "\t<-o file>                        Output file of next snapshot\n";
+  exit(1);
+}
+
+/// Send all bytes of a command line
+bool send_line(const std::string &line)
+{
+  const char *ptr = line.data();
+  size_t n = line.size();
+  ssize_t m;
+
+  while (n > 0) {
+    m = send(server, ptr, n, 0);
+    if (m <= 0) return false;
+    ptr += m;
+    n   -= m;
+  }
+  return true;
+}
+
+/// Receive more data from server, returns false if it closed the connection
+bool receive()
+{
+  char data[65536];
+  ssize_t n;
+
+  n = recv(server, data, sizeof(data), 0);
+  if (n <= 0) return false;
+  pending.append(data, n);
+  return true;
+}
+
+/// Receive reply line without the line break
+bool receive_line(std::string &line)
+{
+  size_t pos;
+
+  while ((pos = pending.find('\n')) == std::string::npos) {
+    if (!receive()) return false;
+  }
+  line = pending.substr(0, pos);
+  pending.erase(0, pos + 1);
+  return true;
+}
+
+/// Receive given number of bytes
+bool receive_data(std::string &data, size_t n)
+{
+  while (pending.size() < n) {
+    if (!receive()) return false;
+  }
+  data = pending.substr(0, n);
+  pending.erase(0, n);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  int i, snapshot;
+  bool ok;
+  size_t n;
+  FILE *fp;
+  std::string reply, image, output;
+  struct sockaddr_un addr;
+
+  if (argc < 3) usage();
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+    cerr << "display_client: Socket name too long: " << argv[1] << endl;
+    exit(1);
+  }
+  strcpy(addr.sun_path, argv[1]);
+  server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server == -1 || connect(server, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+    cerr << "display_client: Cannot connect to socket " << argv[1] << endl;
+    exit(1);
+  }
+
+  ok       = true;
+  snapshot = 0;
+  for (i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0) {
+      if (++i == argc) usage();
+      output = argv[i];
+      continue;
+    }
+    if (!send_line(std::string(argv[i]) + "\n") || !receive_line(reply)) {
+      cerr << "display_client: Connection closed by server" << endl;
+      exit(1);
+    }
+    if (reply.compare(0, 6, "IMAGE ") == 0) {
+      n = strtoul(reply.c_str() + 6, NULL, 10);
+      if (!receive_data(image, n)) {
+        cerr << "display_client: Connection closed by server" << endl;
+        exit(1);
+      }
+      if (output.empty()) output = "snapshot_" + std::to_string(snapshot) + ".ppm";
+      fp = fopen(output.c_str(), "wb");
+      if (fp == NULL || fwrite(image.data(), 1, n, fp) != n) {
+        cerr << "display_client: Cannot write file " << output << endl;
+        ok = false;
+      }
+      if (fp != NULL) fclose(fp);
+      cout << argv[i] << ": " << output << endl;
+      output.clear();
+      snapshot++;
+    } else {
+      cout << argv[i] << ": " << reply << endl;
+      if (reply.compare(0, 5, "ERROR") == 0) ok = false;
+    }
+  }
+  close(server);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <mirtk/Transformation.h>
+
+using std::cerr;
+using std::endl;
+
+
+void usage()
+{
+  cerr << "Usage: publish_dofs <socket> <dofin>... <options>\n";
+  cerr << "Stand-in for a registration displayed by view -monitor <socket>. Sends the\n";
+  cerr << "DOFs of the given transformations in turn, interpolating linearly between\n";
+  cerr << "consecutive ones, such as the outputs of the levels of a registration.\n";
+  cerr << "All must have as many DOFs as the transformation displayed by the viewer.\n";
+  cerr << "\t<-steps n>                       Snapshots from one transformation to the next (default 25)\n";
+  cerr << "\t<-rate value>                    Snapshots per second (default 50)\n";
+  cerr << "\t<-loop>                          Repeat until interrupted\n";
+  exit(1);
+}
+
+/// Send snapshot as one line of DOF values
+bool send_dofs(int server, const std::vector<double> &dofs)
+{
+  char value[32];
+  const char *ptr;
+  size_t i, n;
+  ssize_t m;
+  std::string line;
+
+  for (i = 0; i < dofs.size(); i++) {
+    snprintf(value, sizeof(value), (i > 0) ? " %.17g" : "%.17g", dofs[i]);
+    line += value;
+  }
+  line += '\n';
+  ptr = line.data();
+  n   = line.size();
+  while (n > 0) {
+    m = send(server, ptr, n, MSG_NOSIGNAL);
+    if (m <= 0) return false;
+    ptr += m;
+    n   -= m;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  int i, j, k, n, server, steps;
+  bool loop;
+  double rate, w;
+  std::vector<std::vector<double> > dofs;
+  std::vector<double> snapshot;
+  std::string first;
+  struct sockaddr_un addr;
+
+  if (argc < 3) usage();
+
+  // Parse arguments
+  steps = 25;
+  rate  = 50;
+  loop  = false;
+  for (i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-steps") == 0) {
+      if (++i == argc) usage();
+      steps = atoi(argv[i]);
+      if (steps < 1) usage();
+    } else if (strcmp(argv[i], "-rate") == 0) {
+      if (++i == argc) usage();
+      rate = atof(argv[i]);
+      if (rate <= 0) usage();
+    } else if (strcmp(argv[i], "-loop") == 0) {
+      loop = true;
+    } else if (argv[i][0] == '-') {
+      usage();
+    } else {
+      mirtk::Transformation *transform = mirtk::Transformation::New(argv[i]);
+      if (!dofs.empty() && transform->NumberOfDOFs() != static_cast<int>(dofs[0].size())) {
+        cerr << "publish_dofs: Transformation " << argv[i] << " has " << transform->NumberOfDOFs()
+             << " DOFs, but " << first << " has " << dofs[0].size() << endl;
+        exit(1);
+      }
+      if (dofs.empty()) first = argv[i];
+      dofs.push_back(std::vector<double>(transform->NumberOfDOFs()));
+      for (j = 0; j < transform->NumberOfDOFs(); j++) dofs.back()[j] = transform->Get(j);
+      delete transform;
+    }
+  }
+  if (dofs.empty()) usage();
+
+  // Connect to viewer
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+    cerr << "publish_dofs: Socket name too long: " << argv[1] << endl;
+    exit(1);
+  }
+  strcpy(addr.sun_path, argv[1]);
+  server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server == -1 || connect(server, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+    cerr << "publish_dofs: Cannot connect to socket " << argv[1] << endl;
+    exit(1);
+  }
+
+  // Send snapshots at the given rate, the viewer drops those it cannot display
+  n = static_cast<int>(dofs.size());
+  snapshot.resize(dofs[0].size());
+  do {
+    for (i = 0; i < n; i++) {
+      for (k = 0; k < ((i + 1 < n) ? steps : 1); k++) {
+        w = static_cast<double>(k) / steps;
+        for (j = 0; j < static_cast<int>(snapshot.size()); j++) {
+          snapshot[j] = dofs[i][j];
+          if (w > 0) snapshot[j] += w * (dofs[i+1][j] - dofs[i][j]);
+        }
+        if (!send_dofs(server, snapshot)) {
+          cerr << "publish_dofs: Connection closed by viewer" << endl;
+          exit(1);
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(1.0 / rate));
+      }
+    }
+  } while (loop);
+  close(server);
+
+  return 0;
+}
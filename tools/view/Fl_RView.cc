@@ -20,6 +20,10 @@
 #include <mirtk/Transformation.h>
 #include <mirtk/Registration.h>
 
+#include <FL/gl.h>
+
+#include <sstream>
+
 #include "Fl_RView.h"
 #include "Fl_RViewUI.h"
 
@@ -28,6 +32,8 @@ extern Fl_RViewUI *rviewUI;
 Fl_RView::Fl_RView(int x, int y, int w, int h, const char *name) : Fl_Gl_Window(x, y, w, h, name)
 {
   v = new RView(w, h);
+  hud = false;
+  v->SetUpdateCallback(cb_updated, this);
   // See https://www.fltk.org/doc-1.3/osissues.html#osissues_macos, section "OpenGL and 'retina' displays"
   #if FL_API_VERSION >= 10304
     Fl::use_high_res_GL(1);
@@ -36,10 +42,56 @@ Fl_RView::Fl_RView(int x, int y, int w, int h, const char *name) : Fl_Gl_Window(
 
 void Fl_RView::draw()
 {
+  v->Lock();
   if (!valid()) {
     v->Resize(pixel_w(), pixel_h());
   }
   v->Draw();
+  if (hud) this->draw_hud();
+  v->Unlock();
+}
+
+void Fl_RView::draw_hud()
+{
+  int y;
+  std::string line;
+
+  std::istringstream report(v->GetProfiler().Report());
+  gl_font(FL_COURIER, 12);
+  gl_color(FL_YELLOW);
+  y = pixel_h() - 16;
+  while (std::getline(report, line)) {
+    gl_draw(line.c_str(), 8, y);
+    y -= 14;
+  }
+}
+
+void Fl_RView::begin_interaction()
+{
+  v->BeginInteraction();
+  Fl::remove_timeout(cb_refine, this);
+  Fl::add_timeout(0.25, cb_refine, this);
+}
+
+void Fl_RView::cb_refine(void *data)
+{
+  RView *v = reinterpret_cast<Fl_RView *>(data)->v;
+
+  // Timeouts are not dispatched as events, guard against background update
+  v->Lock();
+  v->EndInteraction();
+  v->UpdateAsync();
+  v->Unlock();
+}
+
+void Fl_RView::cb_updated(void *data)
+{
+  Fl::awake(cb_awake, data);
+}
+
+void Fl_RView::cb_awake(void *data)
+{
+  reinterpret_cast<Fl_RView *>(data)->redraw();
 }
 
 int Fl_RView::handle(int event)
@@ -103,6 +155,15 @@ int Fl_RView::handle(int event)
       return 1;
 #endif
     }
+    if (Fl::event_text()[0] == 'P') {
+      // Stage timings are only recorded while displayed, unless requested
+      // by the environment (see Profiler)
+      hud = !hud;
+      v->GetProfiler().Reset();
+      v->GetProfiler().Enable(hud || v->GetProfiler().IsEnabledByEnvironment());
+      this->redraw();
+      return 1;
+    }
     v->cb_keyboard(Fl::event_text()[0]);
     rviewUI->update();
     this->redraw();
@@ -140,8 +201,9 @@ int Fl_RView::handle(int event)
       return 1;
     }
     if (Fl::event_button() == 1) {
+      this->begin_interaction();
       v->SetOrigin(event_x, event_y);
-      v->Update();
+      v->UpdateAsync();
       rviewUI->update();
       this->redraw();
       return 1;
@@ -174,6 +236,14 @@ int Fl_RView::handle(int event)
       this->redraw();
       return 1;
     }
+    if (Fl::event_state() & FL_BUTTON1) {
+      this->begin_interaction();
+      v->SetOrigin(event_x, event_y);
+      v->UpdateAsync();
+      rviewUI->update();
+      this->redraw();
+      return 1;
+    }
     break;
   case FL_RELEASE:
     if ((Fl::event_button() == 1) && (Fl::event_shift() != 0)) {
@@ -191,8 +261,9 @@ int Fl_RView::handle(int event)
     return 1;
     break;
   case FL_MOUSEWHEEL:
+    this->begin_interaction();
     v->MouseWheel(event_x, event_y, event_dy);
-    v->Update();
+    v->UpdateAsync();
     rviewUI->update();
     this->redraw();
     return 1;
@@ -36,15 +36,33 @@ public:
   /// Pointer to the registration viewer
   RView *v;
 
+  /// Whether stage timings are displayed on top of the images
+  bool hud;
+
   /// Constructor
   Fl_RView(int, int, int, int, const char *);
 
   /// Default draw function
   void draw();
 
+  /// Draw stage timings, counters and frame time histogram
+  void draw_hud();
+
   /// Default function to handle events
   int handle(int);
 
+  /// Reslice with fast interpolation until no interaction for a short while
+  void begin_interaction();
+
+  /// Called when no interaction occurred for a while, refines rendering
+  static void cb_refine(void *);
+
+  /// Called by background thread of registration viewer after an update
+  static void cb_updated(void *);
+
+  /// Called by main thread after a background update (cf. Fl::awake)
+  static void cb_awake(void *);
+
   #if FL_API_VERSION < 10304
   int pixel_w()
   {
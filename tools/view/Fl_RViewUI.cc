@@ -71,10 +71,11 @@ void Fl_RViewUI::cb_resliceX(Fl_Roller *o, void *)
   if (x < 0) x = 0;
   if (x >= rview->GetTarget()->GetX()) x = rview->GetTarget()->GetX()-1;
   rview->GetTarget()->ImageToWorld(x, y, z);
+  viewer->begin_interaction();
   rview->SetOrigin(x, y, z);
 
   // Update
-  rview->Update();
+  rview->UpdateAsync();
   viewer->redraw();
   rviewUI->update();
 }
@@ -90,10 +91,11 @@ void Fl_RViewUI::cb_resliceY(Fl_Roller *o, void *)
   if (y < 0) y = 0;
   if (y >= rview->GetTarget()->GetY()) y = rview->GetTarget()->GetY()-1;
   rview->GetTarget()->ImageToWorld(x, y, z);
+  viewer->begin_interaction();
   rview->SetOrigin(x, y, z);
 
   // Update
-  rview->Update();
+  rview->UpdateAsync();
   viewer->redraw();
   rviewUI->update();
 }
@@ -109,18 +111,20 @@ void Fl_RViewUI::cb_resliceZ(Fl_Roller* o, void *)
   if (z < 0) z = 0;
   if (z >= rview->GetTarget()->GetZ()) z = rview->GetTarget()->GetZ()-1;
   rview->GetTarget()->ImageToWorld(x, y, z);
+  viewer->begin_interaction();
   rview->SetOrigin(x, y, z);
 
   // Update
-  rview->Update();
+  rview->UpdateAsync();
   viewer->redraw();
   rviewUI->update();
 }
 
 void Fl_RViewUI::cb_zoom(Fl_Value_Slider* o, void*)
 {
+  viewer->begin_interaction();
   rview->SetResolution(o->value());
-  rview->Update();
+  rview->UpdateAsync();
   viewer->redraw();
 }
 
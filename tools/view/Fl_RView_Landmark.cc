@@ -63,6 +63,23 @@ extern Fl_RViewUI  *rviewUI;
 extern Fl_RView    *viewer;
 extern RView    *rview;
 
+char fitModelStrings[3][255] = {"rigid", "similarity", "affine"};
+char fitModeStrings [3][255] = {"none", "ransac", "irls"};
+
+Fl_Menu_Item Fl_RViewUI::menu_fitModel[] = {
+  {"Rigid",      0, (Fl_Callback*)cb_fitModel, fitModelStrings[0], 0, 0, 0, 0, 0},
+  {"Similarity", 0, (Fl_Callback*)cb_fitModel, fitModelStrings[1], 0, 0, 0, 0, 0},
+  {"Affine",     0, (Fl_Callback*)cb_fitModel, fitModelStrings[2], 0, 0, 0, 0, 0},
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+};
+
+Fl_Menu_Item Fl_RViewUI::menu_fitMode[] = {
+  {"None",   0, (Fl_Callback*)cb_fitMode, fitModeStrings[0], 0, 0, 0, 0, 0},
+  {"RANSAC", 0, (Fl_Callback*)cb_fitMode, fitModeStrings[1], 0, 0, 0, 0, 0},
+  {"IRLS",   0, (Fl_Callback*)cb_fitMode, fitModeStrings[2], 0, 0, 0, 0, 0},
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+};
+
 void Fl_RViewUI::cb_loadTargetLandmarks(Fl_Button *, void *)
 {
   int i;
@@ -550,16 +567,59 @@ void Fl_RViewUI::cb_fitLandmarks(Fl_Button *, void*)
     return;
   } else {
     char buffer[256];
+    int i, worst;
     double error;
     error = rview->FitLandmarks();
+    if (error < 0) {
+      fl_alert("Fit requires at least %d landmark pairs which are not collinear (or coplanar for affine)!",
+               rview->GetLandmarkFit().MinimumNumberOfLandmarks());
+      return;
+    }
     rview->SourceUpdateOn();
     rview->Update();
     viewer->redraw();
-    sprintf(buffer, "Residual fitting error: %f mm", error);
+
+    // Residual of each landmark pair
+    LandmarkFit &fit = rview->GetLandmarkFit();
+    worst = 0;
+    for (i = 0; i < fit.NumberOfLandmarks(); i++) {
+      cout << "Landmark " << i + 1 << ": residual = " << fit.Residual(i) << " mm";
+      if (!fit.IsInlier(i)) cout << " (outlier)";
+      cout << endl;
+      if (fit.Residual(i) > fit.Residual(worst)) worst = i;
+    }
+    sprintf(buffer, "Residual fitting error: %f mm\nMaximum: %f mm (landmark %d)\nInliers: %d of %d",
+            error, fit.Residual(worst), worst + 1, fit.NumberOfInliers(), fit.NumberOfLandmarks());
     fl_alert("%s",buffer);
   }
 }
 
+void Fl_RViewUI::cb_fitModel(Fl_Menu_ *, void *v)
+{
+  if (strcmp((char *)v, "rigid") == 0) {
+    rview->GetLandmarkFit().SetModel(LandmarkFit_Rigid);
+  }
+  if (strcmp((char *)v, "similarity") == 0) {
+    rview->GetLandmarkFit().SetModel(LandmarkFit_Similarity);
+  }
+  if (strcmp((char *)v, "affine") == 0) {
+    rview->GetLandmarkFit().SetModel(LandmarkFit_Affine);
+  }
+}
+
+void Fl_RViewUI::cb_fitMode(Fl_Menu_ *, void *v)
+{
+  if (strcmp((char *)v, "none") == 0) {
+    rview->GetLandmarkFit().SetMode(LandmarkFit_LeastSquares);
+  }
+  if (strcmp((char *)v, "ransac") == 0) {
+    rview->GetLandmarkFit().SetMode(LandmarkFit_RANSAC);
+  }
+  if (strcmp((char *)v, "irls") == 0) {
+    rview->GetLandmarkFit().SetMode(LandmarkFit_IRLS);
+  }
+}
+
 void Fl_RViewUI::cb_viewROI(Fl_Button* o, void*)
 {
   if (o->value() == 0) rview->DisplayROIOff();
@@ -618,8 +678,8 @@ void Fl_RViewUI::cb_loadObject(Fl_Button* o, void*)
     if ( chooser.count() >= 1 ) {
         for ( int t=1; t<=chooser.count(); t++ ) {
             const char *filename = chooser.value(t);
-            if (filename != NULL) {
-                rview->ReadObject(filename);
+            if (filename != NULL && !rview->ReadObject(filename)) {
+                fl_alert("Cannot read object %s", filename);
             }
         }
         rview->DisplayObjectOn();
@@ -680,6 +740,8 @@ void Fl_RViewUI::UpdateObjectControlWindow()
   rviewUI->viewLandmarks->value(rview->GetDisplayLandmarks());
   rviewUI->refineTags->value(rview->GetTrackTAG());
   rviewUI->viewTagGrid->value(rview->GetViewTAG());
+  rviewUI->fitModel->value(rview->GetLandmarkFit().GetModel());
+  rviewUI->fitMode->value(rview->GetLandmarkFit().GetMode());
 #ifdef HAVE_VTK
   rviewUI->viewObjectMovie->value(rview->GetObjectMovie());
   rviewUI->warpObject->value(rview->GetDisplayObjectWarp());
@@ -771,6 +833,17 @@ void Fl_RViewUI::InitializeObjectControlWindow()
       Fl_Check_Button *o  = viewTagGrid = new Fl_Check_Button(39, 580, 100, 20, "Tag grid");
       o->callback((Fl_Callback*)cb_viewTagGrid);
     }
+    {
+      Fl_Choice *o = fitModel = new Fl_Choice(320, 580, 70, 25, "Fit model");
+      o->align(FL_ALIGN_BOTTOM);
+      o->menu(menu_fitModel);
+    }
+    {
+      Fl_Choice *o = fitMode = new Fl_Choice(320, 620, 70, 25, "Outliers");
+      o->align(FL_ALIGN_BOTTOM);
+      o->menu(menu_fitMode);
+      o->tooltip("Rejection (RANSAC) or down-weighting (IRLS) of outlier landmarks");
+    }
 #ifdef HAVE_VTK
     {
         Fl_Check_Button *o  = viewObjectMovie = new Fl_Check_Button(39, 620, 120, 20, "Object movie");
@@ -36,6 +36,12 @@ Fl_Multi_Browser *sourceLandmarkBrowser;
 /// Widget for ROI
 Fl_Button *viewROI;
 
+/// Widgets for transformation model and outlier treatment of landmark fit
+Fl_Choice *fitModel;
+Fl_Choice *fitMode;
+static Fl_Menu_Item menu_fitModel[];
+static Fl_Menu_Item menu_fitMode[];
+
 /// Callbacks for landmarks and objects
 static void cb_viewROI(Fl_Button*, void*);
 static void cb_trackTAG(Fl_Button*, void*);
@@ -57,6 +63,8 @@ static void cb_editLandmark(Fl_Button*, void*);
 static void cb_browseLandmark(Fl_Browser*, void*);
 static void cb_viewLandmarks(Fl_Button*, void*);
 static void cb_fitLandmarks(Fl_Button*, void*);
+static void cb_fitModel(Fl_Menu_*, void*);
+static void cb_fitMode(Fl_Menu_*, void*);
 static void cb_loadTargetLandmarks(Fl_Button*, void*);
 static void cb_loadSourceLandmarks(Fl_Button*, void*);
 static void cb_saveTargetLandmarks(Fl_Button*, void*);
@@ -23,6 +23,11 @@
 // Local includes
 #include "Fl_RViewUI.h"
 
+// The registration panel is written against the registration classes of
+// IRTK, which MIRTK does not provide (cf. mirtk::GenericRegistrationFilter),
+// and HAS_REGISTRATION_PANEL is thus not defined by the build. Registrations
+// are instead run as separate processes whose progress is displayed with
+// view -monitor (cf. TransformationMailbox and the publish_dofs tool).
 #ifdef HAS_REGISTRATION_PANEL
 
 extern Fl_RViewUI  *rviewUI;
@@ -19,6 +19,8 @@
 #include <mirtk/Image.h>
 #include <mirtk/Transformation.h>
 #include <mirtk/Registration.h>
+#include <mirtk/MovieWriter.h>
+#include <mirtk/TransformationSequence.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -197,7 +199,7 @@ void Fl_RViewUI::cb_editTransformationUpdate(Fl_Valuator* o, void* v)
   if (cp < transform->NumberOfDOFs()) transform->Put(cp, o->value());
 
   // Update
-  rview->SourceUpdateOn();
+  rview->SourceTransformModified();
   rview->Update();
   viewer->redraw();
 }
@@ -218,7 +220,7 @@ void Fl_RViewUI::cb_editTransformationReset(Fl_Button*, void*)
       rviewUI->transformationValuator[i]->value(transform->Get(i));
     }
     // Update
-    rview->SourceUpdateOn();
+    rview->SourceTransformModified();
     rview->Update();
     viewer->redraw();
   }
@@ -293,41 +295,43 @@ void Fl_RViewUI::cb_movedownTransformation(Fl_Button* o, void*)
 void Fl_RViewUI::cb_movieTransformation(Fl_Button* o, void*)
 {
   int i;
-  char buffer2[256];
+  char *filename = NULL;
+  MovieWriter writer;
+  bool save;
 
   if (fl_choice("Do you want to save the movie to disk?", NULL, "No", "Yes") == 2) {
+    filename = fl_file_chooser("Save movie", "*.{mp4,y4m,png}", "movie.mp4");
+  }
+  // Transformations are not played back in real time, use a standard frame rate
+  save = (filename != NULL && writer.Open(filename, rview->GetWidth(), rview->GetHeight(), 25));
 
-    for (i = 1; i <= rviewUI->transformationBrowser->size(); i++) {
-
-      // Read transformation
-      char *buffer = strdup(rviewUI->transformationBrowser->text(i));
-      rview->ReadTransformation(buffer);
-      rviewUI->info_trans_filename->value(buffer);
-      free(buffer);
-
-      // Update
-      rview->Update();
-      sprintf(buffer2, "movie_%.5d.png", i);
-      rview->DrawOffscreen(buffer2);
-    }
-  } else {
+  // Read transformations ahead of display while playing the movie
+  TransformationSequence sequence;
+  for (i = 1; i <= rviewUI->transformationBrowser->size(); i++) {
+    sequence.Add(rviewUI->transformationBrowser->text(i));
+  }
+  sequence.Prefetch(-1);
 
-    for (i = 1; i <= rviewUI->transformationBrowser->size(); i++) {
+  for (i = 1; i <= sequence.Size(); i++) {
 
-      // Read transformation
-      char *buffer = strdup(rviewUI->transformationBrowser->text(i));
-      rview->ReadTransformation(buffer);
-      rviewUI->info_trans_filename->value(buffer);
-      free(buffer);
+    // Swap in transformation, keeping filters and displacement cache
+    rview->SwapTransformation(sequence.Get(i-1));
+    rviewUI->info_trans_filename->value(rviewUI->transformationBrowser->text(i));
 
-      // Update
-      rview->Update();
+    // Update
+    rview->Update();
+    if (save) {
+      unsigned char *frame = writer.Acquire();
+      rview->DrawOffscreen(frame);
+      writer.Submit(frame);
+    } else {
       viewer->redraw();
 
       // Force drawing
       Fl::wait(0);
     }
   }
+  if (save && !writer.Close()) fl_alert("Failed to save movie %s", filename);
 
   if (rviewUI->transformationBrowser->size() > 0) {
     // Read transformation
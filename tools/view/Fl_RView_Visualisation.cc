@@ -19,6 +19,8 @@
 #include <mirtk/Image.h>
 #include <mirtk/Transformation.h>
 #include <mirtk/Registration.h>
+#include <mirtk/MovieWriter.h>
+#include <mirtk/PlaybackScheduler.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -157,67 +159,143 @@ void Fl_RViewUI::cb_saveSource(Fl_Button *, void *)
   }
 }
 
+// Wall-clock schedule of movie playback
+static PlaybackScheduler playback;
+
+// Prepare frame of given tick of the movie in the background
+static void request_frame(long tick)
+{
+  int t = playback.Frame(tick, rview->GetNumberOfTargetFrames());
+  rview->SetTargetFrame(t);
+  rview->SetSourceFrame(t);
+  rview->UpdateAsync();
+}
+
+// Present frame as soon as it is ready instead of redrawing it right away
+static void cb_frameReady(void *)
+{
+  Fl::awake(Fl_RViewUI::cb_playback, NULL);
+}
+
 void Fl_RViewUI::cb_movieStart(Fl_Button *, void *)
 {
-    Fl::add_timeout(rview->GetTarget()->GetTSize() / rview->GetSpeed(), cb_playback);
+  if (playback.IsRunning()) return;
+
+  // Following loops of the movie display cached slices
+  rview->SliceCacheOn();
+
+  rview->Lock();
+  rview->SetUpdateCallback(cb_frameReady, NULL);
+  playback.Start(rview->GetTargetFrame(), rview->GetTarget()->GetTSize() / rview->GetSpeed());
+  request_frame(playback.Pending());
+  rview->Unlock();
+  Fl::add_timeout(playback.TimeUntil(playback.Pending()), cb_playback);
 }
 
 void Fl_RViewUI::cb_movieStop(Fl_Button *, void *)
 {
-    Fl::remove_timeout(cb_playback);  	
+  char buffer[256];
+
+  if (!playback.IsRunning()) return;
+  Fl::remove_timeout(cb_playback);
+
+  rview->Lock();
+  playback.Stop();
+  rview->SetUpdateCallback(Fl_RView::cb_updated, viewer);
+  rview->SliceCacheOff();
+  rview->Unlock();
+
+  sprintf(buffer, "Playback: %.1f of %.1f frames per second, %ld frames dropped",
+          playback.AchievedRate(), playback.RequestedRate(), playback.NumberOfDroppedFrames());
+  cout << buffer << endl;
+  rviewUI->mainWindow->label("MIRTK Viewer");
+  viewer->redraw();
 }
 
 void Fl_RViewUI::cb_playback(void *)
 {
   //http://seriss.com/people/erco/fltk/#AnimateDrawing
   // http://www.fltk.org/doc-1.3/classFl.html#ae5373d1d50c2b0ba38280d78bb6d2628
-  int t = rview->GetTargetFrame()+1;
-    
-  if (t < 0) t = rview->GetTarget()->GetT()-1;
-  if (t >= rview->GetTarget()->GetT()) t = 0;
-  
-  rview->SetTargetFrame(t);
-  rview->SetSourceFrame(t);
-  rview->Update();
-  viewer->redraw();
-  rviewUI->update();
-  
-  Fl::repeat_timeout(rview->GetTarget()->GetTSize() / rview->GetSpeed(), cb_playback);
+
+  char buffer[256];
+  double wait;
+
+  // Timeouts are not dispatched as events, guard against background update
+  rview->Lock();
+  if (!playback.IsRunning()) {
+    rview->Unlock();
+    return;
+  }
+  Fl::remove_timeout(cb_playback);
+
+  wait = playback.TimeUntil(playback.Pending());
+  if (!rview->IsUpdating() && wait <= 0) {
+    // Draw prepared frame now, before the next one overwrites it
+    viewer->redraw();
+    rviewUI->update();
+    Fl::flush();
+
+    // Report achieved frame rate in title of main window
+    sprintf(buffer, "MIRTK Viewer (%.1f of %.1f fps, %ld dropped)",
+            playback.AchievedRate(), playback.RequestedRate(), playback.NumberOfDroppedFrames());
+    rviewUI->mainWindow->copy_label(buffer);
+
+    // Prepare next frame which is due, dropping those which are overdue
+    request_frame(playback.Present());
+    wait = playback.TimeUntil(playback.Pending());
+  }
+  rview->Unlock();
+
+  // When the frame is not ready yet, cb_frameReady calls this function
+  // once it is. The timeout is only a fallback in case it was cancelled.
+  if (wait < 0) wait = 0.05;
+  Fl::add_timeout(wait, cb_playback);
 }
 
 void Fl_RViewUI::cb_savePlayback(Fl_Button *, void *)
 {
   int i, t, s;
-  char buffer2[256];
+  char *filename = NULL;
 
   if (fl_choice("Do you want to save the movie to disk?", NULL, "No", "Yes") == 2) {
+    filename = fl_file_chooser("Save movie", "*.{mp4,y4m,png}", "movie.mp4");
+  }
 
-    t = rview->GetTargetFrame();
-    s = rview->GetSourceFrame();
-    for (i = 0; i < rview->GetTarget()->GetT(); i++) {
-      rview->SetTargetFrame(i);
-      rview->SetSourceFrame(i);
+  if (filename != NULL) {
 
-      // Update
-      rview->Update();
-      sprintf(buffer2, "movie_%.5d.png", i);
-      rview->DrawOffscreen(buffer2);
+    // Frames are encoded on a background thread while the next one is rendered
+    MovieWriter writer;
+    if (writer.Open(filename, rview->GetWidth(), rview->GetHeight(),
+                    rview->GetSpeed() / rview->GetTarget()->GetTSize())) {
+      t = rview->GetTargetFrame();
+      s = rview->GetSourceFrame();
+      for (i = 0; i < rview->GetNumberOfTargetFrames(); i++) {
+        rview->SetTargetFrame(i);
+        rview->SetSourceFrame(i);
 
-      // Draw on screen to
-      viewer->redraw();
+        // Update
+        rview->Update();
+        unsigned char *frame = writer.Acquire();
+        rview->DrawOffscreen(frame);
+        writer.Submit(frame);
 
-      // Force drawing
-      Fl::wait(0);
+        // Draw on screen to
+        viewer->redraw();
 
+        // Force drawing
+        Fl::wait(0);
+
+      }
+      rview->SetTargetFrame(t);
+      rview->SetSourceFrame(s);
     }
-    rview->SetTargetFrame(t);
-    rview->SetSourceFrame(s);
+    if (!writer.Close()) fl_alert("Failed to save movie %s", filename);
 
   } else {
 
     t = rview->GetTargetFrame();
     s = rview->GetSourceFrame();
-    for (i = 0; i < rview->GetTarget()->GetT(); i++) {
+    for (i = 0; i < rview->GetNumberOfTargetFrames(); i++) {
       rview->SetTargetFrame(i);
       rview->SetSourceFrame(i);
 
@@ -257,6 +335,12 @@ void Fl_RViewUI::cb_lineThickness(Fl_Value_Slider* o, void*)
 void Fl_RViewUI::cb_speed(Fl_Value_Slider* o, void*)
 {
   rview->SetSpeed(o->value());
+  if (playback.IsRunning()) {
+    // Restart schedule of playback at current frame
+    playback.Start(rview->GetTargetFrame(), rview->GetTarget()->GetTSize() / rview->GetSpeed());
+    request_frame(playback.Pending());
+    return;
+  }
   rview->Update();
   viewer->redraw();
 }
@@ -799,11 +883,11 @@ void Fl_RViewUI::UpdateImageControlWindow()
 
   // Set up correct min and max values for time frames
   targetFrame->minimum(0);
-  if(rview->GetTarget()->GetT() > 0)
-      targetFrame->maximum(rview->GetTarget()->GetT()-1);
+  if(rview->GetNumberOfTargetFrames() > 0)
+      targetFrame->maximum(rview->GetNumberOfTargetFrames()-1);
   else
       targetFrame->maximum(0);
-  if(rview->GetTargetFrame() < rview->GetTarget()->GetT()
+  if(rview->GetTargetFrame() < rview->GetNumberOfTargetFrames()
       && rview->GetTargetFrame() > -1)
       targetFrame->value(rview->GetTargetFrame());
   else{
@@ -811,11 +895,11 @@ void Fl_RViewUI::UpdateImageControlWindow()
       rview->SetTargetFrame(0);
   }
   sourceFrame->minimum(0);
-  if(rview->GetSource()->GetT() > 0)
-      sourceFrame->maximum(rview->GetSource()->GetT()-1);
+  if(rview->GetNumberOfSourceFrames() > 0)
+      sourceFrame->maximum(rview->GetNumberOfSourceFrames()-1);
   else
       sourceFrame->maximum(0);
-  if(rview->GetSourceFrame() < rview->GetSource()->GetT()
+  if(rview->GetSourceFrame() < rview->GetNumberOfSourceFrames()
       && rview->GetSourceFrame() > -1)
       sourceFrame->value(rview->GetSourceFrame());
   else{
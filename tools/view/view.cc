@@ -30,11 +30,80 @@ Fl_RView *viewer;
 RView *rview;
 
 
+// Serialize event handling with background updates of the registration viewer
+int dispatch(int event, Fl_Window *window)
+{
+  int ret;
+
+  rview->Lock();
+  ret = Fl::handle_(event, window);
+  rview->Unlock();
+  return ret;
+}
+
+// Poll exact intensity range of memory-mapped images, which is computed
+// by a background thread and only applied here while holding the lock
+void refine_range(void *)
+{
+  bool refining;
+
+  rview->Lock();
+  refining = rview->RefineIntensityRangeAsync();
+  if (!refining) {
+    rview->UpdateAsync();
+    rviewUI->update();
+  }
+  rview->Unlock();
+  if (refining) Fl::repeat_timeout(0.2, refine_range);
+}
+
+// Enable frames of image sequences as these are read in the background
+void load_frames(void *)
+{
+  bool loading;
+
+  rview->Lock();
+  loading = rview->LoadFrames();
+  rviewUI->UpdateImageControlWindow();
+  if (!loading) {
+    rview->UpdateAsync();
+    rviewUI->update();
+  }
+  rview->Unlock();
+  if (loading) Fl::repeat_timeout(0.2, load_frames);
+}
+
+// Reslice from pyramid levels of zoomed out images once these were computed
+// in the background, levels may be requested by any update
+void load_levels(void *)
+{
+  rview->Lock();
+  if (rview->UpdatePyramids()) {
+    rview->UpdateAsync();
+    rviewUI->update();
+  }
+  rview->Unlock();
+  Fl::repeat_timeout(0.1, load_levels);
+}
+
+// Redraw at most at the display rate when a registration published new DOFs
+void monitor_transformation(void *)
+{
+  // Timeouts are not dispatched with the lock held (cf. dispatch)
+  if (rview->FetchTransformation()) {
+    rview->Lock();
+    rview->UpdateAsync();
+    rviewUI->update();
+    rview->Unlock();
+  }
+  Fl::repeat_timeout(0.04, monitor_transformation);
+}
+
 void usage()
 {
   cerr << "Usage: view [target] <source <dofin>> <options>\n";
   cerr << "Where <options> can be one or more of the following:\n";
-  cerr << "\t<-config           file.cnf>     Rview configuration file\n";
+  cerr << "\t<-config           file.cnf>     Rview session or configuration file\n";
   cerr << "\t<-target_landmarks file.vtk>     Target landmarks (vtkPolyData)\n";
   cerr << "\t<-source_landmarks file.vtk>     Source landmarks (vtkPolyData)\n";
 #ifdef HAVE_VTK
@@ -55,6 +124,9 @@ void usage()
   cerr << "\t<-arrow>                         Deformation arrows on\n";
   cerr << "\t<-level value>                   Deformation level\n";
   cerr << "\t<-res   value>                   Resolution factor\n";
+  cerr << "\t<-pyramid>                       Downsample memory-mapped images when zoomed out\n";
+  cerr << "\t<-cache value>                   Memory for movie slice cache in MB\n";
+  cerr << "\t<-monitor socket>                Display DOFs of a registration sent to local socket\n";
   cerr << "\t<-nn>                            Nearest neighbour interpolation (default)\n";
   cerr << "\t<-linear>                        Linear interpolation\n";
   cerr << "\t<-c1spline>                      C1-spline interpolation\n";
@@ -133,8 +205,8 @@ int main(int argc, char **argv)
       }
       filename_argv++;
 
-      // Read sequence
-      rview->ReadTarget(filename_argc, filename_argv);
+      // Read sequence, displaying the first frame while reading the others
+      rview->ReadTarget(filename_argc, filename_argv, true);
       ok = true;
     }
     if (!ok && (strcmp(argv[1], "-source") == 0)) {
@@ -151,8 +223,8 @@ int main(int argc, char **argv)
       }
       filename_argv++;
 
-      // Read sequence
-      rview->ReadSource(filename_argc, filename_argv);
+      // Read sequence, displaying the first frame while reading the others
+      rview->ReadSource(filename_argc, filename_argv, true);
       ok = true;
     }
     if ( !ok && (strcmp(argv[1], "-dofin") == 0)) {
@@ -172,7 +244,7 @@ int main(int argc, char **argv)
     if ( !ok && (strcmp(argv[1], "-config") == 0)) {
       argc--;
       argv++;
-      rview->Read(argv[1]);
+      if (!rview->Read(argv[1])) exit(1);
       argc--;
       argv++;
       ok = true;
@@ -200,7 +272,7 @@ int main(int argc, char **argv)
       argc--;
       argv++;
       do {
-        rview->ReadObject(argv[1]);
+        if (!rview->ReadObject(argv[1])) exit(1);
         argc--;
         argv++;
       } while ((argc > 1) && (argv[1][0] != '-'));
@@ -403,6 +475,28 @@ int main(int argc, char **argv)
       argv++;
       ok = true;
     }
+    if (!ok && (strcmp(argv[1], "-pyramid") == 0)) {
+      argc--;
+      argv++;
+      rview->PyramidOn();
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-cache") == 0)) {
+      argc--;
+      argv++;
+      rview->SetSliceCacheBudget(static_cast<size_t>(atof(argv[1]) * 1024 * 1024));
+      argc--;
+      argv++;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-monitor") == 0)) {
+      argc--;
+      argv++;
+      if (!rview->GetTransformationMailbox().Listen(argv[1])) exit(1);
+      argc--;
+      argv++;
+      ok = true;
+    }
     if (!ok && (strcmp(argv[1], "-origin") == 0)) {
       argc--;
       argv++;
@@ -622,6 +716,12 @@ int main(int argc, char **argv)
   }
 
   Fl::visual(FL_DOUBLE | FL_RGB);
+  Fl::lock();
+  Fl::event_dispatch(dispatch);
+  Fl::add_timeout(0.2, refine_range);
+  Fl::add_timeout(0.2, load_frames);
+  Fl::add_timeout(0.1, load_levels);
+  Fl::add_timeout(0.04, monitor_transformation);
   rviewUI->show();
   return Fl::run();
 }
@@ -0,0 +1,382 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright (c) Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mirtk/Image.h>
+#include <mirtk/Transformations.h>
+
+#include <mirtk/OpenGl.h>
+#include <mirtk/RView.h>
+#include <mirtk/HistogramWindow.h>
+
+#ifdef __APPLE__
+  #include <glut.h>
+#else
+  #include <GL/glut.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+RView *rview;
+
+int repetitions;
+FILE *output;
+
+
+void usage()
+{
+  cerr << "Usage: viewer_benchmark <options>\n";
+  cerr << "Times the render pipeline of the registration viewer on synthetic images\n";
+  cerr << "and writes one line per benchmark with tab separated columns:\n";
+  cerr << "benchmark, transformation, view mode, repetitions, mean, min and max time in ms\n";
+  cerr << "Where <options> can be one or more of the following:\n";
+  cerr << "\t<-size x y z>                    Image size (default: 256 256 128)\n";
+  cerr << "\t<-type name>                     Voxel type: uchar, short, ushort, float, double (default: short)\n";
+  cerr << "\t<-levels value>                  Number of FFD levels (default: 3)\n";
+  cerr << "\t<-repeat value>                  Repetitions of each benchmark (default: 10)\n";
+  cerr << "\t<-x value>                       Width (default: 512)\n";
+  cerr << "\t<-y value>                       Height (default: 512)\n";
+  cerr << "\t<-dir path>                      Directory of synthetic image files (default: .)\n";
+  cerr << "\t<-output file>                   Output file (default: standard output)\n";
+  cerr << "\t<-draw>                          Also time drawing of isolines and contours,\n";
+  cerr << "\t                                 which requires a display\n";
+  exit(1);
+}
+
+/// Time in milliseconds since first call
+double now()
+{
+  static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Write timings of benchmark
+void report(const char *benchmark, const char *transformation, const char *mode, const std::vector<double> &times)
+{
+  double sum;
+  size_t i;
+
+  sum = 0;
+  for (i = 0; i < times.size(); i++) sum += times[i];
+  fprintf(output, "%s\t%s\t%s\t%d\t%.3f\t%.3f\t%.3f\n", benchmark, transformation, mode,
+          static_cast<int>(times.size()), sum / times.size(),
+          *std::min_element(times.begin(), times.end()),
+          *std::max_element(times.begin(), times.end()));
+  fflush(output);
+}
+
+/// Move origin by one voxel to force reslicing, alternating between two slices
+void move_origin(int i)
+{
+  double x, y, z;
+
+  rview->GetOrigin(x, y, z);
+  rview->SetOrigin(x, y, z + ((i % 2 == 0) ? 1 : -1) * rview->GetTarget()->GetZSize());
+}
+
+/// Write synthetic target, source and label images
+void write_images(const std::string &dir, int x, int y, int z, int type)
+{
+  int i, j, k;
+  double cx, cy, cz, r, value;
+
+  mirtk::ImageAttributes attr(x, y, z, 1.0, 1.0, 1.0);
+  mirtk::Image *target = mirtk::Image::New(type);
+  mirtk::Image *source = mirtk::Image::New(type);
+  mirtk::GreyImage labels(attr);
+  target->Initialize(attr);
+  source->Initialize(attr);
+
+  // Smooth blobs with intensities in the range of unsigned char
+  cx = (x - 1) / 2.0;
+  cy = (y - 1) / 2.0;
+  cz = (z - 1) / 2.0;
+  for (k = 0; k < z; k++) {
+    for (j = 0; j < y; j++) {
+      for (i = 0; i < x; i++) {
+        r = sqrt((i - cx) * (i - cx) + (j - cy) * (j - cy) + (k - cz) * (k - cz));
+        value = 100 + 50 * sin(i / 8.0) * cos(j / 8.0) * sin(k / 6.0);
+        if (r < std::min(cx, cy) / 2) value += 100;
+        target->PutAsDouble(i, j, k, value);
+        source->PutAsDouble(i, j, k, 100 + 50 * sin((i + 3) / 8.0) * cos((j - 2) / 8.0) * sin(k / 6.0));
+        labels(i, j, k) = static_cast<mirtk::GreyPixel>((r < std::min(cx, cy)) ? 1 + int(4 * r / std::min(cx, cy)) : 0);
+      }
+    }
+  }
+  target->Write((dir + "/benchmark_target.nii").c_str());
+  source->Write((dir + "/benchmark_source.nii").c_str());
+  labels.Write((dir + "/benchmark_labels.nii").c_str());
+  delete target;
+  delete source;
+}
+
+/// Write synthetic affine and multi-level free-form transformations
+void write_transformations(const std::string &dir, int x, int y, int z, int levels)
+{
+  int i, l;
+  double spacing;
+
+  mirtk::AffineTransformation affine;
+  affine.PutTranslationX(2);
+  affine.PutTranslationY(-3);
+  affine.PutRotationZ(5);
+  affine.PutScaleX(105);
+  affine.Write((dir + "/benchmark_affine.dof").c_str());
+
+  // Control point spacing halves with each level
+  mirtk::ImageAttributes attr(x, y, z, 1.0, 1.0, 1.0);
+  mirtk::MultiLevelFreeFormTransformation mffd;
+  spacing = std::max(x, std::max(y, z)) / 4.0;
+  for (l = 0; l < levels; l++, spacing /= 2) {
+    mirtk::BSplineFreeFormTransformation3D *ffd;
+    ffd = new mirtk::BSplineFreeFormTransformation3D(attr, spacing, spacing, spacing);
+    for (i = 0; i < ffd->NumberOfDOFs(); i++) {
+      ffd->Put(i, spacing / 8 * sin(0.7 * i + l));
+    }
+    mffd.PushLocalTransformation(ffd);
+  }
+  mffd.Write((dir + "/benchmark_ffd.dof").c_str());
+}
+
+/// Time updates of all view modes with the given transformation
+void benchmark_update(const char *transformation)
+{
+  int i, m;
+  double t;
+  std::vector<double> times;
+
+  const RViewMode modes[] = {View_A, View_B, View_Checkerboard, View_Subtraction,
+                             View_HShutter, View_VShutter, View_AoverB, View_BoverA};
+  const char *names[] = {"A", "B", "Checkerboard", "Subtraction",
+                         "HShutter", "VShutter", "AoverB", "BoverA"};
+
+  for (m = 0; m < 8; m++) {
+    rview->SetViewMode(modes[m]);
+    times.clear();
+    for (i = 0; i < repetitions; i++) {
+      move_origin(i);
+      t = now();
+      rview->Update();
+      times.push_back(now() - t);
+    }
+    report("Update", transformation, names[m], times);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int i, x, y, z, w, h, levels, type;
+  bool ok, draw;
+  double t;
+  std::string dir, name;
+  std::vector<double> times;
+
+  x = 256;
+  y = 256;
+  z = 128;
+  w = 512;
+  h = 512;
+  type = mirtk::MIRTK_VOXEL_SHORT;
+  levels = 3;
+  repetitions = 10;
+  dir = ".";
+  draw = false;
+  output = stdout;
+
+  while (argc > 1) {
+    ok = false;
+    if (!ok && (strcmp(argv[1], "-size") == 0) && argc > 4) {
+      x = atoi(argv[2]);
+      y = atoi(argv[3]);
+      z = atoi(argv[4]);
+      argc -= 4;
+      argv += 4;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-type") == 0) && argc > 2) {
+      if      (strcmp(argv[2], "uchar")  == 0) type = mirtk::MIRTK_VOXEL_UNSIGNED_CHAR;
+      else if (strcmp(argv[2], "short")  == 0) type = mirtk::MIRTK_VOXEL_SHORT;
+      else if (strcmp(argv[2], "ushort") == 0) type = mirtk::MIRTK_VOXEL_UNSIGNED_SHORT;
+      else if (strcmp(argv[2], "float")  == 0) type = mirtk::MIRTK_VOXEL_FLOAT;
+      else if (strcmp(argv[2], "double") == 0) type = mirtk::MIRTK_VOXEL_DOUBLE;
+      else usage();
+      argc -= 2;
+      argv += 2;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-levels") == 0) && argc > 2) {
+      levels = atoi(argv[2]);
+      argc -= 2;
+      argv += 2;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-repeat") == 0) && argc > 2) {
+      repetitions = std::max(1, atoi(argv[2]));
+      argc -= 2;
+      argv += 2;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-x") == 0) && argc > 2) {
+      w = atoi(argv[2]);
+      argc -= 2;
+      argv += 2;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-y") == 0) && argc > 2) {
+      h = atoi(argv[2]);
+      argc -= 2;
+      argv += 2;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-dir") == 0) && argc > 2) {
+      dir = argv[2];
+      argc -= 2;
+      argv += 2;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-output") == 0) && argc > 2) {
+      output = fopen(argv[2], "w");
+      if (output == NULL) {
+        cerr << "viewer_benchmark: Can't open file " << argv[2] << endl;
+        exit(1);
+      }
+      argc -= 2;
+      argv += 2;
+      ok = true;
+    }
+    if (!ok && (strcmp(argv[1], "-draw") == 0)) {
+      draw = true;
+      argc--;
+      argv++;
+      ok = true;
+    }
+    if (!ok) {
+      cerr << "Unknown argument: " << argv[1] << endl;
+      usage();
+    }
+  }
+
+  // Synthetic input files
+  write_images(dir, x, y, z, type);
+  write_transformations(dir, x, y, z, levels);
+
+  // Initialize viewer
+  rview = new RView(w, h);
+  rview->Configure(View_XY_XZ_v);
+  name = dir + "/benchmark_target.nii";
+  rview->ReadTarget(const_cast<char *>(name.c_str()));
+  name = dir + "/benchmark_source.nii";
+  rview->ReadSource(const_cast<char *>(name.c_str()));
+  name = dir + "/benchmark_labels.nii";
+  rview->ReadSegmentation(const_cast<char *>(name.c_str()));
+  rview->SetTargetInterpolationMode(mirtk::Interpolation_Linear);
+  rview->SetSourceInterpolationMode(mirtk::Interpolation_Linear);
+
+  // Header
+  fprintf(output, "benchmark\ttransformation\tmode\trepetitions\tmean_ms\tmin_ms\tmax_ms\n");
+
+  // Initialization of reslicing filters
+  times.clear();
+  for (i = 0; i < repetitions; i++) {
+    t = now();
+    rview->Initialize();
+    times.push_back(now() - t);
+  }
+  report("Initialize", "none", "-", times);
+  benchmark_update("none");
+
+  // Reslicing and compositing with each transformation
+  name = dir + "/benchmark_affine.dof";
+  rview->ReadTransformation(const_cast<char *>(name.c_str()));
+  benchmark_update("affine");
+  name = dir + "/benchmark_ffd.dof";
+  rview->ReadTransformation(const_cast<char *>(name.c_str()));
+  benchmark_update("ffd");
+
+  // Segmentation with the contour of a square around the image center
+  rview->SetViewMode(View_A);
+  rview->Update();
+  times.clear();
+  for (i = 0; i < repetitions; i++) {
+    t = now();
+    rview->AddContour(w / 2 - 40, h / 4 - 40, FirstPoint);
+    rview->AddContour(w / 2 + 40, h / 4 - 40, NewPoint);
+    rview->AddContour(w / 2 + 40, h / 4 + 40, NewPoint);
+    rview->AddContour(w / 2 - 40, h / 4 + 40, LastPoint);
+    rview->FillContour(1, 0);
+    rview->ClearContour();
+    times.push_back(now() - t);
+  }
+  report("ContourFill", "ffd", "A", times);
+
+  times.clear();
+  for (i = 0; i < repetitions; i++) {
+    t = now();
+    rview->RegionGrowContour(w / 2, h / 4);
+    rview->ClearContour();
+    times.push_back(now() - t);
+  }
+  report("RegionGrowing", "ffd", "A", times);
+
+  // Histograms of all labels
+  HistogramWindow *histogram = new HistogramWindow(rview);
+  times.clear();
+  for (i = 0; i < repetitions; i++) {
+    t = now();
+    histogram->CalculateHistograms();
+    times.push_back(now() - t);
+  }
+  report("CalculateHistograms", "ffd", "-", times);
+  delete histogram;
+
+  // Drawing of images, isolines and contours
+  if (draw) {
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+    glutInitWindowSize(w, h);
+    glutInitWindowPosition(0, 0);
+    glutCreateWindow("MIRTK Viewer Benchmark");
+    rview->Resize(w, h);
+
+    const char *names[] = {"Draw", "DrawIsolines", "DrawContours"};
+    for (int b = 0; b < 3; b++) {
+      if (b == 1) rview->DisplayTargetContoursOn();
+      if (b == 2) {
+        rview->DisplayTargetContoursOff();
+        rview->SegmentationContoursOn();
+      }
+      times.clear();
+      for (i = 0; i < repetitions; i++) {
+        move_origin(i);
+        rview->Update();
+        t = now();
+        rview->Draw();
+        glFinish();
+        times.push_back(now() - t);
+      }
+      report(names[b], "ffd", "A", times);
+    }
+  }
+
+  if (output != stdout) fclose(output);
+  return 0;
+}